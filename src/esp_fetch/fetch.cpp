@@ -1,14 +1,22 @@
 #include "esp_fetch/fetch.h"
 #include "esp_fetch/fetch_allocator.h"
+#include "esp_fetch/fetch_deflate.h"
+#include "esp_fetch/fetch_inflate.h"
+#include "esp_fetch/fetch_json_stream.h"
+#include "esp_fetch/fetch_trace.h"
 
 #include <algorithm>
 #include <cctype>
 #include <climits>
+#include <cstdio>
 #include <cstring>
 #include <limits>
+#include <string_view>
 
 extern "C" {
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_random.h"
 #include "esp_timer.h"
 }
 
@@ -20,20 +28,76 @@ extern "C" {
 
 namespace {
 constexpr const char *TAG = "ESPFetch";
+constexpr const char *FETCH_MSGPACK_CONTENT_TYPE = "application/msgpack";
+constexpr uint32_t FETCH_RETRY_WAIT_SLICE_MS = 50;
+// Idle workers wake this often to notice that updateConfig() shrank the pool.
+constexpr uint32_t FETCH_WORKER_IDLE_CHECK_MS = 1000;
+// Max count of the worker queue and slot release semaphores. They count queued jobs and wakeups,
+// which stay far below it whatever maxConcurrentRequests is changed to.
+constexpr UBaseType_t FETCH_WORK_SIGNAL_LIMIT = 0xFFFF;
+
+class SchedulerLock {
+  public:
+	explicit SchedulerLock(SemaphoreHandle_t mutex) : _mutex(mutex) {
+		if (_mutex) {
+			xSemaphoreTake(_mutex, portMAX_DELAY);
+		}
+	}
+	~SchedulerLock() {
+		if (_mutex) {
+			xSemaphoreGive(_mutex);
+		}
+	}
+	SchedulerLock(const SchedulerLock &) = delete;
+	SchedulerLock &operator=(const SchedulerLock &) = delete;
 
-struct InternalFetchHeader {
-	FetchString name;
-	FetchString value;
+  private:
+	SemaphoreHandle_t _mutex;
+};
 
-	InternalFetchHeader(
-	    const char *headerName, const char *headerValue, const FetchAllocator<char> &allocator
-	)
-	    : name(headerName ? headerName : "", allocator),
-	      value(headerValue ? headerValue : "", allocator) {
+void deleteSchedulerSemaphores(SemaphoreHandle_t &mutex, SemaphoreHandle_t &slotReleased) {
+	if (mutex) {
+		vSemaphoreDelete(mutex);
+		mutex = nullptr;
 	}
-};
+	if (slotReleased) {
+		vSemaphoreDelete(slotReleased);
+		slotReleased = nullptr;
+	}
+}
+
+bool validateFetchConfig(const FetchConfig &config) {
+	if (config.maxConcurrentRequests == 0) {
+		ESP_LOGE(TAG, "maxConcurrentRequests must be > 0");
+		return false;
+	}
+	if (config.reservedHighPrioritySlots >= config.maxConcurrentRequests) {
+		ESP_LOGE(TAG, "reservedHighPrioritySlots must be < maxConcurrentRequests");
+		return false;
+	}
+	if (config.useWorkerPool && config.stackSize == 0) {
+		ESP_LOGE(TAG, "Invalid stack size for fetch worker");
+		return false;
+	}
+	if (config.lanes.size() >= FetchStats::kLaneSlots) {
+		ESP_LOGE(TAG, "At most %u lanes are supported", (unsigned)(FetchStats::kLaneSlots - 1));
+		return false;
+	}
+	for (const FetchLane &lane : config.lanes) {
+		if (lane.stackSize == 0 || (config.useWorkerPool && lane.workers == 0)) {
+			ESP_LOGE(TAG, "Lanes need a stack size and, with the worker pool, workers");
+			return false;
+		}
+	}
+	return true;
+}
+
+const char *validateFetchLane(const FetchConfig &config, uint8_t lane) {
+	return lane <= config.lanes.size() ? nullptr : "lane is not configured";
+}
 
-using InternalFetchHeaderVector = FetchVector<InternalFetchHeader>;
+using InternalFetchHeader = FetchRawHeader;
+using InternalFetchHeaderVector = FetchRawHeaderVector;
 
 template <typename TString> bool equalsIgnoreCase(const TString &lhs, const char *rhs) {
 	if (!rhs) {
@@ -52,10 +116,109 @@ template <typename TString> bool equalsIgnoreCase(const TString &lhs, const char
 	return true;
 }
 
+// Adds the Range header implied by rangeStart/rangeLength unless the caller set one explicitly.
+void appendFetchRangeHeader(
+    InternalFetchHeaderVector &headers,
+    const FetchRequestOptions &options,
+    const FetchAllocator<char> &allocator
+) {
+	char range[48];
+	if (!esp_fetch_detail::formatFetchRangeHeader(
+	        options.rangeStart,
+	        options.rangeLength,
+	        range,
+	        sizeof(range)
+	    )) {
+		return;
+	}
+	for (const auto &header : headers) {
+		if (equalsIgnoreCase(header.name, "Range")) {
+			return;
+		}
+	}
+	headers.emplace_back("Range", range, allocator);
+}
+
+// Advertises compression for acceptCompressed requests unless the caller set Accept-Encoding.
+void appendFetchAcceptEncoding(
+    InternalFetchHeaderVector &headers,
+    const FetchRequestOptions &options,
+    const FetchAllocator<char> &allocator
+) {
+	if (!options.acceptCompressed) {
+		return;
+	}
+#if ESP_FETCH_HAVE_INFLATE
+	for (const auto &header : headers) {
+		if (equalsIgnoreCase(header.name, "Accept-Encoding")) {
+			return;
+		}
+	}
+	headers.emplace_back("Accept-Encoding", FetchInflater::kAcceptEncoding, allocator);
+#else
+	(void)headers;
+	(void)allocator;
+	static bool warned = false;
+	if (!warned) {
+		warned = true;
+		ESP_LOGW(TAG, "acceptCompressed ignored: no ROM inflater in this build");
+	}
+#endif
+}
+
+// Asks for MessagePack responses on msgpack-format requests unless the caller set Accept.
+void appendFetchAcceptFormat(
+    InternalFetchHeaderVector &headers,
+    const FetchRequestOptions &options,
+    const FetchAllocator<char> &allocator
+) {
+	if (options.bodyFormat != FetchBodyFormat::MsgPack) {
+		return;
+	}
+	for (const auto &header : headers) {
+		if (equalsIgnoreCase(header.name, "Accept")) {
+			return;
+		}
+	}
+	headers.emplace_back("Accept", FETCH_MSGPACK_CONTENT_TYPE, allocator);
+}
+
+// Caller headers plus the ones derived from range, compression and body-format options.
+void buildFetchRequestHeaders(
+    InternalFetchHeaderVector &headers,
+    const FetchRequestOptions &options,
+    const FetchAllocator<char> &allocator
+) {
+	headers.clear();
+	headers.reserve(options.headers.size());
+	for (const auto &header : options.headers) {
+		headers.emplace_back(header.name.c_str(), header.value.c_str(), allocator);
+	}
+	appendFetchRangeHeader(headers, options, allocator);
+	appendFetchAcceptEncoding(headers, options, allocator);
+	appendFetchAcceptFormat(headers, options, allocator);
+}
+
+// First body reservation: enough for typical small responses without committing to the limit.
+size_t initialFetchBodyReserve(size_t bodyLimit) {
+	return std::min(bodyLimit, static_cast<size_t>(1024));
+}
+
+// Appends up to the remaining body limit; returns false once bytes had to be dropped.
+bool appendFetchBody(FetchString &body, size_t limit, const char *data, size_t length) {
+	const size_t current = body.size();
+	const size_t remaining = limit > current ? limit - current : 0;
+	const size_t accepted = std::min(length, remaining);
+	if (accepted > 0) {
+		body.append(data, accepted);
+	}
+	return accepted == length;
+}
+
 struct InternalFetchRequestOptions {
 	explicit InternalFetchRequestOptions(bool usePSRAMBuffers = false)
 	    : charAllocator(usePSRAMBuffers), headerAllocator(usePSRAMBuffers),
-	      headers(headerAllocator) {
+	      headers(headerAllocator), captureHeaderHashes(FetchAllocator<uint32_t>(usePSRAMBuffers)) {
 	}
 
 	FetchAllocator<char> charAllocator;
@@ -74,6 +237,45 @@ struct InternalFetchRequestOptions {
 	bool allowRedirects = true;
 	InternalFetchHeaderVector headers;
 	const char *contentType = nullptr;
+	FetchVector<uint32_t> captureHeaderHashes;
+	size_t streamBufferCount = 1;
+	size_t streamBufferSize = 0;
+	uint8_t *streamBuffers = nullptr;
+	uint64_t rangeStart = 0;
+	int64_t rangeLength = -1;
+	bool acceptCompressed = false;
+	FetchBodyEncoding compressBody = FetchBodyEncoding::Identity;
+	FetchRetryPolicy retry;
+	// Headers prepared once by a FetchRequestTemplate, sent before `headers`.
+	std::shared_ptr<const InternalFetchHeaderVector> sharedHeaders;
+
+	template <typename Visitor> void forEachHeader(Visitor &&visit) const {
+		if (sharedHeaders) {
+			for (const auto &header : *sharedHeaders) {
+				visit(header);
+			}
+		}
+		for (const auto &header : headers) {
+			visit(header);
+		}
+	}
+
+	bool hasHeader(const char *name) const {
+		bool found = false;
+		forEachHeader([&](const InternalFetchHeader &header) {
+			found = found || equalsIgnoreCase(header.name, name);
+		});
+		return found;
+	}
+
+	bool capturesHeader(const char *name) const {
+		if (captureHeaderHashes.empty()) {
+			return true;
+		}
+		const uint32_t hash = esp_fetch_detail::fetchHeaderNameHash(name);
+		return std::find(captureHeaderHashes.begin(), captureHeaderHashes.end(), hash) !=
+		       captureHeaderHashes.end();
+	}
 };
 
 struct FetchStringWriter {
@@ -97,6 +299,16 @@ struct FetchStringWriter {
 	FetchString &target_;
 };
 
+// Serializes a post() payload in the requested wire format.
+void serializeFetchPayload(const JsonDocument &payload, FetchString &body, FetchBodyFormat format) {
+	FetchStringWriter writer(body);
+	if (format == FetchBodyFormat::MsgPack) {
+		serializeMsgPack(payload, writer);
+	} else {
+		serializeJson(payload, writer);
+	}
+}
+
 bool startsWithIgnoreCase(const std::string &value, const char *prefix) {
 	if (!prefix) {
 		return false;
@@ -258,21 +470,53 @@ void populateInternalFetchRequestOptions(
 	target.skipTlsCommonNameCheck = source.skipTlsCommonNameCheck;
 	target.allowRedirects = source.allowRedirects;
 	target.contentType = source.contentType;
+	if (!target.contentType && source.bodyFormat == FetchBodyFormat::MsgPack) {
+		target.contentType = FETCH_MSGPACK_CONTENT_TYPE;
+	}
+	target.streamBufferCount = source.streamBufferCount;
+	target.streamBufferSize = source.streamBufferSize;
+	target.streamBuffers = source.streamBuffers;
+	target.rangeStart = source.rangeStart;
+	target.rangeLength = source.rangeLength;
+	target.acceptCompressed = source.acceptCompressed && ESP_FETCH_HAVE_INFLATE;
+	target.compressBody = source.compressBody;
+	target.retry = source.retry;
+	target.captureHeaderHashes.clear();
+	target.captureHeaderHashes.reserve(source.captureHeaders.size());
+	for (const auto &name : source.captureHeaders) {
+		target.captureHeaderHashes.push_back(esp_fetch_detail::fetchHeaderNameHash(name.c_str()));
+	}
 }
 
 template <typename Callback, typename... Args>
-void invokeFetchCallback(const Callback &callback, Args... args) noexcept {
+void invokeFetchCallback(const Callback &callback, Args &&...args) noexcept {
 	if (!callback) {
 		return;
 	}
 
 #if defined(__cpp_exceptions)
 	try {
-		callback(args...);
+		callback(std::forward<Args>(args)...);
+	} catch (...) {
+	}
+#else
+	callback(std::forward<Args>(args)...);
+#endif
+}
+
+bool invokeFetchBodyProducer(const FetchBodyProducer &producer, FetchBodyWriter &writer) noexcept {
+	if (!producer) {
+		return true;
+	}
+
+#if defined(__cpp_exceptions)
+	try {
+		return producer(writer);
 	} catch (...) {
+		return false;
 	}
 #else
-	callback(args...);
+	return producer(writer);
 #endif
 }
 
@@ -311,12 +555,120 @@ bool invokeFetchStartCallback(const Callback &callback, Args... args) noexcept {
 }
 
 constexpr size_t STREAM_READ_BUFFER_SIZE_FALLBACK_BYTES = 1024;
+// Memory governor estimates: an esp_http_client handle with its request state and socket, the
+// client's RX/TX buffer when left at the IDF default, and an mbedTLS session (record buffers plus
+// contexts and handshake state).
+constexpr size_t FETCH_CLIENT_HEAP_BYTES = 2048;
+constexpr size_t FETCH_CLIENT_BUFFER_DEFAULT_BYTES = 512;
+#if defined(CONFIG_MBEDTLS_SSL_IN_CONTENT_LEN) && defined(CONFIG_MBEDTLS_SSL_OUT_CONTENT_LEN)
+constexpr size_t FETCH_TLS_SESSION_HEAP_BYTES =
+    CONFIG_MBEDTLS_SSL_IN_CONTENT_LEN + CONFIG_MBEDTLS_SSL_OUT_CONTENT_LEN + 12288;
+#else
+constexpr size_t FETCH_TLS_SESSION_HEAP_BYTES = 16384 + 4096 + 12288;
+#endif
+
+size_t resolveReadBufferSize(const esp_fetch_detail::ResolvedFetchTransportOptions &transport) {
+	return transport.rxBufferSize > 0 ? static_cast<size_t>(transport.rxBufferSize)
+	                                  : STREAM_READ_BUFFER_SIZE_FALLBACK_BYTES;
+}
+
+size_t clientBufferBytes(int configuredSize) {
+	return configuredSize > 0 ? static_cast<size_t>(configuredSize)
+	                          : FETCH_CLIENT_BUFFER_DEFAULT_BYTES;
+}
+
+bool isHttpsUrl(const FetchString &url) {
+	static constexpr char kScheme[] = "https://";
+	if (url.size() < sizeof(kScheme) - 1) {
+		return false;
+	}
+	for (size_t i = 0; i < sizeof(kScheme) - 1; ++i) {
+		if (std::tolower(static_cast<unsigned char>(url[i])) != kScheme[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t freeInternalHeapBytes() {
+	return heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+// Whether updateConfig() lets jobs waiting for memory start.
+bool memoryLimitsRelaxed(const FetchConfig &current, const FetchConfig &next) {
+	const bool budgetRaised =
+	    current.memoryBudgetBytes > 0 &&
+	    (next.memoryBudgetBytes == 0 || next.memoryBudgetBytes > current.memoryBudgetBytes);
+	return budgetRaised || next.minFreeHeapBytes < current.minFreeHeapBytes;
+}
 
 bool isRedirectHttpStatus(int statusCode) {
 	return statusCode == 301 || statusCode == 302 || statusCode == 303 || statusCode == 307 ||
 	       statusCode == 308;
 }
 
+FetchString buildConnectionKey(
+    const esp_fetch_detail::FetchUrlOrigin &origin,
+    const esp_fetch_detail::ResolvedFetchTransportOptions &transport,
+    bool disableAutoRedirect,
+    const FetchAllocator<char> &allocator
+) {
+	// Handles are only interchangeable when every setting baked in at esp_http_client_init matches.
+	char settings[96];
+	snprintf(
+	    settings,
+	    sizeof(settings),
+	    ":%u|%p|%d%d%d%d|%d|%d|%d|%d|%d",
+	    static_cast<unsigned>(origin.port),
+	    static_cast<const void *>(transport.tls.caCertPem),
+	    transport.tls.useTlsCertBundle ? 1 : 0,
+	    transport.tls.useGlobalCaStore ? 1 : 0,
+	    transport.tls.skipTlsServerCertValidation ? 1 : 0,
+	    transport.tls.skipTlsCommonNameCheck ? 1 : 0,
+	    static_cast<int>(transport.tlsVersion),
+	    static_cast<int>(transport.tlsDynBufferStrategy),
+	    transport.rxBufferSize,
+	    transport.txBufferSize,
+	    disableAutoRedirect ? 1 : 0
+	);
+
+	FetchString key(allocator);
+	key.reserve(origin.host.size() + std::strlen(settings) + 8);
+	key.append(origin.https ? "https://" : "http://");
+	key.append(origin.host.c_str(), origin.host.size());
+	key.append(settings);
+	return key;
+}
+
+void stampFetchPhase(int64_t &phaseUs, int64_t startedUs) {
+	if (phaseUs < 0) {
+		phaseUs = esp_timer_get_time() - startedUs;
+	}
+}
+
+bool isIdempotentHttpMethod(esp_http_client_method_t method) {
+	return method != HTTP_METHOD_POST && method != HTTP_METHOD_PATCH;
+}
+
+JsonDocument buildStartFailureResult(const std::string &url, const char *message) {
+	JsonDocument doc;
+	doc["url"] = url;
+	doc["ok"] = false;
+	doc["error"]["message"] = message;
+	return doc;
+}
+
+const char *fetchStartFailureMessage(esp_http_client_method_t method) {
+	switch (method) {
+	case HTTP_METHOD_GET:
+		return "failed to start http get";
+	case HTTP_METHOD_POST:
+		return "failed to start http post";
+	default:
+		return "failed to start http request";
+	}
+}
+
 esp_err_t mapStreamReadFailure(esp_http_client_handle_t client, int readResult) {
 	if (readResult == -ESP_ERR_HTTP_EAGAIN) {
 		return ESP_ERR_HTTP_READ_TIMEOUT;
@@ -328,23 +680,325 @@ esp_err_t mapStreamReadFailure(esp_http_client_handle_t client, int readResult)
 
 	return ESP_ERR_HTTP_INCOMPLETE_DATA;
 }
+// Ring of stream buffers shared between the job task (reader) and a consumer task that runs
+// onChunk. Buffer indices circulate through two queues: free -> filled -> free. A zero-length
+// filled entry tells the consumer to stop.
+class FetchStreamPipeline {
+  public:
+	FetchStreamPipeline(
+	    char *buffers,
+	    size_t bufferCount,
+	    size_t bufferSize,
+	    const FetchChunkCallback &onChunk,
+	    BaseType_t coreId
+	)
+	    : _buffers(buffers), _bufferCount(bufferCount), _bufferSize(bufferSize),
+	      _onChunk(onChunk), _coreId(coreId) {
+	}
+
+	~FetchStreamPipeline() {
+		if (_freeQueue) {
+			vQueueDelete(_freeQueue);
+		}
+		if (_filledQueue) {
+			vQueueDelete(_filledQueue);
+		}
+		if (_done) {
+			vSemaphoreDelete(_done);
+		}
+	}
+
+	FetchStreamPipeline(const FetchStreamPipeline &) = delete;
+	FetchStreamPipeline &operator=(const FetchStreamPipeline &) = delete;
+
+	bool start(size_t stackSize, UBaseType_t priority) {
+		_freeQueue = xQueueCreate(_bufferCount, sizeof(size_t));
+		_filledQueue = xQueueCreate(_bufferCount + 1, sizeof(Slot));
+		_done = xSemaphoreCreateBinary();
+		if (!_freeQueue || !_filledQueue || !_done) {
+			return false;
+		}
+		for (size_t i = 0; i < _bufferCount; ++i) {
+			xQueueSend(_freeQueue, &i, 0);
+		}
+		TaskHandle_t consumer = nullptr;
+		return xTaskCreatePinnedToCore(
+		           &FetchStreamPipeline::consumerTask,
+		           "esp-fetch-sink",
+		           stackSize,
+		           this,
+		           priority,
+		           &consumer,
+		           _coreId
+		       ) == pdPASS;
+	}
+
+	char *acquire(size_t &index) {
+		if (xQueueReceive(_freeQueue, &index, portMAX_DELAY) != pdTRUE) {
+			return nullptr;
+		}
+		return _buffers + index * _bufferSize;
+	}
+
+	void submit(size_t index, size_t length) {
+		const Slot slot{index, length};
+		xQueueSend(_filledQueue, &slot, portMAX_DELAY);
+	}
+
+	void recycle(size_t index) {
+		xQueueSend(_freeQueue, &index, portMAX_DELAY);
+	}
+
+	// Stops the consumer after it has drained every submitted chunk.
+	void finish() {
+		const Slot stop{0, 0};
+		xQueueSend(_filledQueue, &stop, portMAX_DELAY);
+		xSemaphoreTake(_done, portMAX_DELAY);
+	}
+
+	size_t bufferSize() const {
+		return _bufferSize;
+	}
+
+	bool rejected() const {
+		return _rejected.load(std::memory_order_acquire);
+	}
+
+	size_t deliveredBytes() const {
+		return _delivered;
+	}
+
+  private:
+	struct Slot {
+		size_t index;
+		size_t length;
+	};
+
+	static void consumerTask(void *arg) {
+		auto *pipeline = static_cast<FetchStreamPipeline *>(arg);
+		Slot slot{};
+		while (xQueueReceive(pipeline->_filledQueue, &slot, portMAX_DELAY) == pdTRUE &&
+		       slot.length > 0) {
+			// After a rejection keep recycling buffers so the reader never blocks.
+			if (!pipeline->rejected()) {
+				const char *data = pipeline->_buffers + slot.index * pipeline->_bufferSize;
+				if (invokeFetchChunkCallback(pipeline->_onChunk, data, slot.length)) {
+					pipeline->_delivered += slot.length;
+				} else {
+					pipeline->_rejected.store(true, std::memory_order_release);
+				}
+			}
+			pipeline->recycle(slot.index);
+		}
+		// The pipeline lives on the reader's stack; this give is the last access.
+		xSemaphoreGive(pipeline->_done);
+		vTaskDelete(nullptr);
+	}
+
+	char *_buffers;
+	size_t _bufferCount;
+	size_t _bufferSize;
+	const FetchChunkCallback &_onChunk;
+	BaseType_t _coreId;
+	QueueHandle_t _freeQueue = nullptr;
+	QueueHandle_t _filledQueue = nullptr;
+	SemaphoreHandle_t _done = nullptr;
+	std::atomic<bool> _rejected{false};
+	size_t _delivered = 0;
+};
+
+// ArduinoJson reader that pulls the response body from esp_http_client_read on demand.
+class FetchHttpBodyReader {
+  public:
+	// With an inflater the limit applies to decoded bytes, which are read in place from its window.
+	FetchHttpBodyReader(
+	    esp_http_client_handle_t client,
+	    char *buffer,
+	    size_t capacity,
+	    size_t limit,
+	    FetchInflater *inflater = nullptr
+	)
+	    : _client(client), _buffer(buffer), _capacity(capacity), _limit(limit), _inflater(inflater),
+	      _data(buffer) {
+	}
+
+	int read() {
+		if (_position >= _length && !fill()) {
+			return -1;
+		}
+		return static_cast<unsigned char>(_data[_position++]);
+	}
+
+	size_t readBytes(char *out, size_t length) {
+		size_t copied = 0;
+		while (copied < length) {
+			if (_position >= _length && !fill()) {
+				break;
+			}
+			const size_t chunk = std::min(length - copied, _length - _position);
+			std::memcpy(out + copied, _data + _position, chunk);
+			_position += chunk;
+			copied += chunk;
+		}
+		return copied;
+	}
+
+	esp_err_t error() const {
+		return _error;
+	}
+
+	bool truncated() const {
+		return _truncated;
+	}
+
+	size_t receivedBytes() const {
+		return _received;
+	}
+
+	// Checked before every socket read; a non-ESP_OK result ends the body with that error.
+	void stopWhen(std::function<esp_err_t()> check) {
+		_stopCheck = std::move(check);
+	}
+
+  private:
+	bool readRaw(int &readResult) {
+		const esp_err_t stopError = _stopCheck ? _stopCheck() : ESP_OK;
+		if (stopError != ESP_OK) {
+			_error = stopError;
+			_finished = true;
+			readResult = -1;
+			return false;
+		}
+		readResult = esp_http_client_read(_client, _buffer, static_cast<int>(_capacity));
+		if (readResult <= 0) {
+			if (readResult < 0 || !esp_http_client_is_complete_data_received(_client)) {
+				_error = mapStreamReadFailure(_client, readResult);
+			}
+			_finished = true;
+			return false;
+		}
+		return true;
+	}
+
+	bool accept(const char *data, size_t length) {
+		const size_t remaining = _limit > _received ? _limit - _received : 0;
+		if (length > remaining) {
+			length = remaining;
+			_truncated = true;
+			_finished = true;
+		}
+		_data = data;
+		_position = 0;
+		_length = length;
+		_received += length;
+		return length > 0;
+	}
+
+	bool fill() {
+		if (_inflater) {
+			return fillDecoded();
+		}
+		int readResult = 0;
+		if (_finished || !readRaw(readResult)) {
+			return false;
+		}
+		return accept(_buffer, static_cast<size_t>(readResult));
+	}
+
+	bool fillDecoded() {
+		while (!_finished) {
+			if (_rawLength == 0 && !_inflater->hasMoreOutput()) {
+				int readResult = 0;
+				if (_inflater->finished() || !readRaw(readResult)) {
+					_finished = true;
+					return false;
+				}
+				_raw = reinterpret_cast<const uint8_t *>(_buffer);
+				_rawLength = static_cast<size_t>(readResult);
+			}
+
+			const uint8_t *decoded = nullptr;
+			size_t decodedLength = 0;
+			const esp_err_t err = _inflater->inflate(_raw, _rawLength, decoded, decodedLength);
+			if (err != ESP_OK) {
+				_error = err;
+				_finished = true;
+				return false;
+			}
+			if (decodedLength > 0) {
+				return accept(reinterpret_cast<const char *>(decoded), decodedLength);
+			}
+		}
+		return false;
+	}
+
+	esp_http_client_handle_t _client;
+	char *_buffer;
+	size_t _capacity;
+	size_t _limit;
+	FetchInflater *_inflater;
+	const char *_data;
+	const uint8_t *_raw = nullptr;
+	size_t _rawLength = 0;
+	size_t _position = 0;
+	size_t _length = 0;
+	size_t _received = 0;
+	std::function<esp_err_t()> _stopCheck;
+	esp_err_t _error = ESP_OK;
+	bool _truncated = false;
+	bool _finished = false;
+};
 } // namespace
 
-struct ESPFetch::FetchResponse {
-	explicit FetchResponse(bool usePSRAMBuffers = false)
-	    : charAllocator(usePSRAMBuffers), headerAllocator(usePSRAMBuffers), body(charAllocator),
-	      headers(headerAllocator) {
+struct ESPFetch::FetchResponse : FetchRawResponse {
+	explicit FetchResponse(bool usePSRAMBuffers = false) : FetchRawResponse(usePSRAMBuffers) {
 	}
 
-	esp_err_t error = ESP_OK;
-	int statusCode = 0;
-	FetchAllocator<char> charAllocator;
-	FetchAllocator<InternalFetchHeader> headerAllocator;
-	FetchString body;
-	InternalFetchHeaderVector headers;
-	bool bodyTruncated = false;
-	bool headersTruncated = false;
-	int64_t durationUs = 0;
+	// Name + value bytes of the stored headers, checked against the job's headerLimit.
+	size_t headerBytes = 0;
+
+	// Parsed-body mode: the result document is built in place around the parsed body.
+	JsonDocument document;
+	DeserializationError parseError;
+};
+
+// esp_http_client handle passed from one batch request to the next one to the same origin.
+struct ESPFetch::BatchConnection {
+	FetchString key;
+	esp_http_client_handle_t client = nullptr;
+	FetchDnsName serverName; // TLS server name the handle was created with
+	bool connected = false;
+};
+
+struct FetchHandle::Control {
+	std::atomic<bool> cancelled{false};
+	std::atomic<bool> finished{false};
+};
+
+struct ESPFetch::BatchState {
+	std::vector<JsonDocument> results;
+	std::atomic<size_t> remaining{0};
+	FetchBatchCallback onDone;
+	std::shared_ptr<FetchHandle::Control> control;
+
+	// Called once per request and once by submitBatch; the last call delivers the results.
+	void finishOne() {
+		if (remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+			return;
+		}
+		invokeFetchCallback(onDone, std::move(results));
+		control->finished.store(true, std::memory_order_release);
+	}
+};
+
+// Pool workers sharing one lane's task settings and a job queue.
+struct ESPFetch::WorkerLane {
+	ESPFetch *owner = nullptr;
+	// Jobs (null = stop) guarded by owner->_schedulerMutex, counted by `available`.
+	std::deque<FetchJob *> queue;
+	SemaphoreHandle_t available = nullptr;
+	std::atomic<size_t> workers{0};
+	std::atomic<size_t> target{0};
 };
 
 struct ESPFetch::SyncHandle {
@@ -357,27 +1011,45 @@ struct ESPFetch::SyncHandle {
 	}
 
 	SemaphoreHandle_t done = nullptr;
-	bool ready = false;
+	std::atomic<bool> ready{false};
 	JsonDocument doc;
+	FetchRawResponse raw;
 };
 
 struct ESPFetch::FetchJob {
 	explicit FetchJob(const esp_fetch_detail::ResolvedFetchTransportOptions &resolvedTransport)
-	    : stringAllocator(resolvedTransport.usePSRAMBuffers), url(stringAllocator),
+	    : stringAllocator(resolvedTransport.usePSRAMBuffers), scratchAllocator(stringAllocator),
+	      url(stringAllocator),
 	      body(stringAllocator), requestOptions(resolvedTransport.usePSRAMBuffers),
-	      response(resolvedTransport.usePSRAMBuffers), transport(resolvedTransport) {
+	      response(resolvedTransport.usePSRAMBuffers), transport(resolvedTransport),
+	      connectionKey(stringAllocator), cacheEtag(stringAllocator),
+	      cacheLastModified(stringAllocator), coalescingKey(stringAllocator),
+	      circuitKey(stringAllocator), connectUrl(stringAllocator), hostHeader(stringAllocator) {
 	}
 
 	ESPFetch *owner = nullptr;
+	// Configuration the job was prepared with; updateConfig() does not affect it.
+	std::shared_ptr<const FetchConfig> config;
 	FetchAllocator<char> stringAllocator;
+	// Read buffers and other exchange-local memory; backed by the slot's arena while running.
+	FetchAllocator<char> scratchAllocator;
 	FetchString url;
 	esp_http_client_method_t method = HTTP_METHOD_GET;
 	FetchString body;
 	InternalFetchRequestOptions requestOptions;
+	FetchPriority priority = FetchPriority::Normal;
+	uint8_t lane = 0; // FetchRequestOptions::lane, validated against config->lanes
 
 	// JSON mode callback (existing APIs)
 	FetchCallback callback;
 	std::shared_ptr<SyncHandle> syncHandle;
+	bool parseBody = false;
+	bool msgPackBody = false; // the current response is application/msgpack
+
+	// Raw mode: deliver the FetchResponse itself instead of a JsonDocument.
+	bool rawResult = false;
+	FetchRawCallback rawCallback;
+	JsonDocument bodyFilter;
 
 	// Limits (used differently depending on mode)
 	size_t bodyLimit = 0;
@@ -387,6 +1059,56 @@ struct ESPFetch::FetchJob {
 	FetchResponse response;
 	esp_fetch_detail::ResolvedFetchTransportOptions transport;
 
+	// Connection pool key; empty when the job must not share connections.
+	FetchString connectionKey;
+	bool tlsSessionCapable = false;
+
+	// Response cache: validators and Cache-Control captured from this response.
+	bool cacheable = false;
+	FetchString cacheEtag;
+	FetchString cacheLastModified;
+	esp_fetch_detail::FetchCacheControl cacheControl;
+
+	// Coalescing: identical GETs that attached to this job and get a copy of its result.
+	struct CoalescedWaiter {
+		FetchCallback callback;
+		std::shared_ptr<SyncHandle> syncHandle;
+		std::shared_ptr<FetchHandle::Control> control;
+	};
+	bool coalescable = false;
+	bool coalescing = false; // registered in ESPFetch::_coalescingJobs
+	FetchString coalescingKey;
+	std::vector<CoalescedWaiter> coalescedWaiters;
+
+	// Circuit breaker origin ("scheme://host:port"); empty when the breaker is off.
+	FetchString circuitKey;
+
+	// DNS cache: url with the host replaced by its cached address, and the Host header to send.
+	// Empty when esp_http_client resolves the host itself. tlsServerName (HTTPS only) is dnsName.
+	// clientServerName is the name the job's handle was created with, which the handle keeps
+	// pointing at; it travels with the handle into the connection pool or the next batch request.
+	FetchString connectUrl;
+	FetchString hostHeader;
+	FetchDnsName dnsName;
+	FetchDnsName clientServerName;
+	const char *tlsServerName = nullptr;
+
+	// Batches: a group job only carries its members, which run in order in the group's slot.
+	std::vector<std::unique_ptr<FetchJob>> batchMembers;
+	bool batchMember = false;
+	FetchString batchKey; // connection settings shared by consecutive members
+	BatchConnection *batchConnection = nullptr;
+
+	// Cancellation and deadline (see FetchHandle); stopError latches the first reason seen.
+	std::shared_ptr<FetchHandle::Control> control;
+	int64_t deadlineUs = 0;
+	esp_err_t stopError = ESP_OK;
+
+	// Compressed responses: the inflater is created on the first encoded response.
+	std::unique_ptr<FetchInflater> inflater;
+	bool inflating = false; // the current response is being decoded
+	esp_err_t inflateError = ESP_OK;
+
 	// Stream mode (new APIs)
 	bool isStream = false;
 	FetchStreamStartCallback onStart;
@@ -395,43 +1117,380 @@ struct ESPFetch::FetchJob {
 	size_t receivedBytes = 0;
 	esp_err_t streamAbortError = ESP_OK;
 	bool streamStartRejected = false;
-};
-
-ESPFetch::~ESPFetch() {
-	deinit();
-}
+	// Resume state: the last parsed Content-Range and how often a broken stream may reconnect.
+	esp_fetch_detail::FetchContentRange contentRange;
+	uint8_t resumeAttempts = 0;
+	uint32_t resumeDelayMs = 0;
+
+	// Upload mode: the body comes from a producer instead of `body`.
+	bool isUpload = false;
+	FetchBodyProducer uploadProducer;
+	int64_t uploadLength = -1;
+
+	// Metrics bookkeeping (see FetchStats).
+	int64_t enqueuedUs = 0;
+	int64_t startedUs = 0;
+	size_t bytesIn = 0;
+	size_t bytesOut = 0;
+	size_t accountedHeapBytes = 0;
+	size_t memoryBytes = 0; // memoryCost() reserved with the slot
+#if ESP_FETCH_ENABLE_TRACE
+	uint32_t traceJob = 0;
+	bool traceHeadersPending = false; // the next response header starts a new response
+#endif
 
-bool ESPFetch::init(const FetchConfig &config) {
-	if (isInitialized()) {
-		deinit();
+	bool isBatchGroup() const {
+		return !batchMembers.empty();
 	}
 
-	if (config.maxConcurrentRequests == 0) {
-		ESP_LOGE(TAG, "maxConcurrentRequests must be > 0");
-		return false;
+	// The URL handed to esp_http_client.
+	const char *clientUrl() const {
+		return connectUrl.empty() ? url.c_str() : connectUrl.c_str();
 	}
 
-	_config = config;
-	_slotSemaphore =
-	    xSemaphoreCreateCounting(_config.maxConcurrentRequests, _config.maxConcurrentRequests);
-	if (!_slotSemaphore) {
-		ESP_LOGE(TAG, "Failed to create fetch semaphore");
-		return false;
+	// Buffered jobs collect the response body in response.body; HEAD responses have none.
+	bool buffersBody() const {
+		return !parseBody && method != HTTP_METHOD_HEAD;
 	}
 
-	_teardownRequested.store(false, std::memory_order_release);
-	_initialized.store(true, std::memory_order_release);
-	return true;
-}
+	// Jobs that drive esp_http_client_open/read themselves instead of esp_http_client_perform.
+	bool usesReadLoop() const {
+		return isStream || parseBody || isUpload;
+	}
 
-void ESPFetch::deinit() {
+	// Estimated heap held by the job: the job itself plus its growable buffers.
+	size_t heapFootprint() const {
+		size_t bytes = sizeof(FetchJob) + url.capacity() + body.capacity() +
+		               response.body.capacity() + response.headerBytes +
+		               response.headers.capacity() * sizeof(InternalFetchHeader) +
+		               requestOptions.headers.capacity() * sizeof(InternalFetchHeader);
+		if (isStream && requestOptions.streamBufferCount > 1) {
+			if (requestOptions.streamBuffers == nullptr) {
+				const size_t ringBufferSize = requestOptions.streamBufferSize
+				                                  ? requestOptions.streamBufferSize
+				                                  : resolveReadBufferSize(transport);
+				bytes += requestOptions.streamBufferCount * ringBufferSize;
+			}
+		} else if (usesReadLoop()) {
+			bytes += resolveReadBufferSize(transport);
+		}
+		if (requestOptions.acceptCompressed) {
+			bytes += FetchInflater::footprint();
+		}
+		if (isUpload && requestOptions.compressBody != FetchBodyEncoding::Identity) {
+			bytes += FetchDeflater::footprint();
+		}
+		return bytes;
+	}
+
+	// Estimated internal RAM the job needs while it runs (FetchConfig::memoryBudgetBytes): the
+	// client, its buffers and TLS session, tasks started for it, ESPFetch-owned buffers unless
+	// they are placed in PSRAM, and the result document built from the body.
+	size_t memoryCost() const {
+		if (isBatchGroup()) {
+			// Members run one after another in the group's slot.
+			size_t bytes = 0;
+			for (const auto &member : batchMembers) {
+				bytes = std::max(bytes, member->memoryCost());
+			}
+			return bytes;
+		}
+		size_t bytes = FETCH_CLIENT_HEAP_BYTES + clientBufferBytes(transport.rxBufferSize) +
+		               clientBufferBytes(transport.txBufferSize);
+		if (isHttpsUrl(url)) {
+			bytes += FETCH_TLS_SESSION_HEAP_BYTES;
+		}
+		const size_t stackBytes = esp_fetch_detail::fetchLaneSettings(*config, lane).stackSize;
+		if (!config->useWorkerPool) {
+			bytes += stackBytes;
+		}
+		if (isStream && requestOptions.streamBufferCount > 1) {
+			bytes += stackBytes; // consumer task
+		}
+		// Streams hand chunks out as they arrive; unbounded bodies cannot be estimated.
+		const bool bodyBounded = bodyLimit != std::numeric_limits<size_t>::max();
+		const size_t bodyBytes =
+		    isStream || method == HTTP_METHOD_HEAD || !bodyBounded ? 0 : bodyLimit;
+		if (!transport.usePSRAMBuffers) {
+			bytes += heapFootprint() + (buffersBody() ? bodyBytes : 0);
+		}
+		if (!rawResult) {
+			bytes += bodyBytes; // result["body"] or result["json"]
+		}
+		return bytes;
+	}
+};
+
+struct FetchRequestTemplate::Prepared {
+	explicit Prepared(const esp_fetch_detail::ResolvedFetchTransportOptions &resolvedTransport)
+	    : transport(resolvedTransport), url(FetchAllocator<char>(resolvedTransport.usePSRAMBuffers)),
+	      requestOptions(resolvedTransport.usePSRAMBuffers) {
+	}
+
+	const ESPFetch *owner = nullptr;
+	// Snapshot `transport` was resolved against; a newer config re-resolves it per submit.
+	std::shared_ptr<const FetchConfig> config;
+	esp_fetch_detail::ResolvedFetchTransportOptions transport;
+	FetchString url;
+	bool urlHasQuery = false;
+	esp_http_client_method_t method = HTTP_METHOD_GET;
+	// Copied into each job; the header strings themselves live in requestOptions.sharedHeaders.
+	InternalFetchRequestOptions requestOptions;
+	// Per-job flags (priority, caching, parsing); the header lists are already compiled.
+	FetchRequestOptions options;
+};
+
+const FetchString *FetchRawResponse::header(const char *name) const {
+	for (const auto &entry : headers) {
+		if (equalsIgnoreCase(entry.name, name)) {
+			return &entry.value;
+		}
+	}
+	return nullptr;
+}
+
+bool FetchHandle::cancel() const {
+	if (!_control || _control->finished.load(std::memory_order_acquire)) {
+		return false;
+	}
+	_control->cancelled.store(true, std::memory_order_release);
+	return true;
+}
+
+bool FetchHandle::cancelled() const {
+	return _control && _control->cancelled.load(std::memory_order_acquire);
+}
+
+bool FetchHandle::finished() const {
+	return _control && _control->finished.load(std::memory_order_acquire);
+}
+
+size_t FetchBodyWriter::write(uint8_t value) {
+	return write(&value, 1);
+}
+
+size_t FetchBodyWriter::write(const uint8_t *buffer, size_t size) {
+	if (!buffer || size == 0 || _error != ESP_OK) {
+		return 0;
+	}
+	if (_contentLength >= 0 && _written + size > static_cast<uint64_t>(_contentLength)) {
+		ESP_LOGE(TAG, "Upload body exceeds declared length %lld", (long long)_contentLength);
+		_error = ESP_ERR_INVALID_SIZE;
+		return 0;
+	}
+
+	if (_pendingLength + size > kCoalesceBytes && !flushPending()) {
+		return 0;
+	}
+	if (size <= kCoalesceBytes) {
+		std::memcpy(_pending + _pendingLength, buffer, size);
+		_pendingLength += size;
+	} else if (!forward(buffer, size)) {
+		return 0;
+	}
+	_written += size;
+	return size;
+}
+
+bool FetchBodyWriter::flushPending() {
+	if (_pendingLength == 0) {
+		return _error == ESP_OK;
+	}
+	const size_t length = _pendingLength;
+	_pendingLength = 0;
+	return forward(_pending, length);
+}
+
+bool FetchBodyWriter::forward(const uint8_t *data, size_t size) {
+	if (_deflater == nullptr) {
+		return send(reinterpret_cast<const char *>(data), size);
+	}
+	if (!_deflater->write(data, size)) {
+		if (_error == ESP_OK) {
+			_error = ESP_ERR_INVALID_STATE;
+		}
+		return false;
+	}
+	return true;
+}
+
+bool FetchBodyWriter::sendEncoded(void *context, const uint8_t *data, size_t size) {
+	return static_cast<FetchBodyWriter *>(context)->send(reinterpret_cast<const char *>(data), size);
+}
+
+bool FetchBodyWriter::send(const char *data, size_t size) {
+	if (_error != ESP_OK) {
+		return false;
+	}
+	auto writeAll = [this](const char *bytes, size_t length) {
+		if (esp_http_client_write(_client, bytes, static_cast<int>(length)) !=
+		    static_cast<int>(length)) {
+			_error = ESP_ERR_HTTP_WRITE_DATA;
+			return false;
+		}
+		return true;
+	};
+
+	_sent += size;
+	if (!chunked()) {
+		return writeAll(data, size);
+	}
+
+	// esp_http_client only announces chunked encoding; the framing is ours.
+	char sizeLine[12];
+	const int sizeLineLength = std::snprintf(sizeLine, sizeof(sizeLine), "%x\r\n", (unsigned)size);
+	return writeAll(sizeLine, static_cast<size_t>(sizeLineLength)) && writeAll(data, size) &&
+	       writeAll("\r\n", 2);
+}
+
+bool FetchBodyWriter::finish() {
+	if (!flushPending()) {
+		return false;
+	}
+	if (_contentLength >= 0 && _written != static_cast<uint64_t>(_contentLength)) {
+		ESP_LOGE(
+		    TAG,
+		    "Upload body ended after %u of %lld declared bytes",
+		    (unsigned)_written,
+		    (long long)_contentLength
+		);
+		_error = ESP_ERR_INVALID_SIZE;
+		return false;
+	}
+	if (_deflater != nullptr && !_deflater->finish()) {
+		if (_error == ESP_OK) {
+			_error = ESP_ERR_INVALID_STATE;
+		}
+		return false;
+	}
+	if (chunked() && esp_http_client_write(_client, "0\r\n\r\n", 5) != 5) {
+		_error = ESP_ERR_HTTP_WRITE_DATA;
+		return false;
+	}
+	return true;
+}
+
+// Out of line because the worker lanes are only defined in this file.
+ESPFetch::ESPFetch() = default;
+
+ESPFetch::~ESPFetch() {
+	deinit();
+}
+
+bool ESPFetch::init(const FetchConfig &config) {
+	if (isInitialized()) {
+		deinit();
+	}
+
+	if (!validateFetchConfig(config)) {
+		return false;
+	}
+
+	_config = std::make_shared<const FetchConfig>(config);
+	publishSchedulingLimits(config);
+	_schedulerMutex = xSemaphoreCreateMutex();
+	// Not sized from this config: updateConfig() can add slots later.
+	_slotReleased = xSemaphoreCreateCounting(FETCH_WORK_SIGNAL_LIMIT, 0);
+	if (!_schedulerMutex || !_slotReleased) {
+		ESP_LOGE(TAG, "Failed to create fetch semaphore");
+		deleteSchedulerSemaphores(_schedulerMutex, _slotReleased);
+		return false;
+	}
+	_runningJobs = 0;
+	_slotWaiters = 0;
+	_stats.reset();
+
+	if (config.tlsSessionCacheEntries > 0 && !esp_fetch_detail::fetchHasTlsSessionTicketSupport()) {
+		ESP_LOGW(
+		    TAG,
+		    "tlsSessionCacheEntries needs CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS for resumption; "
+		    "cached handles will still skip client re-initialization"
+		);
+	}
+
+	if (!_connectionPool.begin(
+	        config.maxIdleConnections,
+	        config.idleConnectionTimeoutMs,
+	        config.tlsSessionCacheEntries,
+	        config.usePSRAMBuffers
+	    )) {
+		deleteSchedulerSemaphores(_schedulerMutex, _slotReleased);
+		return false;
+	}
+
+	if (!_responseCache.begin(
+	        config.responseCacheEntries,
+	        config.responseCacheBytes,
+	        config.usePSRAMBuffers
+	    )) {
+		_connectionPool.end();
+		deleteSchedulerSemaphores(_schedulerMutex, _slotReleased);
+		return false;
+	}
+
+	if (!_arenaPool.begin(
+	        config.maxConcurrentRequests,
+	        config.jobArenaBytes,
+	        config.usePSRAMBuffers
+	    )) {
+		_responseCache.end();
+		_connectionPool.end();
+		deleteSchedulerSemaphores(_schedulerMutex, _slotReleased);
+		return false;
+	}
+
+	if (!_circuitBreaker.begin(
+	        config.circuitBreakerHosts,
+	        config.circuitBreakerThreshold,
+	        config.circuitBreakerOpenMs,
+	        config.usePSRAMBuffers
+	    )) {
+		_arenaPool.end();
+		_responseCache.end();
+		_connectionPool.end();
+		deleteSchedulerSemaphores(_schedulerMutex, _slotReleased);
+		return false;
+	}
+
+	if (!_dnsCache.begin(
+	        config.dnsCacheEntries,
+	        config.dnsCacheTtlMs,
+	        config.dnsNegativeTtlMs,
+	        config.usePSRAMBuffers
+	    )) {
+		_circuitBreaker.end();
+		_arenaPool.end();
+		_responseCache.end();
+		_connectionPool.end();
+		deleteSchedulerSemaphores(_schedulerMutex, _slotReleased);
+		return false;
+	}
+
+	if (config.useWorkerPool && !startWorkerPool(config)) {
+		_dnsCache.end();
+		_circuitBreaker.end();
+		_arenaPool.end();
+		_responseCache.end();
+		_connectionPool.end();
+		deleteSchedulerSemaphores(_schedulerMutex, _slotReleased);
+		return false;
+	}
+
+	_teardownRequested.store(false, std::memory_order_release);
+	_initialized.store(true, std::memory_order_release);
+	startDnsPrefetch(config);
+	return true;
+}
+
+void ESPFetch::deinit() {
 	if (!isInitialized() && _activeTasks.load(std::memory_order_acquire) == 0 &&
-	    _slotSemaphore == nullptr) {
+	    _schedulerMutex == nullptr) {
 		return;
 	}
 
 	_teardownRequested.store(true, std::memory_order_release);
 	_initialized.store(false, std::memory_order_release);
+	failPendingJobs();
 
 	while (_activeTasks.load(std::memory_order_acquire) > 0) {
 #if defined(INCLUDE_xTaskGetSchedulerState) && (INCLUDE_xTaskGetSchedulerState == 1)
@@ -442,70 +1501,175 @@ void ESPFetch::deinit() {
 		vTaskDelay(pdMS_TO_TICKS(1));
 	}
 
-	if (_slotSemaphore) {
-		vSemaphoreDelete(_slotSemaphore);
-		_slotSemaphore = nullptr;
-	}
+	stopWorkerPool();
+	_connectionPool.end();
+	_responseCache.end();
+	_arenaPool.end();
+	_circuitBreaker.end();
+	_dnsCache.end();
+
+	deleteSchedulerSemaphores(_schedulerMutex, _slotReleased);
 
 	_teardownRequested.store(false, std::memory_order_release);
 }
 
+bool ESPFetch::updateConfig(const FetchConfig &config) {
+	if (!isInitialized()) {
+		ESP_LOGE(TAG, "ESPFetch not initialized");
+		return false;
+	}
+	if (!validateFetchConfig(config)) {
+		return false;
+	}
+	const std::shared_ptr<const FetchConfig> current = configSnapshot();
+	if (esp_fetch_detail::fetchConfigNeedsInit(*current, config)) {
+		ESP_LOGE(
+		    TAG,
+		    "updateConfig cannot change the worker pool mode, lanes, connection pool, response "
+		    "cache, job arenas, circuit breaker or DNS cache; call init()"
+		);
+		return false;
+	}
+
+	auto next = std::make_shared<const FetchConfig>(config);
+	if (config.useWorkerPool && !resizeWorkerPool(config)) {
+		// Workers spawned for the rejected size retire once idle.
+		_workerLanes.front()->target.store(
+		    current->maxConcurrentRequests,
+		    std::memory_order_release
+		);
+		return false;
+	}
+	{
+		SchedulerLock lock(_schedulerMutex);
+		_config = std::move(next);
+		publishSchedulingLimits(config);
+	}
+
+	if (config.maxConcurrentRequests > current->maxConcurrentRequests ||
+	    memoryLimitsRelaxed(*current, config)) {
+		// New slots or budget: start parked requests and wake callers blocked in waitForSlot.
+		startPendingJobs();
+		wakeSlotWaiters();
+	}
+	return true;
+}
+
+FetchConfig ESPFetch::config() const {
+	const std::shared_ptr<const FetchConfig> snapshot = configSnapshot();
+	return snapshot ? *snapshot : FetchConfig{};
+}
+
+std::shared_ptr<const FetchConfig> ESPFetch::configSnapshot() const {
+	SchedulerLock lock(_schedulerMutex);
+	return _config;
+}
+
+FetchAllocator<char> ESPFetch::bodyAllocator() const {
+	const std::shared_ptr<const FetchConfig> snapshot = configSnapshot();
+	return FetchAllocator<char>(snapshot && snapshot->usePSRAMBuffers);
+}
+
+void ESPFetch::publishSchedulingLimits(const FetchConfig &config) {
+	_slotLimit = config.maxConcurrentRequests;
+	_reservedHighSlots = config.reservedHighPrioritySlots;
+	_pendingLimit = config.pendingQueueSize;
+	_memoryBudget = config.memoryBudgetBytes;
+	_minFreeHeap = config.minFreeHeapBytes;
+}
+
 bool ESPFetch::isInitialized() const {
 	return _initialized.load(std::memory_order_acquire);
 }
 
-bool ESPFetch::get(const char *url, FetchCallback callback, const FetchRequestOptions &options) {
+size_t ESPFetch::pendingRequests() const {
+	return _pendingCount.load(std::memory_order_acquire);
+}
+
+FetchStats ESPFetch::stats() const {
+	FetchStats stats = _stats.snapshot();
+	stats.openCircuits = _circuitBreaker.openCircuits();
+	return stats;
+}
+
+void ESPFetch::resetStats() {
+	_stats.reset();
+}
+
+size_t ESPFetch::traceSnapshot(FetchTraceRecord *out, size_t capacity) const {
+#if ESP_FETCH_ENABLE_TRACE
+	return _trace.snapshot(out, capacity);
+#else
+	(void)out;
+	(void)capacity;
+	return 0;
+#endif
+}
+
+void ESPFetch::dumpTrace(Print &out) const {
+#if ESP_FETCH_ENABLE_TRACE
+	// Copied out first, so printing does not hold up requests writing to the ring.
+	auto records = std::make_unique<FetchTraceRecord[]>(FetchTraceBuffer::kCapacity);
+	const size_t count = _trace.snapshot(records.get(), FetchTraceBuffer::kCapacity);
+	for (size_t i = 0; i < count; ++i) {
+		const FetchTraceRecord &record = records[i];
+		char line[64];
+		const int length = snprintf(
+		    line,
+		    sizeof(line),
+		    "%lld job=%u %s %u\n",
+		    static_cast<long long>(record.timeUs),
+		    static_cast<unsigned>(record.job),
+		    FetchTraceBuffer::eventName(record.event),
+		    static_cast<unsigned>(record.value)
+		);
+		if (length > 0) {
+			out.write(
+			    reinterpret_cast<const uint8_t *>(line),
+			    std::min(static_cast<size_t>(length), sizeof(line) - 1)
+			);
+		}
+	}
+#else
+	(void)out;
+#endif
+}
+
+void ESPFetch::clearTrace() {
+#if ESP_FETCH_ENABLE_TRACE
+	_trace.clear();
+#endif
+}
+
+FetchHandle
+ESPFetch::get(const char *url, FetchCallback callback, const FetchRequestOptions &options) {
 	if (!url) {
-		return false;
+		return FetchHandle();
 	}
 	return enqueueRequest(
 	    url,
 	    HTTP_METHOD_GET,
-	    FetchString{FetchAllocator<char>(_config.usePSRAMBuffers)},
+	    FetchString{bodyAllocator()},
 	    std::move(callback),
 	    nullptr,
 	    options
 	);
 }
 
-bool ESPFetch::get(const String &url, FetchCallback callback, const FetchRequestOptions &options) {
+FetchHandle
+ESPFetch::get(const String &url, FetchCallback callback, const FetchRequestOptions &options) {
 	return get(url.c_str(), std::move(callback), options);
 }
 
 JsonDocument
 ESPFetch::get(const char *url, TickType_t waitTicks, const FetchRequestOptions &options) {
-	if (!url) {
-		JsonDocument doc;
-		doc["ok"] = false;
-		doc["error"]["message"] = "url is null";
-		return doc;
-	}
-	auto handle = std::make_shared<SyncHandle>();
-	handle->done = xSemaphoreCreateBinary();
-	if (!handle->done) {
-		JsonDocument doc;
-		doc["ok"] = false;
-		doc["error"]["message"] = "failed to allocate sync semaphore";
-		return doc;
-	}
-
-	const char *startError = nullptr;
-	if (!enqueueRequest(
-	        url,
-	        HTTP_METHOD_GET,
-	        FetchString{FetchAllocator<char>(_config.usePSRAMBuffers)},
-	        nullptr,
-	        handle,
-	        options,
-	        &startError
-	    )) {
-		JsonDocument doc;
-		doc["ok"] = false;
-		doc["error"]["message"] = startError ? startError : "failed to start http get";
-		return doc;
-	}
-
-	return waitForResult(handle, waitTicks);
+	return requestSync(
+	    HTTP_METHOD_GET,
+	    url,
+	    FetchString{bodyAllocator()},
+	    waitTicks,
+	    options
+	);
 }
 
 JsonDocument
@@ -513,18 +1677,17 @@ ESPFetch::get(const String &url, TickType_t waitTicks, const FetchRequestOptions
 	return get(url.c_str(), waitTicks, options);
 }
 
-bool ESPFetch::post(
+FetchHandle ESPFetch::post(
     const char *url,
     const JsonDocument &payload,
     FetchCallback callback,
     const FetchRequestOptions &options
 ) {
 	if (!url) {
-		return false;
+		return FetchHandle();
 	}
-	FetchString body{FetchAllocator<char>(_config.usePSRAMBuffers)};
-	FetchStringWriter writer(body);
-	serializeJson(payload, writer);
+	FetchString body{bodyAllocator()};
+	serializeFetchPayload(payload, body, options.bodyFormat);
 	return enqueueRequest(
 	    url,
 	    HTTP_METHOD_POST,
@@ -535,7 +1698,7 @@ bool ESPFetch::post(
 	);
 }
 
-bool ESPFetch::post(
+FetchHandle ESPFetch::post(
     const String &url,
     const JsonDocument &payload,
     FetchCallback callback,
@@ -550,42 +1713,11 @@ JsonDocument ESPFetch::post(
     TickType_t waitTicks,
     const FetchRequestOptions &options
 ) {
-	if (!url) {
-		JsonDocument doc;
-		doc["ok"] = false;
-		doc["error"]["message"] = "url is null";
-		return doc;
-	}
-	FetchString body{FetchAllocator<char>(_config.usePSRAMBuffers)};
-	FetchStringWriter writer(body);
-	serializeJson(payload, writer);
-
-	auto handle = std::make_shared<SyncHandle>();
-	handle->done = xSemaphoreCreateBinary();
-	if (!handle->done) {
-		JsonDocument doc;
-		doc["ok"] = false;
-		doc["error"]["message"] = "failed to allocate sync semaphore";
-		return doc;
-	}
-
-	const char *startError = nullptr;
-	if (!enqueueRequest(
-	        url,
-	        HTTP_METHOD_POST,
-	        std::move(body),
-	        nullptr,
-	        handle,
-	        options,
-	        &startError
-	    )) {
-		JsonDocument doc;
-		doc["ok"] = false;
-		doc["error"]["message"] = startError ? startError : "failed to start http post";
-		return doc;
+	FetchString body{bodyAllocator()};
+	if (url) {
+		serializeFetchPayload(payload, body, options.bodyFormat);
 	}
-
-	return waitForResult(handle, waitTicks);
+	return requestSync(HTTP_METHOD_POST, url, std::move(body), waitTicks, options);
 }
 
 JsonDocument ESPFetch::post(
@@ -598,624 +1730,3228 @@ JsonDocument ESPFetch::post(
 }
 
 // ------------------------------
-// Stream API (new)
+// Upload API (streamed request body)
 // ------------------------------
-bool ESPFetch::getStream(
+FetchHandle ESPFetch::postStream(
     const char *url,
-    FetchChunkCallback onChunk,
-    FetchStreamCallback onDone,
+    int64_t contentLength,
+    FetchBodyProducer producer,
+    FetchCallback callback,
     const FetchRequestOptions &options
 ) {
-	if (!url || !onChunk) {
-		return false;
+	if (!url || !producer) {
+		return FetchHandle();
 	}
-	return enqueueStreamRequest(url, nullptr, std::move(onChunk), std::move(onDone), options);
+	return enqueueUploadRequest(
+	    url,
+	    HTTP_METHOD_POST,
+	    contentLength,
+	    std::move(producer),
+	    std::move(callback),
+	    options
+	);
 }
 
-bool ESPFetch::getStream(
-    const char *url,
-    FetchStreamStartCallback onStart,
-    FetchChunkCallback onChunk,
-    FetchStreamCallback onDone,
+FetchHandle ESPFetch::postStream(
+    const String &url,
+    int64_t contentLength,
+    FetchBodyProducer producer,
+    FetchCallback callback,
     const FetchRequestOptions &options
 ) {
-	if (!url || !onChunk) {
-		return false;
+	return postStream(url.c_str(), contentLength, std::move(producer), std::move(callback), options);
+}
+
+// ------------------------------
+// Raw API (FetchRawResponse)
+// ------------------------------
+FetchHandle ESPFetch::getRaw(
+    const char *url, FetchRawCallback callback, const FetchRequestOptions &options
+) {
+	if (!url) {
+		return FetchHandle();
 	}
-	return enqueueStreamRequest(
+	return enqueueRawRequest(
 	    url,
-	    std::move(onStart),
-	    std::move(onChunk),
-	    std::move(onDone),
+	    HTTP_METHOD_GET,
+	    FetchString{bodyAllocator()},
+	    std::move(callback),
+	    nullptr,
+	    options
+	);
+}
+
+FetchHandle ESPFetch::getRaw(
+    const String &url, FetchRawCallback callback, const FetchRequestOptions &options
+) {
+	return getRaw(url.c_str(), std::move(callback), options);
+}
+
+FetchRawResponse
+ESPFetch::getRaw(const char *url, TickType_t waitTicks, const FetchRequestOptions &options) {
+	return requestRawSync(
+	    HTTP_METHOD_GET,
+	    url,
+	    FetchString{bodyAllocator()},
+	    waitTicks,
+	    options
+	);
+}
+
+FetchRawResponse
+ESPFetch::getRaw(const String &url, TickType_t waitTicks, const FetchRequestOptions &options) {
+	return getRaw(url.c_str(), waitTicks, options);
+}
+
+FetchHandle ESPFetch::postRaw(
+    const char *url,
+    const JsonDocument &payload,
+    FetchRawCallback callback,
+    const FetchRequestOptions &options
+) {
+	if (!url) {
+		return FetchHandle();
+	}
+	FetchString body{bodyAllocator()};
+	serializeFetchPayload(payload, body, options.bodyFormat);
+	return enqueueRawRequest(
+	    url,
+	    HTTP_METHOD_POST,
+	    std::move(body),
+	    std::move(callback),
+	    nullptr,
+	    options
+	);
+}
+
+FetchHandle ESPFetch::postRaw(
+    const String &url,
+    const JsonDocument &payload,
+    FetchRawCallback callback,
+    const FetchRequestOptions &options
+) {
+	return postRaw(url.c_str(), payload, std::move(callback), options);
+}
+
+FetchRawResponse ESPFetch::postRaw(
+    const char *url,
+    const JsonDocument &payload,
+    TickType_t waitTicks,
+    const FetchRequestOptions &options
+) {
+	FetchString body{bodyAllocator()};
+	if (url) {
+		serializeFetchPayload(payload, body, options.bodyFormat);
+	}
+	return requestRawSync(HTTP_METHOD_POST, url, std::move(body), waitTicks, options);
+}
+
+FetchRawResponse ESPFetch::postRaw(
+    const String &url,
+    const JsonDocument &payload,
+    TickType_t waitTicks,
+    const FetchRequestOptions &options
+) {
+	return postRaw(url.c_str(), payload, waitTicks, options);
+}
+
+// ------------------------------
+// Generic methods (PUT / PATCH / DELETE / HEAD, ...)
+// ------------------------------
+FetchHandle ESPFetch::request(
+    FetchMethod method, const char *url, FetchCallback callback, const FetchRequestOptions &options
+) {
+	if (!url) {
+		return FetchHandle();
+	}
+	return enqueueRequest(
+	    url,
+	    esp_fetch_detail::toFetchHttpMethod(method),
+	    FetchString{bodyAllocator()},
+	    std::move(callback),
+	    nullptr,
+	    options
+	);
+}
+
+FetchHandle ESPFetch::request(
+    FetchMethod method,
+    const char *url,
+    const JsonDocument &payload,
+    FetchCallback callback,
+    const FetchRequestOptions &options
+) {
+	if (!url) {
+		return FetchHandle();
+	}
+	FetchString body{bodyAllocator()};
+	serializeFetchPayload(payload, body, options.bodyFormat);
+	return enqueueRequest(
+	    url,
+	    esp_fetch_detail::toFetchHttpMethod(method),
+	    std::move(body),
+	    std::move(callback),
+	    nullptr,
+	    options
+	);
+}
+
+JsonDocument ESPFetch::request(
+    FetchMethod method, const char *url, TickType_t waitTicks, const FetchRequestOptions &options
+) {
+	return requestSync(
+	    esp_fetch_detail::toFetchHttpMethod(method),
+	    url,
+	    FetchString{bodyAllocator()},
+	    waitTicks,
+	    options
+	);
+}
+
+JsonDocument ESPFetch::request(
+    FetchMethod method,
+    const char *url,
+    const JsonDocument &payload,
+    TickType_t waitTicks,
+    const FetchRequestOptions &options
+) {
+	FetchString body{bodyAllocator()};
+	if (url) {
+		serializeFetchPayload(payload, body, options.bodyFormat);
+	}
+	return requestSync(
+	    esp_fetch_detail::toFetchHttpMethod(method), url, std::move(body), waitTicks, options
+	);
+}
+
+FetchHandle ESPFetch::requestRaw(
+    FetchMethod method,
+    const char *url,
+    FetchRawCallback callback,
+    const FetchRequestOptions &options
+) {
+	if (!url) {
+		return FetchHandle();
+	}
+	return enqueueRawRequest(
+	    url,
+	    esp_fetch_detail::toFetchHttpMethod(method),
+	    FetchString{bodyAllocator()},
+	    std::move(callback),
+	    nullptr,
+	    options
+	);
+}
+
+FetchHandle ESPFetch::requestRaw(
+    FetchMethod method,
+    const char *url,
+    const JsonDocument &payload,
+    FetchRawCallback callback,
+    const FetchRequestOptions &options
+) {
+	if (!url) {
+		return FetchHandle();
+	}
+	FetchString body{bodyAllocator()};
+	serializeFetchPayload(payload, body, options.bodyFormat);
+	return enqueueRawRequest(
+	    url,
+	    esp_fetch_detail::toFetchHttpMethod(method),
+	    std::move(body),
+	    std::move(callback),
+	    nullptr,
 	    options
 	);
 }
 
-bool ESPFetch::getStream(
-    const String &url,
-    FetchChunkCallback onChunk,
-    FetchStreamCallback onDone,
-    const FetchRequestOptions &options
-) {
-	return getStream(url.c_str(), std::move(onChunk), std::move(onDone), options);
+FetchRawResponse ESPFetch::requestRaw(
+    FetchMethod method, const char *url, TickType_t waitTicks, const FetchRequestOptions &options
+) {
+	return requestRawSync(
+	    esp_fetch_detail::toFetchHttpMethod(method),
+	    url,
+	    FetchString{bodyAllocator()},
+	    waitTicks,
+	    options
+	);
+}
+
+FetchRawResponse ESPFetch::requestRaw(
+    FetchMethod method,
+    const char *url,
+    const JsonDocument &payload,
+    TickType_t waitTicks,
+    const FetchRequestOptions &options
+) {
+	FetchString body{bodyAllocator()};
+	if (url) {
+		serializeFetchPayload(payload, body, options.bodyFormat);
+	}
+	return requestRawSync(
+	    esp_fetch_detail::toFetchHttpMethod(method), url, std::move(body), waitTicks, options
+	);
+}
+
+FetchHandle ESPFetch::request(
+    FetchMethod method,
+    const String &url,
+    FetchCallback callback,
+    const FetchRequestOptions &options
+) {
+	return request(method, url.c_str(), std::move(callback), options);
+}
+
+FetchHandle ESPFetch::request(
+    FetchMethod method,
+    const String &url,
+    const JsonDocument &payload,
+    FetchCallback callback,
+    const FetchRequestOptions &options
+) {
+	return request(method, url.c_str(), payload, std::move(callback), options);
+}
+
+JsonDocument ESPFetch::request(
+    FetchMethod method, const String &url, TickType_t waitTicks, const FetchRequestOptions &options
+) {
+	return request(method, url.c_str(), waitTicks, options);
+}
+
+JsonDocument ESPFetch::request(
+    FetchMethod method,
+    const String &url,
+    const JsonDocument &payload,
+    TickType_t waitTicks,
+    const FetchRequestOptions &options
+) {
+	return request(method, url.c_str(), payload, waitTicks, options);
+}
+
+FetchHandle ESPFetch::requestRaw(
+    FetchMethod method,
+    const String &url,
+    FetchRawCallback callback,
+    const FetchRequestOptions &options
+) {
+	return requestRaw(method, url.c_str(), std::move(callback), options);
+}
+
+FetchHandle ESPFetch::requestRaw(
+    FetchMethod method,
+    const String &url,
+    const JsonDocument &payload,
+    FetchRawCallback callback,
+    const FetchRequestOptions &options
+) {
+	return requestRaw(method, url.c_str(), payload, std::move(callback), options);
+}
+
+FetchRawResponse ESPFetch::requestRaw(
+    FetchMethod method, const String &url, TickType_t waitTicks, const FetchRequestOptions &options
+) {
+	return requestRaw(method, url.c_str(), waitTicks, options);
+}
+
+FetchRawResponse ESPFetch::requestRaw(
+    FetchMethod method,
+    const String &url,
+    const JsonDocument &payload,
+    TickType_t waitTicks,
+    const FetchRequestOptions &options
+) {
+	return requestRaw(method, url.c_str(), payload, waitTicks, options);
+}
+
+JsonDocument ESPFetch::requestSync(
+    esp_http_client_method_t method,
+    const char *url,
+    FetchString &&body,
+    TickType_t waitTicks,
+    const FetchRequestOptions &options
+) {
+	if (!url) {
+		JsonDocument doc;
+		doc["ok"] = false;
+		doc["error"]["message"] = "url is null";
+		return doc;
+	}
+	auto handle = std::make_shared<SyncHandle>();
+	handle->done = xSemaphoreCreateBinary();
+	if (!handle->done) {
+		JsonDocument doc;
+		doc["ok"] = false;
+		doc["error"]["message"] = "failed to allocate sync semaphore";
+		return doc;
+	}
+
+	const char *startError = nullptr;
+	if (!enqueueRequest(url, method, std::move(body), nullptr, handle, options, &startError)) {
+		JsonDocument doc;
+		doc["ok"] = false;
+		doc["error"]["message"] = startError ? startError : fetchStartFailureMessage(method);
+		return doc;
+	}
+
+	return waitForResult(handle, waitTicks);
+}
+
+FetchRawResponse ESPFetch::requestRawSync(
+    esp_http_client_method_t method,
+    const char *url,
+    FetchString &&body,
+    TickType_t waitTicks,
+    const FetchRequestOptions &options
+) {
+	FetchRawResponse failed;
+	if (!url) {
+		failed.error = ESP_ERR_INVALID_ARG;
+		return failed;
+	}
+	auto handle = std::make_shared<SyncHandle>();
+	handle->done = xSemaphoreCreateBinary();
+	if (!handle->done) {
+		failed.error = ESP_ERR_NO_MEM;
+		return failed;
+	}
+
+	// Prepared and admitted separately so a rejected request reports ESP_ERR_INVALID_ARG, like a
+	// null url, while one that was valid but could not start reports ESP_FAIL. Both paths log
+	// the reason.
+	auto job = prepareRequestJob(url, method, std::move(body), options, true, nullptr);
+	if (!job) {
+		failed.error = isInitialized() ? ESP_ERR_INVALID_ARG : ESP_ERR_INVALID_STATE;
+		return failed;
+	}
+	job->syncHandle = handle;
+	trackJob(*job);
+	if (!admitJob(std::move(job), nullptr)) {
+		failed.error = ESP_FAIL;
+		return failed;
+	}
+
+	return waitForRawResult(handle, waitTicks);
+}
+
+// ------------------------------
+// Prepared requests
+// ------------------------------
+FetchRequestTemplate ESPFetch::prepareGet(const char *url, const FetchRequestOptions &options) {
+	return prepareTemplate(url, HTTP_METHOD_GET, options);
+}
+
+FetchRequestTemplate ESPFetch::prepareGet(const String &url, const FetchRequestOptions &options) {
+	return prepareTemplate(url.c_str(), HTTP_METHOD_GET, options);
+}
+
+FetchRequestTemplate ESPFetch::preparePost(const char *url, const FetchRequestOptions &options) {
+	return prepareTemplate(url, HTTP_METHOD_POST, options);
+}
+
+FetchRequestTemplate ESPFetch::preparePost(const String &url, const FetchRequestOptions &options) {
+	return prepareTemplate(url.c_str(), HTTP_METHOD_POST, options);
+}
+
+FetchRequestTemplate
+ESPFetch::prepare(FetchMethod method, const char *url, const FetchRequestOptions &options) {
+	return prepareTemplate(url, esp_fetch_detail::toFetchHttpMethod(method), options);
+}
+
+FetchRequestTemplate
+ESPFetch::prepare(FetchMethod method, const String &url, const FetchRequestOptions &options) {
+	return prepareTemplate(url.c_str(), esp_fetch_detail::toFetchHttpMethod(method), options);
+}
+
+FetchHandle ESPFetch::submit(
+    const FetchRequestTemplate &request, FetchCallback callback, const char *query
+) {
+	return submitTemplate(
+	    request,
+	    FetchString{bodyAllocator()},
+	    query,
+	    std::move(callback),
+	    nullptr,
+	    false
+	);
+}
+
+FetchHandle ESPFetch::submit(
+    const FetchRequestTemplate &request,
+    const JsonDocument &payload,
+    FetchCallback callback,
+    const char *query
+) {
+	if (!request.ok()) {
+		return submitTemplate(request, FetchString{}, query, std::move(callback), nullptr, false);
+	}
+	FetchString body{bodyAllocator()};
+	serializeFetchPayload(payload, body, request._prepared->options.bodyFormat);
+	return submitTemplate(request, std::move(body), query, std::move(callback), nullptr, false);
+}
+
+FetchHandle ESPFetch::submitRaw(
+    const FetchRequestTemplate &request, FetchRawCallback callback, const char *query
+) {
+	return submitTemplate(
+	    request,
+	    FetchString{bodyAllocator()},
+	    query,
+	    nullptr,
+	    std::move(callback),
+	    true
+	);
+}
+
+FetchRequestTemplate ESPFetch::prepareTemplate(
+    const char *url, esp_http_client_method_t method, const FetchRequestOptions &options
+) {
+	FetchRequestTemplate request;
+	if (!url) {
+		request._error = "url is null";
+		return request;
+	}
+
+	std::shared_ptr<const FetchConfig> config;
+	std::string normalizedUrl;
+	esp_fetch_detail::ResolvedFetchTransportOptions resolvedTransport;
+	if (!resolveRequestTarget(
+	        url, options, config, normalizedUrl, resolvedTransport, &request._error
+	    )) {
+		return request;
+	}
+
+	auto prepared = std::make_shared<FetchRequestTemplate::Prepared>(resolvedTransport);
+	prepared->owner = this;
+	prepared->config = std::move(config);
+	prepared->url.assign(normalizedUrl.c_str(), normalizedUrl.size());
+	prepared->urlHasQuery = normalizedUrl.find('?') != std::string::npos;
+	prepared->method = method;
+	populateInternalFetchRequestOptions(prepared->requestOptions, options);
+	auto headers = std::make_shared<InternalFetchHeaderVector>(
+	    FetchAllocator<InternalFetchHeader>(resolvedTransport.usePSRAMBuffers)
+	);
+	buildFetchRequestHeaders(
+	    *headers,
+	    options,
+	    FetchAllocator<char>(resolvedTransport.usePSRAMBuffers)
+	);
+	prepared->requestOptions.sharedHeaders = std::move(headers);
+	prepared->options = options;
+	prepared->options.headers.clear();
+	prepared->options.headers.shrink_to_fit();
+	prepared->options.captureHeaders.clear();
+	prepared->options.captureHeaders.shrink_to_fit();
+	request._prepared = std::move(prepared);
+	return request;
+}
+
+FetchHandle ESPFetch::submitTemplate(
+    const FetchRequestTemplate &request,
+    FetchString &&body,
+    const char *query,
+    FetchCallback callback,
+    FetchRawCallback rawCallback,
+    bool rawResult
+) {
+	const FetchRequestTemplate::Prepared *prepared = request._prepared.get();
+	if (prepared == nullptr) {
+		ESP_LOGE(
+		    TAG,
+		    "Request template is not prepared: %s",
+		    request._error ? request._error : "empty template"
+		);
+		return FetchHandle();
+	}
+	if (prepared->owner != this) {
+		ESP_LOGE(TAG, "Request template belongs to another ESPFetch instance");
+		return FetchHandle();
+	}
+	if (!isInitialized()) {
+		ESP_LOGE(TAG, "ESPFetch not initialized");
+		return FetchHandle();
+	}
+
+	std::shared_ptr<const FetchConfig> config = configSnapshot();
+	esp_fetch_detail::ResolvedFetchTransportOptions transport = prepared->transport;
+	if (config != prepared->config) {
+		// init() or updateConfig() ran since the template was prepared.
+		transport = resolveFetchTransportOptionsForJob(*config, prepared->options);
+		const char *transportError = esp_fetch_detail::validateFetchTransportOptions(
+		    std::string(prepared->url.c_str(), prepared->url.size()), transport
+		);
+		if (transportError == nullptr) {
+			// The lane may be gone from the new config.
+			transportError = validateFetchLane(*config, prepared->options.lane);
+		}
+		if (transportError != nullptr) {
+			ESP_LOGE(TAG, "Rejected request for %s: %s", prepared->url.c_str(), transportError);
+			return FetchHandle();
+		}
+	}
+
+	auto job = std::make_unique<FetchJob>(transport);
+	job->owner = this;
+	job->config = std::move(config);
+	job->enqueuedUs = esp_timer_get_time();
+	const size_t queryLength = query ? std::strlen(query) : 0;
+	job->url.reserve(prepared->url.size() + (queryLength ? queryLength + 1 : 0));
+	job->url.append(prepared->url.data(), prepared->url.size());
+	if (queryLength > 0) {
+		job->url.push_back(prepared->urlHasQuery ? '&' : '?');
+		job->url.append(query, queryLength);
+	}
+	job->method = prepared->method;
+	job->body = std::move(body);
+	job->requestOptions = prepared->requestOptions;
+	applyRequestOptions(*job, prepared->options, rawResult);
+
+	FetchHandle handle = trackJob(*job);
+	if (rawResult) {
+		job->rawCallback = std::move(rawCallback);
+	} else {
+		job->callback = std::move(callback);
+		if (job->coalescable && attachToInflightJob(job)) {
+			return handle;
+		}
+	}
+	return admitJob(std::move(job), nullptr) ? handle : FetchHandle();
+}
+
+// ------------------------------
+// Batches
+// ------------------------------
+FetchHandle
+ESPFetch::submitBatch(std::vector<FetchBatchRequest> requests, FetchBatchCallback onDone) {
+	if (!isInitialized()) {
+		ESP_LOGE(TAG, "ESPFetch not initialized");
+		return FetchHandle();
+	}
+	if (requests.empty() || !onDone) {
+		return FetchHandle();
+	}
+
+	auto batch = std::make_shared<BatchState>();
+	batch->results.resize(requests.size());
+	// The extra count keeps onDone from running before every group has been submitted.
+	batch->remaining.store(requests.size() + 1, std::memory_order_relaxed);
+	batch->onDone = std::move(onDone);
+	batch->control = std::make_shared<FetchHandle::Control>();
+
+	// Requests to one origin with identical connection settings and lane form a group, in request
+	// order.
+	std::vector<std::vector<std::unique_ptr<FetchJob>>> groups;
+	for (size_t i = 0; i < requests.size(); ++i) {
+		const FetchBatchRequest &request = requests[i];
+		const esp_http_client_method_t method = esp_fetch_detail::toFetchHttpMethod(request.method);
+		FetchString body{bodyAllocator()};
+		if (!request.payload.isNull()) {
+			serializeFetchPayload(request.payload, body, request.options.bodyFormat);
+		}
+		const char *startError = nullptr;
+		auto job = prepareRequestJob(
+		    request.url, method, std::move(body), request.options, false, &startError
+		);
+		if (!job) {
+			batch->results[i] = buildStartFailureResult(
+			    request.url, startError ? startError : fetchStartFailureMessage(method)
+			);
+			batch->finishOne();
+			continue;
+		}
+
+		job->batchMember = true;
+		job->coalescable = false;
+		job->control = batch->control;
+		job->callback = [batch, i](JsonDocument result) {
+			batch->results[i] = std::move(result);
+			batch->finishOne();
+		};
+		esp_fetch_detail::FetchUrlOrigin origin;
+		if (esp_fetch_detail::parseFetchUrlOrigin(
+		        std::string(job->url.c_str(), job->url.size()), origin
+		    )) {
+			job->batchKey = buildConnectionKey(
+			    origin,
+			    job->transport,
+			    !(job->requestOptions.allowRedirects && job->config->followRedirects),
+			    job->stringAllocator
+			);
+		} else {
+			job->batchKey.assign(job->url.c_str(), job->url.size());
+		}
+		// A group runs on one task, so members of different lanes never share it.
+		char laneTag[8];
+		snprintf(laneTag, sizeof(laneTag), "#%u", static_cast<unsigned>(job->lane));
+		job->batchKey.append(laneTag);
+		job->accountedHeapBytes = job->heapFootprint();
+		_stats.addJobHeap(job->accountedHeapBytes);
+		ESP_FETCH_TRACE_JOB(_trace, job->traceJob);
+		ESP_FETCH_TRACE(_trace, FetchTraceEvent::Enqueued, job->traceJob, job->priority);
+
+		auto group = std::find_if(groups.begin(), groups.end(), [&job](const auto &members) {
+			return members.front()->batchKey == job->batchKey;
+		});
+		if (group == groups.end()) {
+			groups.emplace_back();
+			group = groups.end() - 1;
+		}
+		group->push_back(std::move(job));
+	}
+
+	// Origins beyond maxConcurrentRequests share a slot with an earlier origin of the same lane
+	// and run after it, spread evenly over that lane's slots. A lane without a slot yet gets its
+	// own even past the limit, since its members need that lane's task settings; admission then
+	// treats it like any request beyond maxConcurrentRequests.
+	struct BatchSlot {
+		std::unique_ptr<FetchJob> job;
+		size_t origins = 0;
+	};
+	const size_t slotLimit = configSnapshot()->maxConcurrentRequests;
+	std::vector<BatchSlot> slots;
+	for (auto &members : groups) {
+		const FetchJob &first = *members.front();
+		BatchSlot *slot = nullptr;
+		if (slots.size() >= slotLimit) {
+			for (BatchSlot &candidate : slots) {
+				if (candidate.job->lane == first.lane &&
+				    (slot == nullptr || candidate.origins < slot->origins)) {
+					slot = &candidate;
+				}
+			}
+		}
+		if (slot == nullptr) {
+			slots.emplace_back();
+			slot = &slots.back();
+			slot->job = std::make_unique<FetchJob>(first.transport);
+			slot->job->owner = this;
+			slot->job->config = first.config;
+			slot->job->enqueuedUs = esp_timer_get_time();
+			slot->job->priority = FetchPriority::Low;
+			slot->job->lane = first.lane;
+		}
+		++slot->origins;
+		for (auto &member : members) {
+			slot->job->priority = std::max(slot->job->priority, member->priority);
+			slot->job->batchMembers.push_back(std::move(member));
+		}
+	}
+	for (BatchSlot &slot : slots) {
+		// A rejected group completes its requests with an error result.
+		admitJob(std::move(slot.job), nullptr);
+	}
+
+	batch->finishOne();
+	return FetchHandle(batch->control);
+}
+
+// ------------------------------
+// Stream API (new)
+// ------------------------------
+FetchHandle ESPFetch::getStream(
+    const char *url,
+    FetchChunkCallback onChunk,
+    FetchStreamCallback onDone,
+    const FetchRequestOptions &options
+) {
+	if (!url || !onChunk) {
+		return FetchHandle();
+	}
+	return enqueueStreamRequest(url, nullptr, std::move(onChunk), std::move(onDone), options);
+}
+
+FetchHandle ESPFetch::getStream(
+    const char *url,
+    FetchStreamStartCallback onStart,
+    FetchChunkCallback onChunk,
+    FetchStreamCallback onDone,
+    const FetchRequestOptions &options
+) {
+	if (!url || !onChunk) {
+		return FetchHandle();
+	}
+	return enqueueStreamRequest(
+	    url,
+	    std::move(onStart),
+	    std::move(onChunk),
+	    std::move(onDone),
+	    options
+	);
+}
+
+FetchHandle ESPFetch::getStream(
+    const String &url,
+    FetchChunkCallback onChunk,
+    FetchStreamCallback onDone,
+    const FetchRequestOptions &options
+) {
+	return getStream(url.c_str(), std::move(onChunk), std::move(onDone), options);
+}
+
+FetchHandle ESPFetch::getStream(
+    const String &url,
+    FetchStreamStartCallback onStart,
+    FetchChunkCallback onChunk,
+    FetchStreamCallback onDone,
+    const FetchRequestOptions &options
+) {
+	return getStream(
+	    url.c_str(),
+	    std::move(onStart),
+	    std::move(onChunk),
+	    std::move(onDone),
+	    options
+	);
+}
+
+FetchHandle ESPFetch::getJsonStream(
+    const char *url,
+    const char *arrayPath,
+    FetchJsonElementCallback onElement,
+    FetchStreamCallback onDone,
+    const FetchRequestOptions &options
+) {
+	return enqueueJsonStreamRequest(
+	    url,
+	    arrayPath,
+	    nullptr,
+	    std::move(onElement),
+	    std::move(onDone),
+	    options
+	);
+}
+
+FetchHandle ESPFetch::getJsonStream(
+    const char *url,
+    const char *arrayPath,
+    FetchStreamStartCallback onStart,
+    FetchJsonElementCallback onElement,
+    FetchStreamCallback onDone,
+    const FetchRequestOptions &options
+) {
+	return enqueueJsonStreamRequest(
+	    url,
+	    arrayPath,
+	    std::move(onStart),
+	    std::move(onElement),
+	    std::move(onDone),
+	    options
+	);
+}
+
+FetchHandle ESPFetch::getJsonStream(
+    const String &url,
+    const char *arrayPath,
+    FetchJsonElementCallback onElement,
+    FetchStreamCallback onDone,
+    const FetchRequestOptions &options
+) {
+	return getJsonStream(url.c_str(), arrayPath, std::move(onElement), std::move(onDone), options);
+}
+
+FetchHandle ESPFetch::getJsonStream(
+    const String &url,
+    const char *arrayPath,
+    FetchStreamStartCallback onStart,
+    FetchJsonElementCallback onElement,
+    FetchStreamCallback onDone,
+    const FetchRequestOptions &options
+) {
+	return getJsonStream(
+	    url.c_str(),
+	    arrayPath,
+	    std::move(onStart),
+	    std::move(onElement),
+	    std::move(onDone),
+	    options
+	);
+}
+
+FetchHandle ESPFetch::enqueueJsonStreamRequest(
+    const char *url,
+    const char *arrayPath,
+    FetchStreamStartCallback onStart,
+    FetchJsonElementCallback onElement,
+    FetchStreamCallback onDone,
+    const FetchRequestOptions &options
+) {
+	if (!url || !onElement) {
+		return FetchHandle();
+	}
+	const std::shared_ptr<const FetchConfig> config = configSnapshot();
+	if (!config) {
+		ESP_LOGE(TAG, "ESPFetch not initialized");
+		return FetchHandle();
+	}
+
+	// Shared by the three stream callbacks, which may run on different tasks but never at once.
+	struct JsonStreamState {
+		JsonStreamState(const char *path, size_t limit, bool usePSRAM)
+		    : scanner(path, limit, usePSRAM) {
+		}
+		FetchJsonArrayScanner scanner;
+		FetchJsonElementCallback onElement;
+		JsonDocument filter;
+		bool scanning = false;
+		bool parseFailed = false;
+	};
+	auto state = std::make_shared<JsonStreamState>(
+	    arrayPath,
+	    options.maxJsonElementBytes ? options.maxJsonElementBytes : config->maxBodyBytes,
+	    esp_fetch_detail::resolveFetchTlsBool(options.usePSRAMBuffers, config->usePSRAMBuffers)
+	);
+	state->onElement = std::move(onElement);
+	state->filter = options.jsonFilter;
+
+	FetchStreamStartCallback start = [state,
+	                                  onStart = std::move(onStart)](const StreamStartInfo &info) {
+		state->scanning = info.statusCode >= 200 && info.statusCode < 300;
+		return !onStart || onStart(info);
+	};
+	FetchChunkCallback chunk = [state](const void *data, size_t size) {
+		if (!state->scanning) {
+			return true;
+		}
+		JsonStreamState &s = *state;
+		auto deliver = [&s](const char *json, size_t length) {
+			JsonDocument element;
+			const DeserializationError parsed =
+			    s.filter.isNull()
+			        ? deserializeJson(element, json, length)
+			        : deserializeJson(
+			              element,
+			              json,
+			              length,
+			              DeserializationOption::Filter(s.filter)
+			          );
+			if (parsed) {
+				s.parseFailed = true;
+				return false;
+			}
+			return s.onElement(std::move(element));
+		};
+		return s.scanner.feed(static_cast<const char *>(data), size, deliver) == ESP_OK;
+	};
+	FetchStreamCallback done = [state, onDone = std::move(onDone)](StreamResult result) {
+		if (state->scanning) {
+			const esp_err_t scanError =
+			    state->parseFailed ? ESP_ERR_INVALID_RESPONSE : state->scanner.error();
+			if (scanError != ESP_OK && scanError != ESP_ERR_INVALID_STATE) {
+				// The stream was stopped because of the body, not by the caller.
+				result.error = scanError;
+			} else if (result.error == ESP_OK) {
+				result.error = state->scanner.finish();
+			}
+		}
+		if (onDone) {
+			onDone(result);
+		}
+	};
+	return enqueueStreamRequest(url, std::move(start), std::move(chunk), std::move(done), options);
+}
+
+FetchHandle ESPFetch::download(
+    const char *url,
+    FetchChunkCallback onChunk,
+    FetchStreamCallback onDone,
+    const FetchRequestOptions &options
+) {
+	if (!url || !onChunk) {
+		return FetchHandle();
+	}
+	FetchRequestOptions downloadOptions = options;
+	if (downloadOptions.resumeAttempts == 0) {
+		downloadOptions.resumeAttempts = 3;
+	}
+	return enqueueStreamRequest(
+	    url,
+	    nullptr,
+	    std::move(onChunk),
+	    std::move(onDone),
+	    downloadOptions
+	);
+}
+
+FetchHandle ESPFetch::download(
+    const String &url,
+    FetchChunkCallback onChunk,
+    FetchStreamCallback onDone,
+    const FetchRequestOptions &options
+) {
+	return download(url.c_str(), std::move(onChunk), std::move(onDone), options);
+}
+
+std::unique_ptr<ESPFetch::FetchJob> ESPFetch::prepareRequestJob(
+    const std::string &url,
+    esp_http_client_method_t method,
+    FetchString &&body,
+    const FetchRequestOptions &options,
+    bool rawResult,
+    const char **startErrorOut
+) {
+	std::shared_ptr<const FetchConfig> config;
+	std::string normalizedUrl;
+	esp_fetch_detail::ResolvedFetchTransportOptions resolvedTransport;
+	if (!resolveRequestTarget(
+	        url, options, config, normalizedUrl, resolvedTransport, startErrorOut
+	    )) {
+		return nullptr;
+	}
+
+	auto job = std::make_unique<FetchJob>(resolvedTransport);
+	job->owner = this;
+	job->config = std::move(config);
+	job->enqueuedUs = esp_timer_get_time();
+	job->url.assign(normalizedUrl.c_str(), normalizedUrl.size());
+	job->method = method;
+	job->body = std::move(body);
+	populateInternalFetchRequestOptions(job->requestOptions, options);
+	buildFetchRequestHeaders(job->requestOptions.headers, options, job->stringAllocator);
+	applyRequestOptions(*job, options, rawResult);
+	return job;
+}
+
+bool ESPFetch::resolveRequestTarget(
+    const std::string &url,
+    const FetchRequestOptions &options,
+    std::shared_ptr<const FetchConfig> &config,
+    std::string &normalizedUrl,
+    esp_fetch_detail::ResolvedFetchTransportOptions &transport,
+    const char **startErrorOut
+) const {
+	if (!isInitialized()) {
+		ESP_LOGE(TAG, "ESPFetch not initialized");
+		if (startErrorOut != nullptr) {
+			*startErrorOut = "ESPFetch not initialized";
+		}
+		return false;
+	}
+
+	config = configSnapshot();
+	normalizedUrl = normalizeUrl(url);
+	transport = resolveFetchTransportOptionsForJob(*config, options);
+	const char *transportError =
+	    esp_fetch_detail::validateFetchTransportOptions(normalizedUrl, transport);
+	if (transportError == nullptr) {
+		transportError = validateFetchLane(*config, options.lane);
+	}
+	if (transportError != nullptr) {
+		ESP_LOGE(TAG, "Rejected request for %s: %s", normalizedUrl.c_str(), transportError);
+		if (startErrorOut != nullptr) {
+			*startErrorOut = transportError;
+		}
+		return false;
+	}
+	return true;
+}
+
+// Per-job flags and limits that depend on the body and result mode. requestOptions (including
+// its headers) must already be in place.
+void ESPFetch::applyRequestOptions(
+    FetchJob &job, const FetchRequestOptions &options, bool rawResult
+) {
+	if (job.requestOptions.hasHeader("Content-Encoding")) {
+		// The caller encoded the body already.
+		job.requestOptions.compressBody = FetchBodyEncoding::Identity;
+	}
+	if (job.requestOptions.compressBody != FetchBodyEncoding::Identity && !job.body.empty()) {
+		// Compressed bodies are encoded while they are written, like a postStream upload.
+		job.isUpload = true;
+		job.uploadLength = static_cast<int64_t>(job.body.size());
+	}
+	job.priority = options.priority;
+	job.lane = options.lane;
+	job.rawResult = rawResult;
+	// HEAD responses have no body to parse.
+	job.parseBody = !rawResult && options.parseJsonBody && job.method != HTTP_METHOD_HEAD;
+	if (job.parseBody) {
+		job.bodyFilter = options.jsonFilter;
+	}
+	// Only plain buffered GETs are cached; ranges and caller-supplied validators opt out.
+	job.cacheable = _responseCache.enabled() && !options.bypassCache &&
+	                job.method == HTTP_METHOD_GET && !job.parseBody && job.body.empty() &&
+	                !job.requestOptions.hasHeader("Range") &&
+	                !job.requestOptions.hasHeader("If-None-Match") &&
+	                !job.requestOptions.hasHeader("If-Modified-Since");
+	// A JSON filter cannot be compared cheaply, so filtered parses never share a job, and a
+	// deadline would cut the exchange short for every request sharing it.
+	const FetchConfig &config = *job.config;
+	job.coalescable = config.coalesceRequests && options.allowCoalescing && !rawResult &&
+	                  job.method == HTTP_METHOD_GET && job.body.empty() &&
+	                  !(job.parseBody && !job.bodyFilter.isNull()) && options.deadlineMs == 0;
+	job.deadlineUs = esp_fetch_detail::fetchDeadlineUs(job.enqueuedUs, options.deadlineMs);
+
+	job.bodyLimit =
+	    job.requestOptions.maxBodyBytes ? job.requestOptions.maxBodyBytes : config.maxBodyBytes;
+	job.headerLimit = job.requestOptions.maxHeaderBytes ? job.requestOptions.maxHeaderBytes
+	                                                    : config.maxHeaderBytes;
+	if (job.bodyLimit == 0) {
+		job.bodyLimit = std::numeric_limits<size_t>::max();
+	}
+	if (job.headerLimit == 0) {
+		job.headerLimit = std::numeric_limits<size_t>::max();
+	}
+
+	// With job arenas, JSON-mode bodies are reserved from the arena once the job runs.
+	if (job.buffersBody() && (rawResult || !_arenaPool.enabled())) {
+		job.response.body.reserve(initialFetchBodyReserve(job.bodyLimit));
+	}
+}
+
+FetchHandle ESPFetch::enqueueRequest(
+    const std::string &url,
+    esp_http_client_method_t method,
+    FetchString &&body,
+    FetchCallback callback,
+    std::shared_ptr<SyncHandle> syncHandle,
+    const FetchRequestOptions &options,
+    const char **startErrorOut
+) {
+	auto job = prepareRequestJob(url, method, std::move(body), options, false, startErrorOut);
+	if (!job) {
+		return FetchHandle();
+	}
+	job->callback = std::move(callback);
+	job->syncHandle = std::move(syncHandle);
+	FetchHandle handle = trackJob(*job);
+	if (job->coalescable && attachToInflightJob(job)) {
+		return handle;
+	}
+	return admitJob(std::move(job), startErrorOut) ? handle : FetchHandle();
+}
+
+FetchHandle ESPFetch::enqueueRawRequest(
+    const std::string &url,
+    esp_http_client_method_t method,
+    FetchString &&body,
+    FetchRawCallback callback,
+    std::shared_ptr<SyncHandle> syncHandle,
+    const FetchRequestOptions &options,
+    const char **startErrorOut
+) {
+	auto job = prepareRequestJob(url, method, std::move(body), options, true, startErrorOut);
+	if (!job) {
+		return FetchHandle();
+	}
+	job->rawCallback = std::move(callback);
+	job->syncHandle = std::move(syncHandle);
+	FetchHandle handle = trackJob(*job);
+	return admitJob(std::move(job), startErrorOut) ? handle : FetchHandle();
+}
+
+FetchHandle ESPFetch::enqueueUploadRequest(
+    const std::string &url,
+    esp_http_client_method_t method,
+    int64_t contentLength,
+    FetchBodyProducer producer,
+    FetchCallback callback,
+    const FetchRequestOptions &options,
+    const char **startErrorOut
+) {
+	if (!producer) {
+		ESP_LOGE(TAG, "postStream requires a body producer");
+		if (startErrorOut != nullptr) {
+			*startErrorOut = "postStream requires a body producer";
+		}
+		return FetchHandle();
+	}
+	if (contentLength > INT_MAX) {
+		ESP_LOGE(TAG, "Upload length %lld exceeds esp_http_client limits", (long long)contentLength);
+		if (startErrorOut != nullptr) {
+			*startErrorOut = "upload length too large";
+		}
+		return FetchHandle();
+	}
+
+	auto job = prepareRequestJob(
+	    url,
+	    method,
+	    FetchString{bodyAllocator()},
+	    options,
+	    false,
+	    startErrorOut
+	);
+	if (!job) {
+		return FetchHandle();
+	}
+	job->isUpload = true;
+	job->uploadProducer = std::move(producer);
+	job->uploadLength = contentLength < 0 ? -1 : contentLength;
+	job->callback = std::move(callback);
+	FetchHandle handle = trackJob(*job);
+	return admitJob(std::move(job), startErrorOut) ? handle : FetchHandle();
+}
+
+FetchHandle ESPFetch::enqueueStreamRequest(
+    const std::string &url,
+    FetchStreamStartCallback onStart,
+    FetchChunkCallback onChunk,
+    FetchStreamCallback onDone,
+    const FetchRequestOptions &options,
+    const char **startErrorOut
+) {
+	if (!isInitialized()) {
+		ESP_LOGE(TAG, "ESPFetch not initialized");
+		if (startErrorOut != nullptr) {
+			*startErrorOut = "ESPFetch not initialized";
+		}
+		return FetchHandle();
+	}
+
+	if (!onChunk) {
+		ESP_LOGE(TAG, "getStream requires onChunk callback");
+		if (startErrorOut != nullptr) {
+			*startErrorOut = "getStream requires onChunk callback";
+		}
+		return FetchHandle();
+	}
+
+	std::shared_ptr<const FetchConfig> config = configSnapshot();
+	const std::string normalizedUrl = normalizeUrl(url);
+	const auto resolvedTransport = resolveFetchTransportOptionsForJob(*config, options);
+	const char *transportError =
+	    esp_fetch_detail::validateFetchTransportOptions(normalizedUrl, resolvedTransport);
+	if (transportError == nullptr) {
+		transportError = validateFetchLane(*config, options.lane);
+	}
+	if (transportError != nullptr) {
+		ESP_LOGE(
+		    TAG,
+		    "Rejected stream request for %s: %s",
+		    normalizedUrl.c_str(),
+		    transportError
+		);
+		if (startErrorOut != nullptr) {
+			*startErrorOut = transportError;
+		}
+		return FetchHandle();
+	}
+
+	auto job = std::make_unique<FetchJob>(resolvedTransport);
+	job->owner = this;
+	job->config = std::move(config);
+	job->enqueuedUs = esp_timer_get_time();
+	job->url.assign(normalizedUrl.c_str(), normalizedUrl.size());
+	job->method = HTTP_METHOD_GET;
+	populateInternalFetchRequestOptions(job->requestOptions, options);
+	job->requestOptions.headers.clear();
+	job->requestOptions.headers.reserve(options.headers.size());
+	for (const auto &header : options.headers) {
+		job->requestOptions.headers
+		    .emplace_back(header.name.c_str(), header.value.c_str(), job->stringAllocator);
+	}
+	appendFetchRangeHeader(job->requestOptions.headers, options, job->stringAllocator);
+	appendFetchAcceptEncoding(job->requestOptions.headers, options, job->stringAllocator);
+
+	job->priority = options.priority;
+	job->lane = options.lane;
+	job->isStream = true;
+	job->onStart = std::move(onStart);
+	job->onChunk = std::move(onChunk);
+	job->onDone = std::move(onDone);
+	job->receivedBytes = 0;
+	job->streamAbortError = ESP_OK;
+	job->streamStartRejected = false;
+	// Resuming needs to know the requested window, so a hand-written Range header disables it.
+	const bool explicitRange =
+	    std::any_of(options.headers.begin(), options.headers.end(), [](const FetchHeader &header) {
+		    return equalsIgnoreCase(header.name, "Range");
+	    });
+	job->resumeAttempts = explicitRange ? 0 : options.resumeAttempts;
+	job->resumeDelayMs = options.resumeDelayMs;
+
+	// For streaming, default to "unlimited" unless the caller explicitly sets maxBodyBytes.
+	job->bodyLimit = job->requestOptions.maxBodyBytes ? job->requestOptions.maxBodyBytes
+	                                                  : std::numeric_limits<size_t>::max();
+	job->headerLimit = job->requestOptions.maxHeaderBytes ? job->requestOptions.maxHeaderBytes
+	                                                      : job->config->maxHeaderBytes;
+	if (job->headerLimit == 0) {
+		job->headerLimit = std::numeric_limits<size_t>::max();
+	}
+	job->deadlineUs = esp_fetch_detail::fetchDeadlineUs(job->enqueuedUs, options.deadlineMs);
+
+	FetchHandle handle = trackJob(*job);
+	return admitJob(std::move(job), startErrorOut) ? handle : FetchHandle();
+}
+
+FetchHandle ESPFetch::trackJob(FetchJob &job) {
+	job.control = std::make_shared<FetchHandle::Control>();
+	return FetchHandle(job.control);
+}
+
+// Latches ESP_ERR_INVALID_STATE once the caller cancelled or ESP_ERR_TIMEOUT past the deadline.
+// A cancelled request that other GETs coalesced onto keeps running while any of them still wants
+// the result.
+esp_err_t ESPFetch::checkStop(FetchJob &job) {
+	if (job.stopError != ESP_OK) {
+		return job.stopError;
+	}
+	if (job.deadlineUs > 0 && esp_timer_get_time() >= job.deadlineUs) {
+		job.stopError = ESP_ERR_TIMEOUT;
+	} else if (job.control && job.control->cancelled.load(std::memory_order_acquire) &&
+	           !hasLiveCoalescedWaiters(job)) {
+		job.stopError = ESP_ERR_INVALID_STATE;
+	}
+	return job.stopError;
+}
+
+bool ESPFetch::hasLiveCoalescedWaiters(const FetchJob &job) const {
+	if (!job.coalescing) {
+		return false;
+	}
+	SchedulerLock lock(_schedulerMutex);
+	return std::any_of(
+	    job.coalescedWaiters.begin(),
+	    job.coalescedWaiters.end(),
+	    [](const FetchJob::CoalescedWaiter &waiter) {
+		    return !waiter.control || !waiter.control->cancelled.load(std::memory_order_acquire);
+	    }
+	);
+}
+
+int ESPFetch::attemptTimeoutMs(const FetchJob &job) const {
+	const uint32_t timeoutMs =
+	    job.requestOptions.timeoutMs ? job.requestOptions.timeoutMs : job.config->defaultTimeoutMs;
+	return static_cast<int>(esp_fetch_detail::fetchTimeoutWithinDeadline(
+	    timeoutMs, job.deadlineUs, esp_timer_get_time()
+	));
+}
+
+bool ESPFetch::admitJob(std::unique_ptr<FetchJob> job, const char **startErrorOut) {
+	const FetchPriority priority = job->priority;
+	job->accountedHeapBytes = job->heapFootprint();
+	_stats.addJobHeap(job->accountedHeapBytes);
+	job->memoryBytes = job->memoryCost();
+	ESP_FETCH_TRACE_JOB(_trace, job->traceJob);
+	ESP_FETCH_TRACE(_trace, FetchTraceEvent::Enqueued, job->traceJob, priority);
+	bool slotTaken = false;
+	bool memoryShort = false;
+	{
+		SchedulerLock lock(_schedulerMutex);
+		slotTaken = tryTakeSlotLocked(priority, job->memoryBytes, &memoryShort);
+		if (memoryShort) {
+			_stats.recordMemoryDeferral();
+		}
+		if (!slotTaken && _pendingCount.load(std::memory_order_relaxed) < _pendingLimit) {
+			_pendingJobs[static_cast<size_t>(priority)].push_back(job.release());
+			_pendingCount.fetch_add(1, std::memory_order_acq_rel);
+			return true;
+		}
+	}
+
+	TickType_t acquireTicks = job->config->slotAcquireTicks;
+	if (job->deadlineUs > 0 && acquireTicks > 0) {
+		const uint32_t remainingMs = esp_fetch_detail::fetchTimeoutWithinDeadline(
+		    UINT32_MAX, job->deadlineUs, esp_timer_get_time()
+		);
+		// Divided rather than pdMS_TO_TICKS, which overflows for long deadlines.
+		const TickType_t remainingTicks =
+		    std::max<TickType_t>(remainingMs / portTICK_PERIOD_MS, 1);
+		acquireTicks = std::min(acquireTicks, remainingTicks);
+	}
+	if (!slotTaken && !waitForSlot(priority, job->memoryBytes, acquireTicks)) {
+		if (memoryShort) {
+			ESP_LOGW(
+			    TAG,
+			    "Fetch memory budget exhausted (%u bytes needed)",
+			    static_cast<unsigned>(job->memoryBytes)
+			);
+		} else {
+			ESP_LOGW(TAG, "No available fetch slots");
+		}
+		if (startErrorOut != nullptr) {
+			*startErrorOut =
+			    memoryShort ? "fetch memory budget exhausted" : "no available fetch slots";
+		}
+		if (job->isBatchGroup()) {
+			job->response.error = ESP_ERR_TIMEOUT;
+			completeJob(std::move(job));
+			return false;
+		}
+		_stats.releaseJobHeap(job->accountedHeapBytes);
+		ESP_FETCH_TRACE(_trace, FetchTraceEvent::Error, job->traceJob, ESP_ERR_TIMEOUT);
+		if (job->coalescing) {
+			// Callers that attached meanwhile were told the request started.
+			job->response.error = ESP_ERR_TIMEOUT;
+			deliverCoalescedResults(*job, buildResult(*job, job->response));
+		}
+		return false;
+	}
+	ESP_FETCH_TRACE(_trace, FetchTraceEvent::SlotAcquired, job->traceJob, job->lane);
+
+	if (!dispatchJob(job, startErrorOut)) {
+		const size_t memoryBytes = job->memoryBytes;
+		if (job->isBatchGroup()) {
+			job->response.error = ESP_FAIL;
+			completeJob(std::move(job));
+			releaseSlot(memoryBytes);
+			return false;
+		}
+		_stats.releaseJobHeap(job->accountedHeapBytes);
+		ESP_FETCH_TRACE(_trace, FetchTraceEvent::Error, job->traceJob, ESP_FAIL);
+		if (job->coalescing) {
+			job->response.error = ESP_FAIL;
+			deliverCoalescedResults(*job, buildResult(*job, job->response));
+		}
+		releaseSlot(memoryBytes);
+		return false;
+	}
+	return true;
+}
+
+bool ESPFetch::tryTakeSlotLocked(FetchPriority priority, size_t memoryBytes, bool *memoryShort) {
+	if (!esp_fetch_detail::fetchSlotAvailable(
+	        _runningJobs,
+	        _slotLimit,
+	        _reservedHighSlots,
+	        priority
+	    )) {
+		return false;
+	}
+	if (!esp_fetch_detail::fetchMemoryAvailable(
+	        _runningJobs,
+	        _reservedMemoryBytes,
+	        memoryBytes,
+	        _memoryBudget,
+	        _minFreeHeap > 0 ? freeInternalHeapBytes() : 0,
+	        _minFreeHeap
+	    )) {
+		if (memoryShort != nullptr) {
+			*memoryShort = true;
+		}
+		return false;
+	}
+	++_runningJobs;
+	_reservedMemoryBytes += memoryBytes;
+	_stats.recordConcurrentJobs(_runningJobs);
+	return true;
+}
+
+bool ESPFetch::waitForSlot(FetchPriority priority, size_t memoryBytes, TickType_t acquireTicks) {
+	if (acquireTicks == 0) {
+		return false;
+	}
+	{
+		// Registered under the lock, so a release after this point sees the waiter and wakes it.
+		SchedulerLock lock(_schedulerMutex);
+		if (tryTakeSlotLocked(priority, memoryBytes)) {
+			return true;
+		}
+		++_slotWaiters;
+	}
+
+	const TickType_t startTick = xTaskGetTickCount();
+	for (;;) {
+		TickType_t waitTicks = portMAX_DELAY;
+		if (acquireTicks != portMAX_DELAY) {
+			const TickType_t elapsed = xTaskGetTickCount() - startTick;
+			waitTicks = elapsed >= acquireTicks ? 0 : acquireTicks - elapsed;
+		}
+		const bool woken = waitTicks > 0 && xSemaphoreTake(_slotReleased, waitTicks) == pdTRUE &&
+		                   !_teardownRequested.load(std::memory_order_acquire);
+		SchedulerLock lock(_schedulerMutex);
+		if (!woken) {
+			--_slotWaiters;
+			return false;
+		}
+		if (tryTakeSlotLocked(priority, memoryBytes)) {
+			--_slotWaiters;
+			return true;
+		}
+	}
+}
+
+ESPFetch::FetchJob *ESPFetch::takeNextPendingLocked() {
+	for (size_t i = 3; i-- > 0;) {
+		auto &queue = _pendingJobs[i];
+		if (queue.empty()) {
+			continue;
+		}
+		// Lower priorities may not overtake a job still waiting for memory.
+		if (!tryTakeSlotLocked(static_cast<FetchPriority>(i), queue.front()->memoryBytes)) {
+			return nullptr;
+		}
+		FetchJob *job = queue.front();
+		queue.pop_front();
+		_pendingCount.fetch_sub(1, std::memory_order_acq_rel);
+		ESP_FETCH_TRACE(_trace, FetchTraceEvent::SlotAcquired, job->traceJob, job->lane);
+		return job;
+	}
+	return nullptr;
+}
+
+void ESPFetch::releaseSlotLocked(size_t memoryBytes) {
+	if (_runningJobs > 0) {
+		--_runningJobs;
+	}
+	_reservedMemoryBytes -= std::min(_reservedMemoryBytes, memoryBytes);
+}
+
+void ESPFetch::releaseSlot(size_t memoryBytes) {
+	{
+		SchedulerLock lock(_schedulerMutex);
+		releaseSlotLocked(memoryBytes);
+	}
+	// Under the memory governor one large job can make room for several parked ones.
+	startPendingJobs();
+	wakeSlotWaiters();
+}
+
+void ESPFetch::startPendingJobs() {
+	for (;;) {
+		FetchJob *next = nullptr;
+		{
+			SchedulerLock lock(_schedulerMutex);
+			if (!_teardownRequested.load(std::memory_order_acquire)) {
+				next = takeNextPendingLocked();
+			}
+		}
+		if (next == nullptr) {
+			return;
+		}
+
+		std::unique_ptr<FetchJob> job(next);
+		if (!dispatchJob(job, nullptr)) {
+			const size_t memoryBytes = job->memoryBytes;
+			job->response.error = ESP_FAIL;
+			completeJob(std::move(job));
+			SchedulerLock lock(_schedulerMutex);
+			releaseSlotLocked(memoryBytes);
+		}
+	}
+}
+
+void ESPFetch::wakeSlotWaiters() {
+	// One wake per slot still free once parked jobs started; each waiter re-checks its own
+	// memory cost and goes back to waiting if it does not fit.
+	size_t wakes = 0;
+	{
+		SchedulerLock lock(_schedulerMutex);
+		const size_t freeSlots = _slotLimit > _runningJobs ? _slotLimit - _runningJobs : 0;
+		wakes = std::min(_slotWaiters, freeSlots);
+	}
+	for (; wakes > 0; --wakes) {
+		xSemaphoreGive(_slotReleased);
+	}
+}
+
+void ESPFetch::failPendingJobs() {
+	std::vector<FetchJob *> parked;
+	{
+		SchedulerLock lock(_schedulerMutex);
+		for (auto &queue : _pendingJobs) {
+			parked.insert(parked.end(), queue.begin(), queue.end());
+			queue.clear();
+		}
+		_pendingCount.store(0, std::memory_order_release);
+	}
+	for (FetchJob *parkedJob : parked) {
+		std::unique_ptr<FetchJob> job(parkedJob);
+		job->response.error = ESP_ERR_INVALID_STATE;
+		completeJob(std::move(job));
+	}
+}
+
+// On failure the job stays owned by the caller, which also still holds the slot.
+bool ESPFetch::dispatchJob(std::unique_ptr<FetchJob> &job, const char **startErrorOut) {
+	// Keyed once the job mode is final, since read-loop jobs never keep their connection.
+	assignConnectionKey(*job);
+
+	if (!_workerLanes.empty()) {
+		if (job->lane >= _workerLanes.size()) {
+			ESP_LOGE(TAG, "Lane %u is not configured", static_cast<unsigned>(job->lane));
+			if (startErrorOut != nullptr) {
+				*startErrorOut = "lane is not configured";
+			}
+			return false;
+		}
+		// Every queued job holds a slot, so the work signal never reaches its limit.
+		WorkerLane &lane = *_workerLanes[job->lane];
+		_activeTasks.fetch_add(1, std::memory_order_acq_rel);
+		{
+			SchedulerLock lock(_schedulerMutex);
+			lane.queue.push_back(job.get());
+		}
+		job.release();
+		xSemaphoreGive(lane.available);
+		return true;
+	}
+
+	const FetchLane task = esp_fetch_detail::fetchLaneSettings(*job->config, job->lane);
+	size_t stackSize = task.stackSize;
+	if (stackSize == 0) {
+		ESP_LOGE(TAG, "Invalid stack size for fetch worker");
+		if (startErrorOut != nullptr) {
+			*startErrorOut = "invalid stack size for fetch worker";
+		}
+		return false;
+	}
+
+	_activeTasks.fetch_add(1, std::memory_order_acq_rel);
+
+	TaskHandle_t taskHandle = nullptr;
+	const BaseType_t created = xTaskCreatePinnedToCore(
+	    &ESPFetch::requestTask,
+	    "esp-fetch",
+	    stackSize,
+	    job.get(),
+	    task.priority,
+	    &taskHandle,
+	    task.coreId
+	);
+	if (created != pdPASS) {
+		ESP_LOGE(TAG, "Failed to spawn fetch task");
+		if (startErrorOut != nullptr) {
+			*startErrorOut = "failed to spawn fetch task";
+		}
+		_activeTasks.fetch_sub(1, std::memory_order_acq_rel);
+		return false;
+	}
+	job.release();
+	return true;
+}
+
+bool ESPFetch::startWorkerPool(const FetchConfig &config) {
+	for (uint8_t index = 0; index <= config.lanes.size(); ++index) {
+		auto lane = std::make_unique<WorkerLane>();
+		lane->owner = this;
+		lane->available = xSemaphoreCreateCounting(FETCH_WORK_SIGNAL_LIMIT, 0);
+		if (!lane->available) {
+			ESP_LOGE(TAG, "Failed to create fetch job queue");
+			stopWorkerPool();
+			return false;
+		}
+		_workerLanes.push_back(std::move(lane));
+
+		const FetchLane settings = esp_fetch_detail::fetchLaneSettings(config, index);
+		WorkerLane &added = *_workerLanes.back();
+		added.target.store(settings.workers, std::memory_order_release);
+		if (!spawnWorkers(added, settings.workers, settings)) {
+			stopWorkerPool();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ESPFetch::spawnWorkers(WorkerLane &lane, size_t count, const FetchLane &settings) {
+	for (size_t i = 0; i < count; ++i) {
+		lane.workers.fetch_add(1, std::memory_order_acq_rel);
+		TaskHandle_t taskHandle = nullptr;
+		const BaseType_t created = xTaskCreatePinnedToCore(
+		    &ESPFetch::workerTask,
+		    "esp-fetch-worker",
+		    settings.stackSize,
+		    &lane,
+		    settings.priority,
+		    &taskHandle,
+		    settings.coreId
+		);
+		if (created != pdPASS) {
+			ESP_LOGE(TAG, "Failed to spawn fetch worker %u", static_cast<unsigned>(i));
+			lane.workers.fetch_sub(1, std::memory_order_acq_rel);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Resizes lane 0 to maxConcurrentRequests workers; the other lanes are fixed until init().
+// Growing spawns workers right away; surplus workers exit once they finish their current job or
+// have been idle for FETCH_WORKER_IDLE_CHECK_MS.
+bool ESPFetch::resizeWorkerPool(const FetchConfig &config) {
+	WorkerLane &lane = *_workerLanes.front();
+	const FetchLane settings = esp_fetch_detail::fetchLaneSettings(config, 0);
+	const size_t target = settings.workers;
+	lane.target.store(target, std::memory_order_release);
+	const size_t running = lane.workers.load(std::memory_order_acquire);
+	if (target <= running) {
+		return true;
+	}
+	if (!spawnWorkers(lane, target - running, settings)) {
+		ESP_LOGW(
+		    TAG,
+		    "Worker pool has %u of %u workers",
+		    static_cast<unsigned>(lane.workers.load(std::memory_order_acquire)),
+		    static_cast<unsigned>(target)
+		);
+		return false;
+	}
+	return true;
+}
+
+bool ESPFetch::retireSurplusWorker(WorkerLane &lane) {
+	size_t workers = lane.workers.load(std::memory_order_acquire);
+	while (workers > lane.target.load(std::memory_order_acquire)) {
+		if (lane.workers.compare_exchange_weak(workers, workers - 1, std::memory_order_acq_rel)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void ESPFetch::stopWorkerPool() {
+	if (_workerLanes.empty()) {
+		return;
+	}
+
+	// One null sentinel per worker; jobs queued ahead of them are drained first.
+	for (auto &lane : _workerLanes) {
+		lane->target.store(0, std::memory_order_release);
+		const size_t workers = lane->workers.load(std::memory_order_acquire);
+		{
+			SchedulerLock lock(_schedulerMutex);
+			lane->queue.insert(lane->queue.end(), workers, nullptr);
+		}
+		for (size_t i = 0; i < workers; ++i) {
+			xSemaphoreGive(lane->available);
+		}
+	}
+
+	for (auto &lane : _workerLanes) {
+		while (lane->workers.load(std::memory_order_acquire) > 0) {
+#if defined(INCLUDE_xTaskGetSchedulerState) && (INCLUDE_xTaskGetSchedulerState == 1)
+			if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+				break;
+			}
+#endif
+			vTaskDelay(pdMS_TO_TICKS(1));
+		}
+	}
+
+	{
+		// Sentinels left over by workers that retired on their own.
+		SchedulerLock lock(_schedulerMutex);
+		for (auto &lane : _workerLanes) {
+			lane->queue.clear();
+		}
+	}
+	for (auto &lane : _workerLanes) {
+		vSemaphoreDelete(lane->available);
+	}
+	_workerLanes.clear();
+}
+
+JsonDocument
+ESPFetch::waitForResult(const std::shared_ptr<SyncHandle> &handle, TickType_t waitTicks) const {
+	JsonDocument doc;
+	if (!handle || !handle->done) {
+		doc["ok"] = false;
+		doc["error"]["message"] = "invalid sync handle";
+		return doc;
+	}
+
+	xSemaphoreTake(handle->done, waitTicks);
+	if (!handle->ready.load(std::memory_order_acquire)) {
+		doc["ok"] = false;
+		doc["error"]["message"] = "timeout waiting for fetch result";
+		return doc;
+	}
+
+	// The worker publishes the document exactly once, so take it over instead of copying.
+	return std::move(handle->doc);
+}
+
+FetchRawResponse ESPFetch::waitForRawResult(
+    const std::shared_ptr<SyncHandle> &handle, TickType_t waitTicks
+) const {
+	if (!handle || !handle->done) {
+		FetchRawResponse failed;
+		failed.error = ESP_ERR_INVALID_ARG;
+		return failed;
+	}
+
+	xSemaphoreTake(handle->done, waitTicks);
+	if (!handle->ready.load(std::memory_order_acquire)) {
+		FetchRawResponse failed;
+		failed.error = ESP_ERR_TIMEOUT;
+		return failed;
+	}
+	return std::move(handle->raw);
+}
+
+void ESPFetch::requestTask(void *arg) {
+	auto job = std::unique_ptr<FetchJob>(static_cast<FetchJob *>(arg));
+	if (!job || !job->owner) {
+		if (job && job->owner) {
+			job->owner->_activeTasks.fetch_sub(1, std::memory_order_acq_rel);
+		}
+		vTaskDelete(nullptr);
+		return;
+	}
+	job->owner->runJob(std::move(job));
+	vTaskDelete(nullptr);
+}
+
+void ESPFetch::workerTask(void *arg) {
+	auto *lane = static_cast<WorkerLane *>(arg);
+	ESPFetch *self = lane->owner;
+	for (;;) {
+		if (xSemaphoreTake(lane->available, pdMS_TO_TICKS(FETCH_WORKER_IDLE_CHECK_MS)) != pdTRUE) {
+			if (retireSurplusWorker(*lane)) {
+				break;
+			}
+			continue;
+		}
+
+		FetchJob *jobPtr = nullptr;
+		{
+			SchedulerLock lock(self->_schedulerMutex);
+			jobPtr = lane->queue.front();
+			lane->queue.pop_front();
+		}
+		if (jobPtr == nullptr) {
+			// Stop sentinel from stopWorkerPool().
+			lane->workers.fetch_sub(1, std::memory_order_acq_rel);
+			break;
+		}
+		self->runJob(std::unique_ptr<FetchJob>(jobPtr));
+		if (retireSurplusWorker(*lane)) {
+			break;
+		}
+	}
+	vTaskDelete(nullptr);
+}
+
+esp_err_t ESPFetch::handleHttpEvent(esp_http_client_event_t *event) {
+	if (!event || !event->user_data) {
+		return ESP_OK;
+	}
+	auto *job = static_cast<FetchJob *>(event->user_data);
+	if (job->owner && job->owner->_teardownRequested.load(std::memory_order_acquire)) {
+		if (job->isStream && job->streamAbortError == ESP_OK) {
+			job->streamAbortError = ESP_ERR_INVALID_STATE;
+		}
+		return ESP_FAIL;
+	}
+	if (job->owner && job->owner->checkStop(*job) != ESP_OK) {
+		if (job->isStream && job->streamAbortError == ESP_OK) {
+			job->streamAbortError = job->stopError;
+		}
+		return ESP_FAIL;
+	}
+
+	FetchTiming &timing = job->response.timing;
+	switch (event->event_id) {
+	case HTTP_EVENT_ON_CONNECTED:
+		stampFetchPhase(timing.connectedUs, job->startedUs);
+		ESP_FETCH_TRACE(job->owner->_trace, FetchTraceEvent::Connected, job->traceJob, 0);
+		break;
+
+	case HTTP_EVENT_HEADER_SENT:
+		stampFetchPhase(timing.headersSentUs, job->startedUs);
+#if ESP_FETCH_ENABLE_TRACE
+		job->traceHeadersPending = true;
+#endif
+		// A redirect or auth retry starts a new response with its own Content-Encoding.
+		job->inflating = false;
+		job->msgPackBody = false;
+		break;
+
+	case HTTP_EVENT_ON_FINISH:
+		stampFetchPhase(timing.finishedUs, job->startedUs);
+		break;
+
+	case HTTP_EVENT_ON_DATA:
+		if (event->data && event->data_len > 0) {
+			stampFetchPhase(timing.firstDataUs, job->startedUs);
+			ESP_FETCH_TRACE(
+			    job->owner->_trace,
+			    FetchTraceEvent::Chunk,
+			    job->traceJob,
+			    event->data_len
+			);
+			job->bytesIn += static_cast<size_t>(event->data_len);
+			// Stream and parsed-body modes consume the body from their own read loop.
+			if (job->usesReadLoop()) {
+				break;
+			} else if (job->inflating) {
+				if (job->response.bodyTruncated || job->inflateError != ESP_OK) {
+					break;
+				}
+				const esp_err_t err = job->inflater->feed(
+				    static_cast<const uint8_t *>(event->data),
+				    static_cast<size_t>(event->data_len),
+				    [job](const uint8_t *decoded, size_t length) {
+					    if (!appendFetchBody(
+					            job->response.body,
+					            job->bodyLimit,
+					            reinterpret_cast<const char *>(decoded),
+					            length
+					        )) {
+						    job->response.bodyTruncated = true;
+						    return false;
+					    }
+					    return true;
+				    }
+				);
+				if (err != ESP_OK && !job->response.bodyTruncated) {
+					job->inflateError = err;
+				}
+			} else {
+				// JSON mode (existing): buffer into response.body with limit/truncation.
+				if (!appendFetchBody(
+				        job->response.body,
+				        job->bodyLimit,
+				        static_cast<const char *>(event->data),
+				        static_cast<size_t>(event->data_len)
+				    )) {
+					job->response.bodyTruncated = true;
+				}
+			}
+		}
+		break;
+
+	case HTTP_EVENT_ON_HEADER:
+		stampFetchPhase(timing.firstHeaderUs, job->startedUs);
+#if ESP_FETCH_ENABLE_TRACE
+		if (job->traceHeadersPending) {
+			job->traceHeadersPending = false;
+			job->owner->_trace.record(
+			    FetchTraceEvent::HeadersReceived,
+			    job->traceJob,
+			    static_cast<uint32_t>(esp_http_client_get_status_code(event->client))
+			);
+		}
+#endif
+		if (job->isStream && event->header_key && event->header_value &&
+		    equalsIgnoreCase(std::string_view(event->header_key), "Content-Range")) {
+			esp_fetch_detail::parseFetchContentRange(event->header_value, job->contentRange);
+		}
+		if (job->parseBody && event->header_key &&
+		    equalsIgnoreCase(std::string_view(event->header_key), "Content-Type")) {
+			job->msgPackBody = esp_fetch_detail::isFetchMsgPackContentType(event->header_value);
+		}
+		if (job->requestOptions.acceptCompressed && event->header_key && event->header_value &&
+		    equalsIgnoreCase(std::string_view(event->header_key), "Content-Encoding")) {
+			FetchInflater::Encoding encoding;
+			if (FetchInflater::parseEncoding(event->header_value, encoding)) {
+				if (!job->inflater) {
+					job->inflater = std::make_unique<FetchInflater>(job->transport.usePSRAMBuffers);
+				}
+				job->inflating = job->inflater->begin(encoding);
+				if (!job->inflating) {
+					job->inflateError = ESP_ERR_NO_MEM;
+				}
+			}
+		}
+		if (job->cacheable && event->header_key && event->header_value) {
+			const std::string_view key(event->header_key);
+			if (equalsIgnoreCase(key, "ETag")) {
+				job->cacheEtag.assign(event->header_value);
+			} else if (equalsIgnoreCase(key, "Last-Modified")) {
+				job->cacheLastModified.assign(event->header_value);
+			} else if (equalsIgnoreCase(key, "Cache-Control")) {
+				esp_fetch_detail::parseFetchCacheControl(event->header_value, job->cacheControl);
+			}
+		}
+		if (event->header_key && event->header_value &&
+		    job->requestOptions.capturesHeader(event->header_key)) {
+			const size_t projected = job->response.headerBytes + strlen(event->header_key) +
+			                         strlen(event->header_value);
+			if (projected <= job->headerLimit) {
+				job->response.headers.emplace_back(
+				    event->header_key,
+				    event->header_value,
+				    FetchAllocator<char>(job->response.headers.get_allocator())
+				);
+				job->response.headerBytes = projected;
+			} else {
+				job->response.headersTruncated = true;
+			}
+		}
+		break;
+
+	default:
+		break;
+	}
+	return ESP_OK;
+}
+
+void ESPFetch::runJob(std::unique_ptr<FetchJob> job) {
+	if (!job) {
+		return;
+	}
+
+	const uint8_t lane = job->lane;
+	const size_t memoryBytes = job->memoryBytes;
+	if (job->isBatchGroup()) {
+		runBatchGroup(std::move(job));
+	} else {
+		executeJob(std::move(job));
+	}
+#if defined(INCLUDE_uxTaskGetStackHighWaterMark) && (INCLUDE_uxTaskGetStackHighWaterMark == 1)
+	_stats.recordStackHighWater(lane, uxTaskGetStackHighWaterMark(nullptr) * sizeof(StackType_t));
+#else
+	(void)lane;
+#endif
+	releaseSlot(memoryBytes);
+
+	_activeTasks.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void ESPFetch::executeJob(std::unique_ptr<FetchJob> job) {
+	const int64_t start = esp_timer_get_time();
+	job->startedUs = start;
+	job->response.timing.queuedUs = start - job->enqueuedUs;
+
+	// Raw responses are handed to the caller and outlive the job, so only JSON-mode results
+	// (copied into the result document) keep their headers and body in the arena.
+	FetchArena *arena = _arenaPool.acquire();
+	if (arena) {
+		job->scratchAllocator = FetchAllocator<char>(job->transport.usePSRAMBuffers, arena);
+		if (!job->rawResult && !job->isStream) {
+			job->response.body = FetchString(job->scratchAllocator);
+			if (job->buffersBody()) {
+				job->response.body.reserve(initialFetchBodyReserve(job->bodyLimit));
+			}
+			job->response.headers =
+			    FetchRawHeaderVector(FetchAllocator<FetchRawHeader>(job->scratchAllocator));
+		}
+	}
+
+	if (_teardownRequested.load(std::memory_order_acquire)) {
+		job->response.error = ESP_ERR_INVALID_STATE;
+	} else if (checkStop(*job) != ESP_OK) {
+		// Cancelled or out of time while it waited for a slot.
+		job->response.error = job->stopError;
+	} else if (job->cacheable && serveFromResponseCache(*job)) {
+		// Fresh cache hit: no connection was needed.
+	} else if (!admitThroughCircuitBreaker(*job)) {
+		job->response.error = ESP_ERR_NOT_ALLOWED;
+	} else if (!resolveConnectAddress(*job)) {
+		job->response.error = ESP_ERR_HTTP_CONNECT;
+	} else {
+		bool reusedConnection = false;
+		esp_http_client_handle_t client = acquireClient(*job, reusedConnection);
+		if (!client) {
+			ESP_LOGE(TAG, "esp_http_client_init failed");
+			job->response.error = ESP_ERR_NO_MEM;
+		} else if (_teardownRequested.load(std::memory_order_acquire)) {
+			job->response.error = ESP_ERR_INVALID_STATE;
+			releaseClient(*job, client, false);
+		} else {
+			const auto hasHeader = [&](const char *key) {
+				return job->requestOptions.hasHeader(key);
+			};
+
+			const FetchConfig &config = *job->config;
+			if (!job->hostHeader.empty() && !hasHeader("Host")) {
+				esp_http_client_set_header(client, "Host", job->hostHeader.c_str());
+			}
+			if (config.userAgent && !hasHeader("User-Agent")) {
+				esp_http_client_set_header(client, "User-Agent", config.userAgent);
+			}
+
+			const char *contentType = job->requestOptions.contentType
+			                              ? job->requestOptions.contentType
+			                              : config.defaultContentType;
+			const bool sendsBody =
+			    esp_fetch_detail::fetchHttpMethodHasBody(job->method) || !job->body.empty();
+			if (!job->isStream && sendsBody && contentType && !hasHeader("Content-Type")) {
+				esp_http_client_set_header(client, "Content-Type", contentType);
+			}
+
+			job->requestOptions.forEachHeader([client](const InternalFetchHeader &header) {
+				esp_http_client_set_header(client, header.name.c_str(), header.value.c_str());
+			});
+
+			if (!job->isUpload && !job->body.empty()) {
+				esp_http_client_set_post_field(client, job->body.c_str(), job->body.length());
+				job->bytesOut = job->body.length();
+			}
+
+			for (uint8_t attempt = 1;; ++attempt) {
+				runExchange(*job, client, reusedConnection);
+				recordCircuitResult(*job);
+				if (!prepareRetry(*job, client, attempt)) {
+					break;
+				}
+				reusedConnection = false;
+			}
+			if (job->dnsName && job->response.error == ESP_ERR_HTTP_CONNECT) {
+				// The cached address may be stale; the next request looks the host up again.
+				_dnsCache.expire(job->dnsName->c_str());
+			}
+			if (job->cacheable) {
+				updateResponseCache(*job);
+			}
+
+			if (job->isStream && job->response.error != ESP_OK && job->streamAbortError != ESP_OK) {
+				job->response.error = job->streamAbortError;
+			}
+			if (job->isStream && job->streamStartRejected) {
+				job->response.error = ESP_OK;
+			}
+			if (job->stopError != ESP_OK) {
+				job->response.error = job->stopError;
+			}
+			releaseClient(*job, client, !job->usesReadLoop() && job->response.error == ESP_OK);
+		}
+	}
+
+	job->response.durationUs = esp_timer_get_time() - start;
+	if (job->response.error == ESP_OK && job->response.timing.finishedUs < 0) {
+		// Read-loop jobs close before esp_http_client reports ON_FINISH.
+		job->response.timing.finishedUs = job->response.durationUs;
+	}
+	completeJob(std::move(job));
+	if (arena) {
+		// The job and every container it owned are gone, so the arena can be reset.
+		_stats.recordArenaUsage(arena->highWater(), arena->overflows());
+		_arenaPool.release(arena);
+	}
 }
 
-bool ESPFetch::getStream(
-    const String &url,
-    FetchStreamStartCallback onStart,
-    FetchChunkCallback onChunk,
-    FetchStreamCallback onDone,
-    const FetchRequestOptions &options
-) {
-	return getStream(
-	    url.c_str(),
-	    std::move(onStart),
-	    std::move(onChunk),
-	    std::move(onDone),
-	    options
-	);
+// Runs the group's requests one after another in one slot. Consecutive requests to the same
+// origin hand their esp_http_client handle on, so they share a kept-alive connection even when
+// the connection pool is off.
+void ESPFetch::runBatchGroup(std::unique_ptr<FetchJob> group) {
+	std::vector<std::unique_ptr<FetchJob>> members = std::move(group->batchMembers);
+	_stats.releaseJobHeap(group->accountedHeapBytes);
+	group.reset();
+
+	BatchConnection connection;
+	for (auto &member : members) {
+		if (connection.client && connection.key != member->batchKey) {
+			esp_http_client_cleanup(connection.client);
+			connection.client = nullptr;
+		}
+		connection.key = member->batchKey;
+		member->batchConnection = &connection;
+		assignConnectionKey(*member);
+		executeJob(std::move(member));
+	}
+	if (connection.client) {
+		esp_http_client_cleanup(connection.client);
+	}
 }
 
-bool ESPFetch::enqueueRequest(
-    const std::string &url,
-    esp_http_client_method_t method,
-    FetchString &&body,
-    FetchCallback callback,
-    std::shared_ptr<SyncHandle> syncHandle,
-    const FetchRequestOptions &options,
-    const char **startErrorOut
-) {
-	if (!isInitialized()) {
-		ESP_LOGE(TAG, "ESPFetch not initialized");
-		if (startErrorOut != nullptr) {
-			*startErrorOut = "ESPFetch not initialized";
+void ESPFetch::completeJob(std::unique_ptr<FetchJob> job) {
+	if (job->isBatchGroup()) {
+		// A group that never ran (rejected, or parked at deinit) fails each of its requests.
+		_stats.releaseJobHeap(job->accountedHeapBytes);
+		for (auto &member : job->batchMembers) {
+			member->response.error = job->response.error;
+			completeJob(std::move(member));
 		}
-		return false;
+		return;
 	}
 
-	const std::string normalizedUrl = normalizeUrl(url);
-	const auto resolvedTransport = resolveFetchTransportOptionsForJob(_config, options);
-	const char *transportError =
-	    esp_fetch_detail::validateFetchTransportOptions(normalizedUrl, resolvedTransport);
-	if (transportError != nullptr) {
-		ESP_LOGE(TAG, "Rejected request for %s: %s", normalizedUrl.c_str(), transportError);
-		if (startErrorOut != nullptr) {
-			*startErrorOut = transportError;
-		}
-		return false;
+	const size_t footprint = job->heapFootprint();
+	if (footprint > job->accountedHeapBytes) {
+		_stats.addJobHeap(footprint - job->accountedHeapBytes);
 	}
+	_stats.releaseJobHeap(std::max(footprint, job->accountedHeapBytes));
+	_stats.recordCompletion(
+	    job->response.error,
+	    job->bytesIn,
+	    job->bytesOut,
+	    job->response.timing.queuedUs
+	);
+	if (job->response.error != ESP_OK) {
+		ESP_FETCH_TRACE(_trace, FetchTraceEvent::Error, job->traceJob, job->response.error);
+	}
+	ESP_FETCH_TRACE(_trace, FetchTraceEvent::Completed, job->traceJob, job->response.statusCode);
 
-	if (xSemaphoreTake(_slotSemaphore, _config.slotAcquireTicks) != pdTRUE) {
-		ESP_LOGW(TAG, "No available fetch slots");
-		if (startErrorOut != nullptr) {
-			*startErrorOut = "no available fetch slots";
+	if (job->isStream) {
+		StreamResult r;
+		r.error = job->response.error;
+		r.statusCode = job->response.statusCode;
+		r.receivedBytes = job->receivedBytes;
+		r.timing = job->response.timing;
+		if (job->onDone) {
+			invokeFetchCallback(job->onDone, r);
 		}
-		return false;
+	} else if (job->rawResult) {
+		deliverRawResult(job);
+	} else {
+		JsonDocument result = buildResult(*job, job->response);
+		if (job->coalescing) {
+			deliverCoalescedResults(*job, result);
+			if (job->stopError == ESP_OK && job->control &&
+			    job->control->cancelled.load(std::memory_order_acquire)) {
+				// The exchange ran on for the attached requests, not for this one.
+				result = buildCancelledResult(*job);
+			}
+		}
+		deliverResult(job, std::move(result));
+	}
+	if (job->control && !job->batchMember) {
+		job->control->finished.store(true, std::memory_order_release);
 	}
+}
 
-	auto job = std::make_unique<FetchJob>(resolvedTransport);
-	job->owner = this;
-	job->url.assign(normalizedUrl.c_str(), normalizedUrl.size());
-	job->method = method;
-	job->body = std::move(body);
-	populateInternalFetchRequestOptions(job->requestOptions, options);
-	job->requestOptions.headers.clear();
-	job->requestOptions.headers.reserve(options.headers.size());
-	for (const auto &header : options.headers) {
-		job->requestOptions.headers
-		    .emplace_back(header.name.c_str(), header.value.c_str(), job->stringAllocator);
+bool ESPFetch::attachToInflightJob(std::unique_ptr<FetchJob> &job) {
+	// Everything that can change the response or its truncation is part of the key; timeouts and
+	// priorities are not.
+	const auto &transport = job->transport;
+	char settings[160];
+	snprintf(
+	    settings,
+	    sizeof(settings),
+	    "|%p|%d%d%d%d|%d|%d|%d|%d|%d|%lu|%lu|%d",
+	    static_cast<const void *>(transport.tls.caCertPem),
+	    transport.tls.useTlsCertBundle ? 1 : 0,
+	    transport.tls.useGlobalCaStore ? 1 : 0,
+	    transport.tls.skipTlsServerCertValidation ? 1 : 0,
+	    transport.tls.skipTlsCommonNameCheck ? 1 : 0,
+	    static_cast<int>(transport.tlsVersion),
+	    static_cast<int>(transport.tlsDynBufferStrategy),
+	    transport.rxBufferSize,
+	    transport.txBufferSize,
+	    job->requestOptions.allowRedirects ? 1 : 0,
+	    static_cast<unsigned long>(job->bodyLimit),
+	    static_cast<unsigned long>(job->headerLimit),
+	    job->parseBody ? 1 : 0
+	);
+
+	FetchString &key = job->coalescingKey;
+	key.assign(job->url.c_str(), job->url.size());
+	key.append(settings);
+	job->requestOptions.forEachHeader([&key](const InternalFetchHeader &header) {
+		key.push_back('\n');
+		key.append(header.name.c_str(), header.name.size());
+		key.push_back(':');
+		key.append(header.value.c_str(), header.value.size());
+	});
+	for (uint32_t hash : job->requestOptions.captureHeaderHashes) {
+		char hashText[12];
+		snprintf(hashText, sizeof(hashText), "#%08lx", static_cast<unsigned long>(hash));
+		key.append(hashText);
 	}
-	job->callback = std::move(callback);
-	job->syncHandle = std::move(syncHandle);
 
-	job->bodyLimit =
-	    job->requestOptions.maxBodyBytes ? job->requestOptions.maxBodyBytes : _config.maxBodyBytes;
-	job->headerLimit = job->requestOptions.maxHeaderBytes ? job->requestOptions.maxHeaderBytes
-	                                                      : _config.maxHeaderBytes;
-	if (job->bodyLimit == 0) {
-		job->bodyLimit = std::numeric_limits<size_t>::max();
+	{
+		SchedulerLock lock(_schedulerMutex);
+		for (FetchJob *inflight : _coalescingJobs) {
+			if (inflight->coalescingKey == key) {
+				inflight->coalescedWaiters.push_back(FetchJob::CoalescedWaiter{
+				    std::move(job->callback), std::move(job->syncHandle), std::move(job->control)
+				});
+				_stats.recordCoalesced();
+				ESP_LOGD(TAG, "Coalesced GET %s onto an in-flight request", job->url.c_str());
+				job.reset();
+				return true;
+			}
+		}
+		_coalescingJobs.push_back(job.get());
+		job->coalescing = true;
 	}
-	if (job->headerLimit == 0) {
-		job->headerLimit = std::numeric_limits<size_t>::max();
+	return false;
+}
+
+void ESPFetch::deliverCoalescedResults(FetchJob &job, const JsonDocument &result) {
+	std::vector<FetchJob::CoalescedWaiter> waiters;
+	{
+		SchedulerLock lock(_schedulerMutex);
+		auto it = std::find(_coalescingJobs.begin(), _coalescingJobs.end(), &job);
+		if (it != _coalescingJobs.end()) {
+			_coalescingJobs.erase(it);
+		}
+		waiters.swap(job.coalescedWaiters);
+		job.coalescing = false;
 	}
+	for (auto &waiter : waiters) {
+		if (waiter.control && waiter.control->cancelled.load(std::memory_order_acquire)) {
+			deliverDocument(waiter.callback, waiter.syncHandle, buildCancelledResult(job));
+		} else {
+			deliverDocument(waiter.callback, waiter.syncHandle, JsonDocument(result));
+		}
+		if (waiter.control) {
+			waiter.control->finished.store(true, std::memory_order_release);
+		}
+	}
+}
 
-	size_t reserveBytes = job->bodyLimit == std::numeric_limits<size_t>::max()
-	                          ? static_cast<size_t>(1024)
-	                          : std::min(job->bodyLimit, static_cast<size_t>(1024));
-	job->response.body.reserve(reserveBytes);
+JsonDocument ESPFetch::buildCancelledResult(const FetchJob &job) const {
+	FetchResponse response(job.transport.usePSRAMBuffers);
+	response.error = ESP_ERR_INVALID_STATE;
+	response.timing.queuedUs = job.response.timing.queuedUs;
+	return buildResult(job, response);
+}
 
-	size_t stackSize = _config.stackSize;
-	if (stackSize == 0) {
-		ESP_LOGE(TAG, "Invalid stack size for fetch worker");
-		if (startErrorOut != nullptr) {
-			*startErrorOut = "invalid stack size for fetch worker";
-		}
-		xSemaphoreGive(_slotSemaphore);
+void ESPFetch::runExchange(FetchJob &job, esp_http_client_handle_t client, bool reusedConnection) {
+	if (job.isStream) {
+		runStreamExchange(job, client);
+	} else if (job.isUpload) {
+		runUploadExchange(job, client);
+	} else if (job.parseBody) {
+		runParsedBodyExchange(job, client);
+	} else {
+		runBufferedExchange(job, client, reusedConnection);
+	}
+	if (job.inflateError == ESP_OK && job.inflating && !job.inflater->finished() &&
+	    job.inflater->consumedBytes() > 0 && !job.response.bodyTruncated &&
+	    job.streamAbortError == ESP_OK && !job.streamStartRejected) {
+		// The body ended before the compressed stream did.
+		job.inflateError = ESP_ERR_INVALID_RESPONSE;
+	}
+	if (job.response.error == ESP_OK && job.inflateError != ESP_OK) {
+		job.response.error = job.inflateError;
+	}
+}
+
+// Decides whether the attempt that just finished is repeated. If so, waits out the backoff and
+// resets the response so the next attempt starts clean on the same handle.
+bool ESPFetch::prepareRetry(FetchJob &job, esp_http_client_handle_t client, uint8_t attempt) {
+	const FetchRetryPolicy &policy = job.requestOptions.retry;
+	// Streams resume on their own, and a producer's body cannot be replayed.
+	if (attempt >= policy.maxAttempts || job.isStream || (job.isUpload && job.uploadProducer) ||
+	    checkStop(job) != ESP_OK) {
 		return false;
 	}
 
-	_activeTasks.fetch_add(1, std::memory_order_acq_rel);
+	const esp_err_t error = job.response.error;
+	const int statusCode = job.response.statusCode;
+	const bool retryable = error == ESP_OK
+	                           ? esp_fetch_detail::isFetchRetryableStatus(policy, statusCode)
+	                           : esp_fetch_detail::isFetchRetryableError(policy, error);
+	// Nothing reached the server when the connect failed, so that is safe to repeat for any method.
+	if (!retryable || (!isIdempotentHttpMethod(job.method) && !policy.retryNonIdempotent &&
+	                   error != ESP_ERR_HTTP_CONNECT)) {
+		return false;
+	}
 
-	FetchJob *jobPtr = job.release();
-	TaskHandle_t taskHandle = nullptr;
-	const BaseType_t created = xTaskCreatePinnedToCore(
-	    &ESPFetch::requestTask,
-	    "esp-fetch",
-	    stackSize,
-	    jobPtr,
-	    _config.priority,
-	    &taskHandle,
-	    _config.coreId
+	uint32_t retryAfterMs = 0;
+	if (error == ESP_OK && (statusCode == 429 || statusCode == 503)) {
+		if (const FetchString *retryAfter = job.response.header("Retry-After")) {
+			retryAfterMs = esp_fetch_detail::parseFetchRetryAfterMs(retryAfter->c_str());
+		}
+	}
+	const uint32_t delayMs =
+	    esp_fetch_detail::fetchRetryDelayMs(policy, attempt, esp_random(), retryAfterMs);
+	ESP_LOGW(
+	    TAG,
+	    "Attempt %u for %s failed (%s, status %d); retrying in %lu ms",
+	    (unsigned)attempt,
+	    job.url.c_str(),
+	    esp_err_to_name(error),
+	    statusCode,
+	    static_cast<unsigned long>(delayMs)
 	);
-	if (created != pdPASS) {
-		ESP_LOGE(TAG, "Failed to spawn fetch task");
-		if (startErrorOut != nullptr) {
-			*startErrorOut = "failed to spawn fetch task";
+	esp_http_client_close(client);
+
+	// Sleep in slices so deinit(), cancel() and deadlines do not wait out a long backoff.
+	for (uint32_t waitedMs = 0; waitedMs < delayMs; waitedMs += FETCH_RETRY_WAIT_SLICE_MS) {
+		if (_teardownRequested.load(std::memory_order_acquire) || checkStop(job) != ESP_OK) {
+			return false;
 		}
-		_activeTasks.fetch_sub(1, std::memory_order_acq_rel);
-		delete jobPtr;
-		xSemaphoreGive(_slotSemaphore);
+		vTaskDelay(pdMS_TO_TICKS(std::min(FETCH_RETRY_WAIT_SLICE_MS, delayMs - waitedMs)));
+	}
+	if (_teardownRequested.load(std::memory_order_acquire) || checkStop(job) != ESP_OK) {
 		return false;
 	}
+	if (!job.circuitKey.empty() && !_circuitBreaker.allow(job.circuitKey)) {
+		// Other requests opened the origin's circuit while this one was waiting.
+		return false;
+	}
+
+	FetchResponse &response = job.response;
+	response.error = ESP_OK;
+	response.statusCode = 0;
+	response.body.clear();
+	response.headers.clear();
+	response.headerBytes = 0;
+	response.bodyTruncated = false;
+	response.headersTruncated = false;
+	response.document.clear();
+	response.parseError = DeserializationError();
+	const int64_t queuedUs = response.timing.queuedUs;
+	response.timing = FetchTiming();
+	response.timing.queuedUs = queuedUs;
+	job.inflating = false;
+	job.inflateError = ESP_OK;
+	job.msgPackBody = false;
+	job.cacheEtag.clear();
+	job.cacheLastModified.clear();
+	job.cacheControl = esp_fetch_detail::FetchCacheControl();
+	esp_http_client_set_timeout_ms(client, attemptTimeoutMs(job));
+	_stats.recordRetry();
 	return true;
 }
 
-bool ESPFetch::enqueueStreamRequest(
-    const std::string &url,
-    FetchStreamStartCallback onStart,
-    FetchChunkCallback onChunk,
-    FetchStreamCallback onDone,
-    const FetchRequestOptions &options,
-    const char **startErrorOut
+void ESPFetch::runBufferedExchange(
+    FetchJob &job, esp_http_client_handle_t client, bool reusedConnection
 ) {
-	if (!isInitialized()) {
-		ESP_LOGE(TAG, "ESPFetch not initialized");
-		if (startErrorOut != nullptr) {
-			*startErrorOut = "ESPFetch not initialized";
-		}
-		return false;
+	job.response.error = esp_http_client_perform(client);
+	if (reusedConnection && job.response.error != ESP_OK && isIdempotentHttpMethod(job.method) &&
+	    !_teardownRequested.load(std::memory_order_acquire) && job.stopError == ESP_OK) {
+		// The peer may have dropped the idle connection; retry once on a fresh one.
+		ESP_LOGD(TAG, "Retrying %s on a fresh connection", job.url.c_str());
+		esp_http_client_close(client);
+		job.response.body.clear();
+		job.response.headers.clear();
+		job.response.headerBytes = 0;
+		job.response.bodyTruncated = false;
+		job.response.headersTruncated = false;
+		job.inflateError = ESP_OK;
+		job.response.error = esp_http_client_perform(client);
+	}
+	if (job.response.error == ESP_OK) {
+		job.response.statusCode = esp_http_client_get_status_code(client);
 	}
+}
 
-	if (!onChunk) {
-		ESP_LOGE(TAG, "getStream requires onChunk callback");
-		if (startErrorOut != nullptr) {
-			*startErrorOut = "getStream requires onChunk callback";
+esp_err_t
+ESPFetch::openResponse(FetchJob &job, esp_http_client_handle_t client, StreamStartInfo &startInfo) {
+	const bool followRedirects = job.requestOptions.allowRedirects && job.config->followRedirects;
+	// esp_http_client_open() sends headers only; post-field data goes out with perform(), so a
+	// buffered body is written here, again for every redirect hop and auth retry.
+	const size_t bodyLength = job.isUpload ? 0 : job.body.size();
+	for (;;) {
+		esp_err_t err = esp_http_client_open(client, static_cast<int>(bodyLength));
+		if (err != ESP_OK) {
+			return err;
 		}
-		return false;
+		if (bodyLength > 0 &&
+		    esp_http_client_write(client, job.body.data(), static_cast<int>(bodyLength)) !=
+		        static_cast<int>(bodyLength)) {
+			esp_http_client_close(client);
+			return ESP_ERR_HTTP_WRITE_DATA;
+		}
+
+		job.response.statusCode = 0;
+		job.response.headers.clear();
+		job.response.headerBytes = 0;
+		job.response.headersTruncated = false;
+		job.contentRange = esp_fetch_detail::FetchContentRange();
+
+		const int64_t fetchHeadersResult = esp_http_client_fetch_headers(client);
+		if (fetchHeadersResult < 0) {
+			esp_http_client_close(client);
+			return fetchHeadersResult == -ESP_ERR_HTTP_EAGAIN ? ESP_ERR_HTTP_READ_TIMEOUT
+			                                                  : ESP_ERR_HTTP_FETCH_HEADER;
+		}
+
+		job.response.statusCode = esp_http_client_get_status_code(client);
+		startInfo.statusCode = job.response.statusCode;
+		startInfo.contentLength = esp_http_client_get_content_length(client);
+		startInfo.isChunked = esp_http_client_is_chunked_response(client);
+		startInfo.isPartial = startInfo.statusCode == 206;
+		startInfo.rangeStart = job.contentRange.start;
+		startInfo.rangeEnd = job.contentRange.end;
+		startInfo.totalLength = job.contentRange.total;
+
+		if (!followRedirects) {
+			// Keep the response exactly as received.
+			return ESP_OK;
+		}
+
+		if (isRedirectHttpStatus(startInfo.statusCode)) {
+			int discardedLength = 0;
+			(void)esp_http_client_flush_response(client, &discardedLength);
+			err = esp_http_client_set_redirection(client);
+			esp_http_client_close(client);
+			if (err != ESP_OK) {
+				return err;
+			}
+			continue;
+		}
+
+		if (startInfo.statusCode == 401) {
+			err = esp_http_client_add_auth(client);
+			if (err != ESP_OK) {
+				esp_http_client_close(client);
+				return err;
+			}
+			int discardedLength = 0;
+			err = esp_http_client_flush_response(client, &discardedLength);
+			esp_http_client_close(client);
+			if (err != ESP_OK) {
+				return err;
+			}
+			continue;
+		}
+
+		return ESP_OK;
 	}
+}
 
-	const std::string normalizedUrl = normalizeUrl(url);
-	const auto resolvedTransport = resolveFetchTransportOptionsForJob(_config, options);
-	const char *transportError =
-	    esp_fetch_detail::validateFetchTransportOptions(normalizedUrl, resolvedTransport);
-	if (transportError != nullptr) {
-		ESP_LOGE(
+void ESPFetch::runStreamExchange(FetchJob &job, esp_http_client_handle_t client) {
+	bool resumed = false;
+	for (uint8_t attempt = 0;; ++attempt) {
+		if (attempt > 0) {
+			resumed = true;
+			if (!prepareStreamResume(job, client)) {
+				break;
+			}
+		}
+
+		StreamStartInfo startInfo;
+		job.response.error = openResponse(job, client, startInfo);
+		if (job.response.error == ESP_OK && attempt == 0) {
+			ESP_LOGD(
+			    TAG,
+			    "Stream transport for %s: tlsVersion=%s tlsDynBufferStrategy=%s rxBuffer=%d txBuffer=%d placement=%s",
+			    job.url.c_str(),
+			    fetchTlsVersionToString(job.transport.tlsVersion),
+			    fetchTlsDynBufferStrategyToString(job.transport.tlsDynBufferStrategy),
+			    job.transport.rxBufferSize,
+			    job.transport.txBufferSize,
+			    fetchBufferPlacementToString(job.transport.usePSRAMBuffers)
+			);
+
+			if (job.onStart && !invokeFetchStartCallback(job.onStart, startInfo)) {
+				job.streamStartRejected = true;
+				job.response.error = ESP_OK;
+				esp_http_client_close(client);
+				break;
+			}
+		} else if (job.response.error == ESP_OK) {
+			// A resumed response must continue exactly where the previous attempt stopped.
+			const int64_t expected =
+			    static_cast<int64_t>(job.requestOptions.rangeStart + job.receivedBytes);
+			if (!startInfo.isPartial || startInfo.rangeStart != expected) {
+				ESP_LOGW(
+				    TAG,
+				    "Cannot resume %s at byte %lld (status %d)",
+				    job.url.c_str(),
+				    (long long)expected,
+				    startInfo.statusCode
+				);
+				job.response.error = ESP_ERR_NOT_SUPPORTED;
+				esp_http_client_close(client);
+				break;
+			}
+		}
+
+		if (job.response.error == ESP_OK) {
+			// The ring carries raw network buffers, so decoded streams are delivered inline.
+			if (job.requestOptions.streamBufferCount <= 1 || job.inflating ||
+			    !runPipelinedStreamReads(job, client)) {
+				readStreamInline(job, client);
+			}
+			esp_http_client_close(client);
+		}
+
+		// Range offsets count encoded bytes, which a decoded stream does not track.
+		if (attempt >= job.resumeAttempts || job.streamAbortError != ESP_OK || job.inflating ||
+		    !esp_fetch_detail::isFetchResumableStreamError(job.response.error) ||
+		    _teardownRequested.load(std::memory_order_acquire) || checkStop(job) != ESP_OK) {
+			break;
+		}
+		ESP_LOGW(
 		    TAG,
-		    "Rejected stream request for %s: %s",
-		    normalizedUrl.c_str(),
-		    transportError
+		    "Stream %s interrupted after %u bytes (%s); resuming",
+		    job.url.c_str(),
+		    (unsigned)job.receivedBytes,
+		    esp_err_to_name(job.response.error)
 		);
-		if (startErrorOut != nullptr) {
-			*startErrorOut = transportError;
-		}
-		return false;
+		vTaskDelay(pdMS_TO_TICKS(job.resumeDelayMs));
+		esp_http_client_set_timeout_ms(client, attemptTimeoutMs(job));
 	}
 
-	if (xSemaphoreTake(_slotSemaphore, _config.slotAcquireTicks) != pdTRUE) {
-		ESP_LOGW(TAG, "No available fetch slots");
-		if (startErrorOut != nullptr) {
-			*startErrorOut = "no available fetch slots";
+	if (resumed) {
+		// The resume Range header is not part of the job's header list; strip it before the
+		// handle can be cached for TLS resumption.
+		esp_http_client_delete_header(client, "Range");
+	}
+}
+
+bool ESPFetch::prepareStreamResume(FetchJob &job, esp_http_client_handle_t client) {
+	const uint64_t offset = job.requestOptions.rangeStart + job.receivedBytes;
+	int64_t remaining = -1;
+	if (job.requestOptions.rangeLength > 0) {
+		remaining = job.requestOptions.rangeLength - static_cast<int64_t>(job.receivedBytes);
+		if (remaining <= 0) {
+			job.response.error = ESP_OK;
+			return false;
 		}
-		return false;
 	}
 
-	auto job = std::make_unique<FetchJob>(resolvedTransport);
-	job->owner = this;
-	job->url.assign(normalizedUrl.c_str(), normalizedUrl.size());
-	job->method = HTTP_METHOD_GET;
-	populateInternalFetchRequestOptions(job->requestOptions, options);
-	job->requestOptions.headers.clear();
-	job->requestOptions.headers.reserve(options.headers.size());
-	for (const auto &header : options.headers) {
-		job->requestOptions.headers
-		    .emplace_back(header.name.c_str(), header.value.c_str(), job->stringAllocator);
+	char range[48];
+	if (!esp_fetch_detail::formatFetchRangeHeader(offset, remaining, range, sizeof(range))) {
+		return false;
 	}
+	esp_http_client_set_header(client, "Range", range);
+	return true;
+}
 
-	job->isStream = true;
-	job->onStart = std::move(onStart);
-	job->onChunk = std::move(onChunk);
-	job->onDone = std::move(onDone);
-	job->receivedBytes = 0;
-	job->streamAbortError = ESP_OK;
-	job->streamStartRejected = false;
+void ESPFetch::readStreamInline(FetchJob &job, esp_http_client_handle_t client) {
+	FetchVector<char> readBuffer(
+	    resolveReadBufferSize(job.transport),
+	    '\0',
+	    job.scratchAllocator
+	);
 
-	// For streaming, default to "unlimited" unless the caller explicitly sets maxBodyBytes.
-	job->bodyLimit = job->requestOptions.maxBodyBytes ? job->requestOptions.maxBodyBytes
-	                                                  : std::numeric_limits<size_t>::max();
-	job->headerLimit = job->requestOptions.maxHeaderBytes ? job->requestOptions.maxHeaderBytes
-	                                                      : _config.maxHeaderBytes;
-	if (job->headerLimit == 0) {
-		job->headerLimit = std::numeric_limits<size_t>::max();
+	// Hands one span of body bytes to onChunk; false once the stream has to stop.
+	auto deliver = [&job](const char *data, size_t length) {
+		size_t toSend = length;
+		if (job.bodyLimit != std::numeric_limits<size_t>::max()) {
+			if (job.receivedBytes >= job.bodyLimit) {
+				job.streamAbortError = ESP_ERR_INVALID_SIZE;
+				job.response.error = job.streamAbortError;
+				return false;
+			}
+			const size_t remaining = job.bodyLimit - job.receivedBytes;
+			toSend = std::min(toSend, remaining);
+		}
+
+		if (toSend > 0 && job.onChunk && !invokeFetchChunkCallback(job.onChunk, data, toSend)) {
+			job.streamAbortError = ESP_ERR_INVALID_STATE;
+			job.response.error = job.streamAbortError;
+			return false;
+		}
+
+		job.receivedBytes += toSend;
+		if (toSend < length) {
+			job.streamAbortError = ESP_ERR_INVALID_SIZE;
+			job.response.error = job.streamAbortError;
+			return false;
+		}
+		return true;
+	};
+
+	while (job.response.error == ESP_OK) {
+		if (checkStop(job) != ESP_OK) {
+			job.streamAbortError = job.stopError;
+			job.response.error = job.streamAbortError;
+			break;
+		}
+		const int readResult =
+		    esp_http_client_read(client, readBuffer.data(), static_cast<int>(readBuffer.size()));
+		if (readResult < 0) {
+			job.response.error = mapStreamReadFailure(client, readResult);
+			break;
+		}
+		if (readResult == 0) {
+			if (!esp_http_client_is_complete_data_received(client)) {
+				job.response.error = mapStreamReadFailure(client, readResult);
+			}
+			break;
+		}
+
+		if (!job.inflating) {
+			if (!deliver(readBuffer.data(), static_cast<size_t>(readResult))) {
+				break;
+			}
+			continue;
+		}
+
+		// Decoded spans go to onChunk straight from the inflater window.
+		const esp_err_t err = job.inflater->feed(
+		    reinterpret_cast<const uint8_t *>(readBuffer.data()),
+		    static_cast<size_t>(readResult),
+		    [&deliver](const uint8_t *decoded, size_t length) {
+			    return deliver(reinterpret_cast<const char *>(decoded), length);
+		    }
+		);
+		if (err != ESP_OK) {
+			if (job.response.error == ESP_OK) {
+				job.inflateError = err;
+			}
+			break;
+		}
+		if (job.inflater->finished()) {
+			break;
+		}
 	}
+}
 
-	size_t stackSize = _config.stackSize;
-	if (stackSize == 0) {
-		ESP_LOGE(TAG, "Invalid stack size for fetch worker");
-		if (startErrorOut != nullptr) {
-			*startErrorOut = "invalid stack size for fetch worker";
+bool ESPFetch::runPipelinedStreamReads(FetchJob &job, esp_http_client_handle_t client) {
+	const size_t bufferCount = job.requestOptions.streamBufferCount;
+	const size_t bufferSize = job.requestOptions.streamBufferSize
+	                              ? job.requestOptions.streamBufferSize
+	                              : resolveReadBufferSize(job.transport);
+	FetchAllocator<char> ringAllocator(job.scratchAllocator);
+	char *ownedRing = nullptr;
+	char *ring = reinterpret_cast<char *>(job.requestOptions.streamBuffers);
+	if (ring == nullptr) {
+		ownedRing = ringAllocator.allocate(bufferCount * bufferSize);
+		ring = ownedRing;
+	}
+
+	// The consumer runs onChunk, so it gets the stack, priority and core of the job's lane.
+	const FetchLane task = esp_fetch_detail::fetchLaneSettings(*job.config, job.lane);
+	FetchStreamPipeline pipeline(ring, bufferCount, bufferSize, job.onChunk, task.coreId);
+	if (ring == nullptr || bufferSize == 0 || !pipeline.start(task.stackSize, task.priority)) {
+		ESP_LOGW(TAG, "Stream buffer ring unavailable for %s; reading inline", job.url.c_str());
+		if (ownedRing) {
+			ringAllocator.deallocate(ownedRing, bufferCount * bufferSize);
 		}
-		xSemaphoreGive(_slotSemaphore);
 		return false;
 	}
 
-	_activeTasks.fetch_add(1, std::memory_order_acq_rel);
+	size_t queuedBytes = job.receivedBytes;
+	while (job.response.error == ESP_OK && !pipeline.rejected()) {
+		if (checkStop(job) != ESP_OK) {
+			job.streamAbortError = job.stopError;
+			job.response.error = job.streamAbortError;
+			break;
+		}
+		size_t index = 0;
+		char *buffer = pipeline.acquire(index);
+		if (buffer == nullptr) {
+			job.response.error = ESP_ERR_NO_MEM;
+			break;
+		}
 
-	FetchJob *jobPtr = job.release();
-	TaskHandle_t taskHandle = nullptr;
-	const BaseType_t created = xTaskCreatePinnedToCore(
-	    &ESPFetch::requestTask,
-	    "esp-fetch",
-	    stackSize,
-	    jobPtr,
-	    _config.priority,
-	    &taskHandle,
-	    _config.coreId
-	);
-	if (created != pdPASS) {
-		ESP_LOGE(TAG, "Failed to spawn fetch task");
-		if (startErrorOut != nullptr) {
-			*startErrorOut = "failed to spawn fetch task";
+		const int readResult = esp_http_client_read(client, buffer, static_cast<int>(bufferSize));
+		if (readResult <= 0) {
+			pipeline.recycle(index);
+			if (readResult < 0 || !esp_http_client_is_complete_data_received(client)) {
+				job.response.error = mapStreamReadFailure(client, readResult);
+			}
+			break;
+		}
+
+		size_t toSend = static_cast<size_t>(readResult);
+		if (job.bodyLimit != std::numeric_limits<size_t>::max()) {
+			const size_t remaining = job.bodyLimit > queuedBytes ? job.bodyLimit - queuedBytes : 0;
+			toSend = std::min(toSend, remaining);
+		}
+		if (toSend > 0) {
+			pipeline.submit(index, toSend);
+			queuedBytes += toSend;
+		} else {
+			pipeline.recycle(index);
+		}
+		if (toSend < static_cast<size_t>(readResult)) {
+			job.streamAbortError = ESP_ERR_INVALID_SIZE;
+			job.response.error = job.streamAbortError;
+			break;
 		}
-		_activeTasks.fetch_sub(1, std::memory_order_acq_rel);
-		delete jobPtr;
-		xSemaphoreGive(_slotSemaphore);
-		return false;
+	}
+
+	pipeline.finish();
+	job.receivedBytes += pipeline.deliveredBytes();
+	if (pipeline.rejected()) {
+		job.streamAbortError = ESP_ERR_INVALID_STATE;
+		job.response.error = job.streamAbortError;
+	}
+	if (ownedRing) {
+		ringAllocator.deallocate(ownedRing, bufferCount * bufferSize);
 	}
 	return true;
 }
 
-JsonDocument
-ESPFetch::waitForResult(const std::shared_ptr<SyncHandle> &handle, TickType_t waitTicks) const {
-	JsonDocument doc;
-	if (!handle || !handle->done) {
-		doc["ok"] = false;
-		doc["error"]["message"] = "invalid sync handle";
-		return doc;
+void ESPFetch::runParsedBodyExchange(FetchJob &job, esp_http_client_handle_t client) {
+	StreamStartInfo startInfo;
+	job.response.error = openResponse(job, client, startInfo);
+	if (job.response.error != ESP_OK) {
+		return;
 	}
 
-	if (xSemaphoreTake(handle->done, waitTicks) == pdTRUE && handle->ready) {
-		doc = handle->doc;
-	} else if (handle->ready) {
-		doc = handle->doc;
-	} else {
-		doc["ok"] = false;
-		doc["error"]["message"] = "timeout waiting for fetch result";
-	}
-	return doc;
+	readParsedBody(job, client);
+	esp_http_client_close(client);
 }
 
-void ESPFetch::requestTask(void *arg) {
-	auto job = std::unique_ptr<FetchJob>(static_cast<FetchJob *>(arg));
-	if (!job || !job->owner) {
-		if (job && job->owner) {
-			job->owner->_activeTasks.fetch_sub(1, std::memory_order_acq_rel);
+void ESPFetch::runUploadExchange(FetchJob &job, esp_http_client_handle_t client) {
+	std::unique_ptr<FetchDeflater> deflater;
+	const FetchBodyEncoding encoding = job.requestOptions.compressBody;
+	if (encoding != FetchBodyEncoding::Identity) {
+		deflater = std::make_unique<FetchDeflater>(job.transport.usePSRAMBuffers);
+	}
+	FetchBodyWriter writer(client, job.uploadLength, deflater.get());
+	if (deflater) {
+		const auto deflaterEncoding = encoding == FetchBodyEncoding::Gzip
+		                                  ? FetchDeflater::Encoding::Gzip
+		                                  : FetchDeflater::Encoding::Deflate;
+		if (!deflater->begin(deflaterEncoding, &FetchBodyWriter::sendEncoded, &writer)) {
+			ESP_LOGE(TAG, "Failed to allocate body encoder for %s", job.url.c_str());
+			job.response.error = ESP_ERR_NO_MEM;
+			return;
 		}
-		vTaskDelete(nullptr);
+		esp_http_client_set_header(
+		    client, "Content-Encoding", FetchDeflater::contentEncoding(deflaterEncoding)
+		);
+	}
+
+	// The body is produced once, so redirects and auth challenges are reported, not replayed.
+	job.response.error =
+	    esp_http_client_open(client, writer.chunked() ? -1 : static_cast<int>(job.uploadLength));
+	if (job.response.error != ESP_OK) {
 		return;
 	}
-	job->owner->runJob(std::move(job));
-	vTaskDelete(nullptr);
-}
 
-esp_err_t ESPFetch::handleHttpEvent(esp_http_client_event_t *event) {
-	if (!event || !event->user_data) {
-		return ESP_OK;
+	bool produced = true;
+	if (job.uploadProducer) {
+		produced = invokeFetchBodyProducer(job.uploadProducer, writer);
+	} else {
+		// A buffered post() body that is compressed on the way out.
+		produced = writer.write(reinterpret_cast<const uint8_t *>(job.body.data()), job.body.size()) ==
+		           job.body.size();
 	}
-	auto *job = static_cast<FetchJob *>(event->user_data);
-	if (job->owner && job->owner->_teardownRequested.load(std::memory_order_acquire)) {
-		if (job->isStream && job->streamAbortError == ESP_OK) {
-			job->streamAbortError = ESP_ERR_INVALID_STATE;
-		}
-		return ESP_FAIL;
+	if (!produced) {
+		ESP_LOGW(TAG, "Upload to %s aborted by body producer", job.url.c_str());
+		job.response.error = writer.error() != ESP_OK ? writer.error() : ESP_ERR_INVALID_STATE;
+	} else if (!writer.finish()) {
+		job.response.error = writer.error();
+	}
+	job.bytesOut = writer._sent;
+	if (job.response.error != ESP_OK) {
+		esp_http_client_close(client);
+		return;
 	}
 
-	switch (event->event_id) {
-	case HTTP_EVENT_ON_DATA:
-		if (event->data && event->data_len > 0) {
-			// Stream mode: do NOT buffer body; forward chunks directly.
-			if (job->isStream) {
-				break;
-			} else {
-				// JSON mode (existing): buffer into response.body with limit/truncation.
-				size_t available = job->response.body.size() < job->bodyLimit
-				                       ? (job->bodyLimit - job->response.body.size())
-				                       : 0;
-				size_t copyLen = std::min(available, static_cast<size_t>(event->data_len));
-				if (copyLen > 0) {
-					job->response.body.append(static_cast<const char *>(event->data), copyLen);
-				}
-				if (copyLen < static_cast<size_t>(event->data_len)) {
-					job->response.bodyTruncated = true;
-				}
+	const int64_t fetchHeadersResult = esp_http_client_fetch_headers(client);
+	if (fetchHeadersResult < 0) {
+		job.response.error = fetchHeadersResult == -ESP_ERR_HTTP_EAGAIN ? ESP_ERR_HTTP_READ_TIMEOUT
+		                                                                : ESP_ERR_HTTP_FETCH_HEADER;
+		esp_http_client_close(client);
+		return;
+	}
+	job.response.statusCode = esp_http_client_get_status_code(client);
+
+	if (job.parseBody) {
+		readParsedBody(job, client);
+	} else {
+		readBufferedBody(job, client);
+	}
+	esp_http_client_close(client);
+}
+
+void ESPFetch::readParsedBody(FetchJob &job, esp_http_client_handle_t client) {
+	FetchVector<char> readBuffer(
+	    resolveReadBufferSize(job.transport),
+	    '\0',
+	    job.scratchAllocator
+	);
+	FetchHttpBodyReader reader(
+	    client,
+	    readBuffer.data(),
+	    readBuffer.size(),
+	    job.bodyLimit,
+	    job.inflating ? job.inflater.get() : nullptr
+	);
+	reader.stopWhen([this, &job]() { return checkStop(job); });
+
+	// Parse straight off the socket into the result document; the raw body is never stored.
+	JsonVariant target = job.response.document["json"].to<JsonVariant>();
+	if (job.msgPackBody && job.bodyFilter.isNull()) {
+		job.response.parseError = deserializeMsgPack(target, reader);
+	} else if (job.msgPackBody) {
+		job.response.parseError =
+		    deserializeMsgPack(target, reader, DeserializationOption::Filter(job.bodyFilter));
+	} else if (job.bodyFilter.isNull()) {
+		job.response.parseError = deserializeJson(target, reader);
+	} else {
+		job.response.parseError =
+		    deserializeJson(target, reader, DeserializationOption::Filter(job.bodyFilter));
+	}
+
+	job.response.error = reader.error();
+	job.response.bodyTruncated = reader.truncated();
+}
+
+void ESPFetch::readBufferedBody(FetchJob &job, esp_http_client_handle_t client) {
+	FetchVector<char> readBuffer(
+	    resolveReadBufferSize(job.transport),
+	    '\0',
+	    job.scratchAllocator
+	);
+
+	for (;;) {
+		if (checkStop(job) != ESP_OK) {
+			job.response.error = job.stopError;
+			return;
+		}
+		const int readResult =
+		    esp_http_client_read(client, readBuffer.data(), static_cast<int>(readBuffer.size()));
+		if (readResult < 0) {
+			job.response.error = mapStreamReadFailure(client, readResult);
+			return;
+		}
+		if (readResult == 0) {
+			if (!esp_http_client_is_complete_data_received(client)) {
+				job.response.error = mapStreamReadFailure(client, readResult);
 			}
+			return;
 		}
-		break;
 
-	case HTTP_EVENT_ON_HEADER:
-		if (event->header_key && event->header_value) {
-			size_t projected = 0;
-			for (const auto &hdr : job->response.headers) {
-				projected += hdr.name.size() + hdr.value.size();
+		if (job.inflating) {
+			const esp_err_t err = job.inflater->feed(
+			    reinterpret_cast<const uint8_t *>(readBuffer.data()),
+			    static_cast<size_t>(readResult),
+			    [&job](const uint8_t *decoded, size_t length) {
+				    return appendFetchBody(
+				        job.response.body,
+				        job.bodyLimit,
+				        reinterpret_cast<const char *>(decoded),
+				        length
+				    );
+			    }
+			);
+			if (err == ESP_ERR_INVALID_STATE) {
+				job.response.bodyTruncated = true;
+				return;
 			}
-			projected += strlen(event->header_key) + strlen(event->header_value);
-			if (projected <= job->headerLimit) {
-				job->response.headers.emplace_back(
-				    event->header_key,
-				    event->header_value,
-				    job->response.charAllocator
-				);
-			} else {
-				job->response.headersTruncated = true;
+			if (err != ESP_OK) {
+				job.inflateError = err;
+				return;
+			}
+			if (job.inflater->finished()) {
+				return;
 			}
+		} else if (!appendFetchBody(
+		               job.response.body,
+		               job.bodyLimit,
+		               readBuffer.data(),
+		               static_cast<size_t>(readResult)
+		           )) {
+			job.response.bodyTruncated = true;
+			return;
 		}
-		break;
-
-	default:
-		break;
 	}
-	return ESP_OK;
 }
 
-void ESPFetch::runJob(std::unique_ptr<FetchJob> job) {
-	if (!job) {
+void ESPFetch::assignConnectionKey(FetchJob &job) const {
+	esp_fetch_detail::FetchUrlOrigin origin;
+	if (!_connectionPool.enabled() ||
+	    !esp_fetch_detail::parseFetchUrlOrigin(std::string(job.url.c_str(), job.url.size()), origin)) {
 		return;
 	}
 
-	const int64_t start = esp_timer_get_time();
+	job.tlsSessionCapable = origin.https && _connectionPool.keepsTlsSessions();
+	// Read-loop jobs always close their connection, so only the TLS session is worth caching.
+	const bool canKeepOpen = !job.usesReadLoop() && _connectionPool.keepsConnections();
+	if (!canKeepOpen && !job.tlsSessionCapable) {
+		return;
+	}
 
-	if (_teardownRequested.load(std::memory_order_acquire)) {
-		job->response.error = ESP_ERR_INVALID_STATE;
-	} else {
-		esp_http_client_config_t config = {};
-		config.url = job->url.c_str();
-		config.method = job->method;
-		config.timeout_ms = job->requestOptions.timeoutMs ? job->requestOptions.timeoutMs
-		                                                  : _config.defaultTimeoutMs;
-		config.buffer_size = job->transport.rxBufferSize;
-		config.buffer_size_tx = job->transport.txBufferSize;
-		config.event_handler = &ESPFetch::handleHttpEvent;
-		config.user_data = job.get();
-		config.disable_auto_redirect =
-		    !(job->requestOptions.allowRedirects && _config.followRedirects);
-		config.cert_pem = job->transport.tls.caCertPem;
-		config.use_global_ca_store = job->transport.tls.useGlobalCaStore;
-		config.skip_cert_common_name_check = job->transport.tls.skipTlsCommonNameCheck;
-		config.tls_version = mapFetchTlsVersion(job->transport.tlsVersion);
-#if ESP_FETCH_HAVE_CRT_BUNDLE
-		if (job->transport.tls.useTlsCertBundle) {
-			config.crt_bundle_attach = esp_crt_bundle_attach;
+	job.connectionKey = buildConnectionKey(
+	    origin,
+	    job.transport,
+	    !(job.requestOptions.allowRedirects && job.config->followRedirects),
+	    job.stringAllocator
+	);
+}
+
+// Points a handle kept from an earlier request at this job; on failure the handle is cleaned up.
+bool ESPFetch::retargetClient(
+    FetchJob &job, esp_http_client_handle_t client, bool connected, int timeoutMs, bool &reused
+) const {
+	if (esp_http_client_set_url(client, job.clientUrl()) != ESP_OK) {
+		esp_http_client_cleanup(client);
+		return false;
+	}
+	esp_http_client_set_method(client, job.method);
+	esp_http_client_set_timeout_ms(client, timeoutMs);
+	esp_http_client_set_user_data(client, &job);
+	if (connected && job.usesReadLoop()) {
+		// The read loop drives open/read itself and expects a closed connection.
+		esp_http_client_close(client);
+		connected = false;
+	}
+	reused = connected;
+	return true;
+}
+
+esp_http_client_handle_t ESPFetch::acquireClient(FetchJob &job, bool &reused) {
+	reused = false;
+	const int timeoutMs = attemptTimeoutMs(job);
+
+	// A kept handle only fits when it was created with the TLS server name this job needs.
+	const auto sameServerName = [&job](const FetchDnsName &name) {
+		return job.tlsServerName == nullptr ? name == nullptr
+		                                    : name != nullptr && *name == job.tlsServerName;
+	};
+	if (!job.connectionKey.empty()) {
+		bool connected = false;
+		FetchDnsName serverName;
+		esp_http_client_handle_t pooled =
+		    _connectionPool.acquire(job.connectionKey, connected, serverName);
+		if (pooled && !sameServerName(serverName)) {
+			esp_http_client_cleanup(pooled);
+		} else if (pooled && retargetClient(job, pooled, connected, timeoutMs, reused)) {
+			job.clientServerName = std::move(serverName);
+			return pooled;
+		}
+	} else if (job.batchConnection && job.batchConnection->client) {
+		esp_http_client_handle_t carried = job.batchConnection->client;
+		FetchDnsName serverName = std::move(job.batchConnection->serverName);
+		job.batchConnection->client = nullptr;
+		if (!sameServerName(serverName)) {
+			esp_http_client_cleanup(carried);
+		} else if (retargetClient(
+		               job, carried, job.batchConnection->connected, timeoutMs, reused
+		           )) {
+			job.clientServerName = std::move(serverName);
+			return carried;
 		}
+	}
+
+	esp_http_client_config_t config = {};
+	config.url = job.clientUrl();
+	config.method = job.method;
+	config.timeout_ms = timeoutMs;
+	config.buffer_size = job.transport.rxBufferSize;
+	config.buffer_size_tx = job.transport.txBufferSize;
+	config.event_handler = &ESPFetch::handleHttpEvent;
+	config.user_data = &job;
+	config.disable_auto_redirect =
+	    !(job.requestOptions.allowRedirects && job.config->followRedirects);
+	config.cert_pem = job.transport.tls.caCertPem;
+	config.use_global_ca_store = job.transport.tls.useGlobalCaStore;
+	config.skip_cert_common_name_check = job.transport.tls.skipTlsCommonNameCheck;
+	// Without it the TLS server name (SNI and certificate check) would be the cached address.
+	config.common_name = job.tlsServerName;
+	job.clientServerName = job.tlsServerName ? job.dnsName : nullptr;
+	config.tls_version = mapFetchTlsVersion(job.transport.tlsVersion);
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+	// The transport keeps the ticket across reconnects of this handle.
+	config.save_client_session = job.tlsSessionCapable;
+#endif
+#if ESP_FETCH_HAVE_CRT_BUNDLE
+	if (job.transport.tls.useTlsCertBundle) {
+		config.crt_bundle_attach = esp_crt_bundle_attach;
+	}
 #endif
 #if defined(CONFIG_MBEDTLS_DYNAMIC_BUFFER)
-		if (job->transport.tlsDynBufferStrategy ==
-		    FetchTlsDynBufferStrategy::RxStaticAfterHandshake) {
-			config.tls_dyn_buf_strategy = HTTP_TLS_DYN_BUF_RX_STATIC;
-		}
+	if (job.transport.tlsDynBufferStrategy == FetchTlsDynBufferStrategy::RxStaticAfterHandshake) {
+		config.tls_dyn_buf_strategy = HTTP_TLS_DYN_BUF_RX_STATIC;
+	}
 #endif
 
-		esp_http_client_handle_t client = esp_http_client_init(&config);
-		if (!client) {
-			ESP_LOGE(TAG, "esp_http_client_init failed");
-			job->response.error = ESP_ERR_NO_MEM;
-		} else if (_teardownRequested.load(std::memory_order_acquire)) {
-			job->response.error = ESP_ERR_INVALID_STATE;
-			esp_http_client_cleanup(client);
-		} else {
-			auto hasHeader = [&](const char *key) {
-				for (const auto &header : job->requestOptions.headers) {
-					if (equalsIgnoreCase(header.name, key)) {
-						return true;
-					}
-				}
-				return false;
-			};
+	return esp_http_client_init(&config);
+}
 
-			if (_config.userAgent && !hasHeader("User-Agent")) {
-				esp_http_client_set_header(client, "User-Agent", _config.userAgent);
-			}
+bool ESPFetch::admitThroughCircuitBreaker(FetchJob &job) {
+	esp_fetch_detail::FetchUrlOrigin origin;
+	if (!_circuitBreaker.enabled() ||
+	    !esp_fetch_detail::parseFetchUrlOrigin(std::string(job.url.c_str(), job.url.size()), origin)) {
+		return true;
+	}
 
-			const char *contentType = job->requestOptions.contentType
-			                              ? job->requestOptions.contentType
-			                              : _config.defaultContentType;
-			if (!job->isStream && job->method == HTTP_METHOD_POST && contentType &&
-			    !hasHeader("Content-Type")) {
-				esp_http_client_set_header(client, "Content-Type", contentType);
-			}
+	char port[8];
+	snprintf(port, sizeof(port), ":%u", static_cast<unsigned>(origin.port));
+	job.circuitKey.assign(origin.https ? "https://" : "http://");
+	job.circuitKey.append(origin.host.c_str(), origin.host.size());
+	job.circuitKey.append(port);
+	if (_circuitBreaker.allow(job.circuitKey)) {
+		return true;
+	}
+	ESP_LOGD(TAG, "Circuit for %s is open; failing %s", job.circuitKey.c_str(), job.url.c_str());
+	_stats.recordCircuitRejection();
+	return false;
+}
 
-			for (const auto &header : job->requestOptions.headers) {
-				esp_http_client_set_header(client, header.name.c_str(), header.value.c_str());
-			}
+// Points the job at the cached address of its host; false when the host is known not to resolve.
+bool ESPFetch::resolveConnectAddress(FetchJob &job) {
+	job.connectUrl.clear();
+	job.hostHeader.clear();
+	job.dnsName.reset();
+	job.tlsServerName = nullptr;
+
+	esp_fetch_detail::FetchUrlOrigin origin;
+	const std::string url(job.url.c_str(), job.url.size());
+	if (!_dnsCache.enabled() || !esp_fetch_detail::parseFetchUrlOrigin(url, origin) ||
+	    esp_fetch_detail::isFetchIpv4Literal(origin.host) ||
+	    origin.host.find(':') != std::string::npos) {
+		return true;
+	}
+	// esp_http_client keeps the TLS server name across redirects, even to another host.
+	if (origin.https && job.requestOptions.allowRedirects && job.config->followRedirects) {
+		return true;
+	}
 
-			if (!job->body.empty()) {
-				esp_http_client_set_post_field(client, job->body.c_str(), job->body.length());
-			}
+	const FetchString host(origin.host.c_str(), origin.host.size(), job.stringAllocator);
+	FetchString address(job.stringAllocator);
+	FetchDnsName name;
+	FetchDnsCache::Lookup answer = _dnsCache.lookup(host, address, name);
+	if (answer == FetchDnsCache::Lookup::Miss) {
+		answer = _dnsCache.resolve(host, address, name);
+		if (answer != FetchDnsCache::Lookup::Miss) {
+			_stats.recordDnsLookup();
+		}
+	} else {
+		_stats.recordDnsHit();
+	}
 
-			if (!job->isStream) {
-				job->response.error = esp_http_client_perform(client);
-				if (job->response.error == ESP_OK) {
-					job->response.statusCode = esp_http_client_get_status_code(client);
-				}
-			} else {
-				const int configuredReadBufferSize = job->transport.rxBufferSize;
-				const size_t readBufferSize = configuredReadBufferSize > 0
-				                                  ? static_cast<size_t>(configuredReadBufferSize)
-				                                  : STREAM_READ_BUFFER_SIZE_FALLBACK_BYTES;
-				FetchVector<char> readBuffer(
-				    readBufferSize,
-				    '\0',
-				    FetchAllocator<char>(job->transport.usePSRAMBuffers)
-				);
-				bool retryRequest = false;
-				do {
-					retryRequest = false;
-					job->response.error = esp_http_client_open(client, 0);
-					if (job->response.error != ESP_OK) {
-						break;
-					}
-
-					job->response.statusCode = 0;
-					job->response.headers.clear();
-					job->response.headersTruncated = false;
-
-					const int64_t fetchHeadersResult = esp_http_client_fetch_headers(client);
-					if (fetchHeadersResult < 0) {
-						job->response.error = fetchHeadersResult == -ESP_ERR_HTTP_EAGAIN
-						                          ? ESP_ERR_HTTP_READ_TIMEOUT
-						                          : ESP_ERR_HTTP_FETCH_HEADER;
-						esp_http_client_close(client);
-						break;
-					}
-
-					job->response.statusCode = esp_http_client_get_status_code(client);
-					const StreamStartInfo startInfo{
-					    .statusCode = job->response.statusCode,
-					    .contentLength = esp_http_client_get_content_length(client),
-					    .isChunked = esp_http_client_is_chunked_response(client),
-					};
-
-					if (!job->requestOptions.allowRedirects || !_config.followRedirects) {
-						// Keep the response exactly as received.
-					} else if (isRedirectHttpStatus(startInfo.statusCode)) {
-						int discardedLength = 0;
-						(void)esp_http_client_flush_response(client, &discardedLength);
-						job->response.error = esp_http_client_set_redirection(client);
-						esp_http_client_close(client);
-						if (job->response.error == ESP_OK) {
-							retryRequest = true;
-						}
-						continue;
-					} else if (startInfo.statusCode == 401) {
-						job->response.error = esp_http_client_add_auth(client);
-						if (job->response.error != ESP_OK) {
-							esp_http_client_close(client);
-							break;
-						}
-						int discardedLength = 0;
-						job->response.error = esp_http_client_flush_response(client, &discardedLength);
-						esp_http_client_close(client);
-						if (job->response.error == ESP_OK) {
-							retryRequest = true;
-						}
-						continue;
-					}
-
-					ESP_LOGI(
-					    TAG,
-					    "Stream transport for %s: tlsVersion=%s tlsDynBufferStrategy=%s rxBuffer=%d txBuffer=%d placement=%s",
-					    job->url.c_str(),
-					    fetchTlsVersionToString(job->transport.tlsVersion),
-					    fetchTlsDynBufferStrategyToString(job->transport.tlsDynBufferStrategy),
-					    job->transport.rxBufferSize,
-					    job->transport.txBufferSize,
-					    fetchBufferPlacementToString(job->transport.usePSRAMBuffers)
-					);
-
-					if (job->onStart && !invokeFetchStartCallback(job->onStart, startInfo)) {
-						job->streamStartRejected = true;
-						job->response.error = ESP_OK;
-						esp_http_client_close(client);
-						break;
-					}
-
-					while (job->response.error == ESP_OK) {
-						const int readResult = esp_http_client_read(
-						    client,
-						    readBuffer.data(),
-						    static_cast<int>(readBuffer.size())
-						);
-						if (readResult < 0) {
-							job->response.error = mapStreamReadFailure(client, readResult);
-							break;
-						}
-						if (readResult == 0) {
-							if (!esp_http_client_is_complete_data_received(client)) {
-								job->response.error = mapStreamReadFailure(client, readResult);
-							}
-							break;
-						}
-
-						size_t toSend = static_cast<size_t>(readResult);
-						if (job->bodyLimit != std::numeric_limits<size_t>::max()) {
-							if (job->receivedBytes >= job->bodyLimit) {
-								job->streamAbortError = ESP_ERR_INVALID_SIZE;
-								job->response.error = job->streamAbortError;
-								break;
-							}
-							const size_t remaining = job->bodyLimit - job->receivedBytes;
-							toSend = std::min(toSend, remaining);
-						}
-
-						if (toSend > 0 && job->onChunk &&
-						    !invokeFetchChunkCallback(job->onChunk, readBuffer.data(), toSend)) {
-							job->streamAbortError = ESP_ERR_INVALID_STATE;
-							job->response.error = job->streamAbortError;
-							break;
-						}
-
-						job->receivedBytes += toSend;
-						if (toSend < static_cast<size_t>(readResult)) {
-							job->streamAbortError = ESP_ERR_INVALID_SIZE;
-							job->response.error = job->streamAbortError;
-							break;
-						}
-					}
-
-					esp_http_client_close(client);
-				} while (retryRequest && job->response.error == ESP_OK);
-			}
+	if (answer == FetchDnsCache::Lookup::Failed) {
+		ESP_LOGD(TAG, "%s did not resolve; failing %s", host.c_str(), job.url.c_str());
+		return false;
+	}
+	std::string connectUrl;
+	if (answer != FetchDnsCache::Lookup::Address ||
+	    !esp_fetch_detail::replaceFetchUrlHost(url, address.c_str(), connectUrl)) {
+		return true;
+	}
+	const std::string hostHeader = esp_fetch_detail::fetchHostHeaderValue(origin);
+	job.connectUrl.assign(connectUrl.c_str(), connectUrl.size());
+	job.hostHeader.assign(hostHeader.c_str(), hostHeader.size());
+	job.dnsName = std::move(name);
+	job.tlsServerName = origin.https ? job.dnsName->c_str() : nullptr;
+	return true;
+}
 
-			if (job->isStream && job->response.error != ESP_OK && job->streamAbortError != ESP_OK) {
-				job->response.error = job->streamAbortError;
+void ESPFetch::startDnsPrefetch(const FetchConfig &config) {
+	if (!_dnsCache.enabled() || config.dnsPrefetchHosts.empty()) {
+		return;
+	}
+	_activeTasks.fetch_add(1, std::memory_order_acq_rel);
+	TaskHandle_t taskHandle = nullptr;
+	const BaseType_t created = xTaskCreatePinnedToCore(
+	    &ESPFetch::dnsPrefetchTask,
+	    "esp-fetch-dns",
+	    config.stackSize,
+	    this,
+	    config.priority,
+	    &taskHandle,
+	    config.coreId
+	);
+	if (created != pdPASS) {
+		// Only an optimization: the hosts are resolved by their first request instead.
+		ESP_LOGW(TAG, "Failed to spawn DNS prefetch task");
+		_activeTasks.fetch_sub(1, std::memory_order_acq_rel);
+	}
+}
+
+void ESPFetch::dnsPrefetchTask(void *arg) {
+	auto *self = static_cast<ESPFetch *>(arg);
+	{
+		const std::shared_ptr<const FetchConfig> config = self->configSnapshot();
+		const FetchAllocator<char> allocator(config->usePSRAMBuffers);
+		FetchString host(allocator);
+		FetchString address(allocator);
+		for (const std::string &name : config->dnsPrefetchHosts) {
+			if (self->_teardownRequested.load(std::memory_order_acquire)) {
+				break;
 			}
-			if (job->isStream && job->streamStartRejected) {
-				job->response.error = ESP_OK;
+			host.clear();
+			for (char c : name) {
+				host.push_back(esp_fetch_detail::fetchAsciiToLower(c));
+			}
+			FetchDnsName cachedName;
+			if (host.empty() || esp_fetch_detail::isFetchIpv4Literal(name) ||
+			    self->_dnsCache.lookup(host, address, cachedName) != FetchDnsCache::Lookup::Miss) {
+				continue;
+			}
+			if (self->_dnsCache.resolve(host, address, cachedName) != FetchDnsCache::Lookup::Miss) {
+				self->_stats.recordDnsLookup();
 			}
-			esp_http_client_cleanup(client);
 		}
 	}
+	// Last access to self: deinit() may destroy the instance right after.
+	self->_activeTasks.fetch_sub(1, std::memory_order_acq_rel);
+	vTaskDelete(nullptr);
+}
 
-	job->response.durationUs = esp_timer_get_time() - start;
+void ESPFetch::recordCircuitResult(const FetchJob &job) {
+	const esp_err_t error = job.response.error;
+	// Local failures, teardown, cancellation and deadlines say nothing about the origin.
+	if (job.circuitKey.empty() || error == ESP_ERR_NO_MEM || error == ESP_ERR_INVALID_STATE ||
+	    job.stopError != ESP_OK) {
+		return;
+	}
+	const bool failed = error == ESP_OK ? job.response.statusCode >= 500
+	                                    : esp_fetch_detail::isFetchTransientError(error);
+	_circuitBreaker.recordResult(job.circuitKey, failed);
+}
 
-	if (job->isStream) {
-		StreamResult r;
-		r.error = job->response.error;
-		r.statusCode = job->response.statusCode;
-		r.receivedBytes = job->receivedBytes;
-		if (job->onDone) {
-			invokeFetchCallback(job->onDone, r);
+bool ESPFetch::serveFromResponseCache(FetchJob &job) {
+	if (_responseCache.loadFresh(job.url, job.response.body)) {
+		ESP_LOGD(TAG, "Serving %s from cache", job.url.c_str());
+		job.response.statusCode = 200;
+		job.response.fromCache = true;
+		return true;
+	}
+
+	FetchString etag(job.stringAllocator);
+	FetchString lastModified(job.stringAllocator);
+	if (!_responseCache.validators(job.url, etag, lastModified)) {
+		return false;
+	}
+	// Appended to the job's headers so releaseClient strips them from pooled handles.
+	if (!etag.empty()) {
+		job.requestOptions.headers.emplace_back("If-None-Match", etag.c_str(), job.stringAllocator);
+	}
+	if (!lastModified.empty()) {
+		job.requestOptions.headers
+		    .emplace_back("If-Modified-Since", lastModified.c_str(), job.stringAllocator);
+	}
+	return false;
+}
+
+void ESPFetch::updateResponseCache(FetchJob &job) {
+	if (job.response.error != ESP_OK) {
+		return;
+	}
+	const auto &cacheControl = job.cacheControl;
+	const int64_t maxAgeSec = cacheControl.noCache ? -1 : cacheControl.maxAgeSec;
+	if (job.response.statusCode == 304) {
+		if (_responseCache.revalidate(job.url, maxAgeSec, job.response.body)) {
+			job.response.statusCode = 200;
+			job.response.bodyTruncated = false;
+			job.response.fromCache = true;
 		}
-	} else {
-		JsonDocument result = buildResult(*job, job->response);
-		deliverResult(job, result);
+		return;
 	}
+	if (job.response.statusCode != 200) {
+		return;
+	}
+	if (cacheControl.noStore || job.response.bodyTruncated ||
+	    (job.cacheEtag.empty() && job.cacheLastModified.empty() && maxAgeSec <= 0)) {
+		// A newer representation that cannot be cached replaces any stored one.
+		_responseCache.erase(job.url);
+		return;
+	}
+	_responseCache.store(
+	    job.url,
+	    job.cacheEtag,
+	    job.cacheLastModified,
+	    maxAgeSec,
+	    job.response.body
+	);
+}
 
-	if (_slotSemaphore) {
-		xSemaphoreGive(_slotSemaphore);
+void ESPFetch::releaseClient(FetchJob &job, esp_http_client_handle_t client, bool keepOpen) {
+	if (!client) {
+		return;
+	}
+	// A status code means the TLS handshake completed, so the handle carries a usable session.
+	const bool keepSession = job.tlsSessionCapable && job.response.statusCode > 0;
+	// Without the pool, a batch request hands its handle to the next request of its group.
+	const bool carry = job.connectionKey.empty() && job.batchConnection != nullptr &&
+	                   job.response.statusCode > 0;
+	if (!carry && (job.connectionKey.empty() || (!keepOpen && !keepSession))) {
+		esp_http_client_cleanup(client);
+		return;
 	}
 
-	_activeTasks.fetch_sub(1, std::memory_order_acq_rel);
+	// Request state lives on the handle; strip what this job added before parking it.
+	job.requestOptions.forEachHeader([client](const InternalFetchHeader &header) {
+		esp_http_client_delete_header(client, header.name.c_str());
+	});
+	esp_http_client_delete_header(client, "Content-Type");
+	esp_http_client_set_post_field(client, nullptr, 0);
+	esp_http_client_set_user_data(client, nullptr);
+	if (carry) {
+		job.batchConnection->client = client;
+		job.batchConnection->serverName = std::move(job.clientServerName);
+		job.batchConnection->connected = keepOpen;
+		return;
+	}
+	_connectionPool.release(
+	    job.connectionKey, client, keepOpen, keepSession, std::move(job.clientServerName)
+	);
 }
 
-JsonDocument ESPFetch::buildResult(const FetchJob &job, const FetchResponse &response) const {
-	JsonDocument doc;
-	auto root = doc.to<JsonObject>();
+JsonDocument ESPFetch::buildResult(const FetchJob &job, FetchResponse &response) const {
+	JsonDocument doc = std::move(response.document);
+	auto root = doc.is<JsonObject>() ? doc.as<JsonObject>() : doc.to<JsonObject>();
 	root["url"] = job.url.c_str();
-	root["method"] = job.method == HTTP_METHOD_POST ? "POST" : "GET";
+	root["method"] = esp_fetch_detail::fetchHttpMethodName(job.method);
 	const bool httpOk = response.statusCode >= 200 && response.statusCode < 400;
 	root["status"] = response.statusCode;
 	root["ok"] = response.error == ESP_OK && httpOk;
 	root["duration_ms"] = static_cast<int>(response.durationUs / 1000);
-	root["body"] = response.body.c_str();
+	auto timingObj = root["timing_us"].to<JsonObject>();
+	timingObj["queued"] = response.timing.queuedUs;
+	timingObj["connected"] = response.timing.connectedUs;
+	timingObj["headers_sent"] = response.timing.headersSentUs;
+	timingObj["first_header"] = response.timing.firstHeaderUs;
+	timingObj["first_data"] = response.timing.firstDataUs;
+	timingObj["finished"] = response.timing.finishedUs;
+	root["cached"] = response.fromCache;
+	if (job.parseBody) {
+		if (response.parseError) {
+			root["json_error"] = response.parseError.c_str();
+		} else {
+			root["json_error"] = nullptr;
+		}
+	} else {
+		root["body"] = response.body.c_str();
+	}
 	root["body_truncated"] = response.bodyTruncated;
 	root["headers_truncated"] = response.headersTruncated;
 
@@ -1234,18 +4970,48 @@ JsonDocument ESPFetch::buildResult(const FetchJob &job, const FetchResponse &res
 	return doc;
 }
 
-void ESPFetch::deliverResult(const std::unique_ptr<FetchJob> &job, const JsonDocument &result) {
+void ESPFetch::deliverRawResult(const std::unique_ptr<FetchJob> &job) {
 	if (!job) {
 		return;
 	}
-	if (job->callback) {
-		invokeFetchCallback(job->callback, result);
+	// Raw jobs have exactly one consumer, so the response can always be handed over.
+	FetchRawResponse &response = job->response;
+	if (job->rawCallback) {
+		invokeFetchCallback(job->rawCallback, std::move(response));
+		return;
 	}
 	if (job->syncHandle) {
-		job->syncHandle->doc = result;
-		job->syncHandle->ready = true;
+		job->syncHandle->raw = std::move(response);
+		job->syncHandle->ready.store(true, std::memory_order_release);
 		if (job->syncHandle->done) {
 			xSemaphoreGive(job->syncHandle->done);
 		}
 	}
 }
+
+void ESPFetch::deliverResult(const std::unique_ptr<FetchJob> &job, JsonDocument &&result) {
+	if (!job) {
+		return;
+	}
+	deliverDocument(job->callback, job->syncHandle, std::move(result));
+}
+
+void ESPFetch::deliverDocument(
+    FetchCallback &callback, const std::shared_ptr<SyncHandle> &handle, JsonDocument &&result
+) {
+	if (callback) {
+		if (handle) {
+			// Only copy when two consumers share the document.
+			invokeFetchCallback(callback, JsonDocument(result));
+		} else {
+			invokeFetchCallback(callback, std::move(result));
+		}
+	}
+	if (handle) {
+		handle->doc = std::move(result);
+		handle->ready.store(true, std::memory_order_release);
+		if (handle->done) {
+			xSemaphoreGive(handle->done);
+		}
+	}
+}
@@ -6,6 +6,8 @@
 #include <atomic>
 #include <climits>
 #include <cstdint>
+#include <cstdio>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -14,6 +16,13 @@
 #include <vector>
 
 #include "fetch_allocator.h"
+#include "fetch_arena_pool.h"
+#include "fetch_circuit_breaker.h"
+#include "fetch_connection_pool.h"
+#include "fetch_dns_cache.h"
+#include "fetch_response_cache.h"
+#include "fetch_stats.h"
+#include "fetch_trace.h"
 
 extern "C" {
 #include "esp_http_client.h"
@@ -39,6 +48,65 @@ enum class FetchTlsDynBufferStrategy {
 	RxStaticAfterHandshake,
 };
 
+// Admission order for requests waiting on a slot (see FetchConfig::pendingQueueSize).
+enum class FetchPriority {
+	Low,
+	Normal,
+	High,
+};
+
+// Task settings for requests that pick a lane (FetchConfig::lanes, FetchRequestOptions::lane),
+// e.g. small stacks for plain-HTTP JSON on one core and larger TLS stacks on the other.
+struct FetchLane {
+	size_t stackSize = 4096 * sizeof(StackType_t);
+	UBaseType_t priority = 4;
+	BaseType_t coreId = tskNO_AFFINITY;
+	// Long-lived workers serving the lane when FetchConfig::useWorkerPool is set.
+	size_t workers = 1;
+};
+
+// HTTP methods accepted by ESPFetch::request() / requestRaw() / prepare().
+enum class FetchMethod {
+	Get,
+	Post,
+	Put,
+	Patch,
+	Delete,
+	Head,
+};
+
+// Wire format of JsonDocument request payloads (see FetchRequestOptions::bodyFormat).
+enum class FetchBodyFormat {
+	Json,
+	MsgPack,
+};
+
+// Content-Encoding applied to request bodies (see FetchRequestOptions::compressBody).
+enum class FetchBodyEncoding {
+	Identity,
+	Gzip,
+	Deflate,
+};
+
+// In-place retries of a failed buffered, parsed or post() request (see FetchRequestOptions::retry).
+// The job keeps its slot and esp_http_client handle and waits between attempts: attempt n waits
+// between half and all of min(backoffBaseMs << (n - 1), backoffMaxMs), or longer when a 429/503
+// response sends a Retry-After in seconds (still capped by backoffMaxMs).
+struct FetchRetryPolicy {
+	uint8_t maxAttempts = 1; // total attempts including the first; 1 disables retries
+	uint32_t backoffBaseMs = 250;
+	uint32_t backoffMaxMs = 8000;
+	// Transport errors to retry; empty retries connect failures, timeouts and dropped
+	// connections (esp_fetch_detail::isFetchTransientError).
+	std::vector<esp_err_t> retryOnErrors;
+	// Response statuses to retry; empty uses 408, 429, 502, 503 and 504 when retryOnStatus is set.
+	std::vector<int> retryStatusCodes;
+	bool retryOnStatus = true;
+	// POST is only retried after a failed connect unless this is set, since the server may already
+	// have acted on a request whose response was lost.
+	bool retryNonIdempotent = false;
+};
+
 struct FetchRequestOptions {
 	uint32_t timeoutMs = 0;
 	size_t maxBodyBytes = 0;
@@ -56,19 +124,88 @@ struct FetchRequestOptions {
 	bool allowRedirects = true;
 	std::vector<FetchHeader> headers;
 	const char *contentType = nullptr;
+	// Deserialize the response body into result["json"] while it is received instead of
+	// returning it as result["body"]. A non-null jsonFilter is applied as an ArduinoJson filter.
+	bool parseJsonBody = false;
+	JsonDocument jsonFilter;
+	// getJsonStream: largest element, as raw JSON text, held while it is parsed
+	// (0 = FetchConfig::maxBodyBytes). jsonFilter is applied to every element.
+	size_t maxJsonElementBytes = 0;
+	// MsgPack serializes post() / postRaw() payloads with serializeMsgPack, sends them as
+	// application/msgpack (unless contentType is set) and asks for msgpack with an Accept header.
+	// parseJsonBody reads application/msgpack responses with deserializeMsgPack in either format.
+	FetchBodyFormat bodyFormat = FetchBodyFormat::Json;
+	// Response headers to keep (case-insensitive). Empty keeps every header; headers outside a
+	// non-empty list are neither stored nor counted against maxHeaderBytes.
+	std::vector<std::string> captureHeaders;
+	FetchPriority priority = FetchPriority::Normal;
+	// Task settings: 0 uses FetchConfig::stackSize / priority / coreId, n uses
+	// FetchConfig::lanes[n - 1]. Requests naming a lane that is not configured are rejected.
+	uint8_t lane = 0;
+	// Stream mode: with streamBufferCount >= 2 the response is read into a ring of buffers and
+	// onChunk runs on a separate consumer task, so reads continue while a chunk is processed.
+	// streamBufferSize 0 uses the read buffer size (rxBufferSize or 1024). streamBuffers may point
+	// at caller memory of streamBufferCount * streamBufferSize bytes; otherwise ESPFetch allocates
+	// the ring per request using the resolved buffer placement.
+	size_t streamBufferCount = 1;
+	size_t streamBufferSize = 0;
+	uint8_t *streamBuffers = nullptr;
+	// Byte range to request (sent as a Range header when rangeStart > 0 or rangeLength > 0).
+	// rangeLength <= 0 requests everything from rangeStart to the end of the resource.
+	uint64_t rangeStart = 0;
+	int64_t rangeLength = -1;
+	// Stream mode: reconnect with a Range header after a dropped connection, resuming from the
+	// bytes already delivered. download() uses 3 attempts when this is 0.
+	uint8_t resumeAttempts = 0;
+	uint32_t resumeDelayMs = 500;
+	// Skip the response cache (FetchConfig::responseCacheEntries) for this request.
+	bool bypassCache = false;
+	// Let this GET share an identical in-flight request (FetchConfig::coalesceRequests).
+	bool allowCoalescing = true;
+	// Send Accept-Encoding: gzip, deflate and decode compressed responses with the ROM inflater
+	// (body limits and onChunk see decoded bytes). Needs 32 KiB of window per decoding request.
+	bool acceptCompressed = false;
+	// Compress post() bodies and postStream uploads on the fly and send them chunked with a
+	// matching Content-Encoding header (about 16 KiB of encoder state per request). Ignored when
+	// the caller already set Content-Encoding; the server must accept compressed bodies.
+	FetchBodyEncoding compressBody = FetchBodyEncoding::Identity;
+	// Retry transient failures inside the worker. Streams use resumeAttempts instead, and
+	// postStream bodies are produced once, so neither is retried.
+	FetchRetryPolicy retry;
+	// Budget for the whole request from the call that started it: pending-queue and slot wait,
+	// connect, retries and transfer (0 = none). Socket timeouts are shortened to what is left, and
+	// a request past its deadline completes with ESP_ERR_TIMEOUT. Such requests never coalesce.
+	uint32_t deadlineMs = 0;
 };
 
 struct FetchConfig {
 	size_t maxConcurrentRequests = 4;
+	// Task settings of lane 0, which every request uses unless it picks one of `lanes`.
 	size_t stackSize = 6144 * sizeof(StackType_t);
 	UBaseType_t priority = 4;
 	BaseType_t coreId = tskNO_AFFINITY;
+	// Extra task lanes (at most FetchStats::kLaneSlots - 1). Requests running on a lane still
+	// take one of the maxConcurrentRequests slots; in worker-pool mode each lane has its own
+	// workers and queue, and lane 0 has maxConcurrentRequests workers.
+	std::vector<FetchLane> lanes;
 	uint32_t defaultTimeoutMs = 15000;
 	size_t maxBodyBytes = 16384;
 	size_t maxHeaderBytes = 4096;
 	size_t rxBufferSize = 0;
 	size_t txBufferSize = 0;
 	TickType_t slotAcquireTicks = pdMS_TO_TICKS(0);
+	// Requests parked by priority while every slot is busy (0 keeps the reject/block behaviour
+	// of slotAcquireTicks). Parked requests start as slots free up, High before Normal before Low.
+	size_t pendingQueueSize = 0;
+	// Slots only FetchPriority::High requests may take; must be below maxConcurrentRequests.
+	size_t reservedHighPrioritySlots = 0;
+	// Memory governor (0 disables each check). A request only takes a free slot while the
+	// estimated internal RAM of the running requests plus its own stays within memoryBudgetBytes
+	// and the free internal heap covers its estimate plus minFreeHeapBytes. Otherwise it waits
+	// like a request beyond maxConcurrentRequests: parked in the pending queue, or blocking for
+	// slotAcquireTicks. A request that would run alone always starts.
+	size_t memoryBudgetBytes = 0;
+	size_t minFreeHeapBytes = 0;
 	const char *caCertPem = nullptr;
 	FetchTlsVersion tlsVersion = FetchTlsVersion::Any;
 	FetchTlsDynBufferStrategy tlsDynBufferStrategy = FetchTlsDynBufferStrategy::Default;
@@ -78,6 +215,42 @@ struct FetchConfig {
 	bool skipTlsCommonNameCheck = false;
 	bool followRedirects = true;
 	bool usePSRAMBuffers = false;
+	// Run jobs on maxConcurrentRequests long-lived workers instead of one task per request.
+	bool useWorkerPool = false;
+	// Idle keep-alive connections kept per ESPFetch instance (0 disables connection reuse).
+	size_t maxIdleConnections = 0;
+	uint32_t idleConnectionTimeoutMs = 30000;
+	// Closed TLS handles kept for session-ticket resumption (0 disables the session cache).
+	size_t tlsSessionCacheEntries = 0;
+	// GET response bodies cached for conditional requests (0 disables the cache), bounded by
+	// both entry count and responseCacheBytes of URL, validator and body bytes.
+	size_t responseCacheEntries = 0;
+	size_t responseCacheBytes = 16384;
+	// JSON-mode GETs identical to one already queued or running (URL, headers, limits, transport)
+	// attach to it and receive a copy of its result instead of sending their own request.
+	bool coalesceRequests = false;
+	// Bytes reserved per request slot for one job's read buffers and, in JSON mode, its response
+	// headers and body (0 disables the arenas). Reset in one step when the job finishes; anything
+	// that does not fit uses the heap. Size it from stats().peakArenaBytes.
+	size_t jobArenaBytes = 0;
+	// Per-origin circuit breaker (0 disables it): after this many consecutive failed requests
+	// (transport errors or 5xx) to one scheme/host/port, requests fail fast with
+	// ESP_ERR_NOT_ALLOWED for circuitBreakerOpenMs. Then a single probe request decides whether
+	// the circuit closes again. Up to circuitBreakerHosts origins are tracked.
+	uint8_t circuitBreakerThreshold = 0;
+	uint32_t circuitBreakerOpenMs = 30000;
+	size_t circuitBreakerHosts = 8;
+	// Host to IPv4 address cache (0 disables it). Requests connect to the cached address and keep
+	// the host name for the Host header and TLS server name. A miss blocks the request's task on
+	// getaddrinfo() and stores the answer for dnsCacheTtlMs, or a failure for dnsNegativeTtlMs
+	// (requests to the host then fail fast with ESP_ERR_HTTP_CONNECT); in a full table it replaces
+	// an expired entry, else the least recently used one. HTTPS requests that follow redirects and
+	// IP literals use the live resolver.
+	size_t dnsCacheEntries = 0;
+	uint32_t dnsCacheTtlMs = 300000;
+	uint32_t dnsNegativeTtlMs = 10000;
+	// Resolved into the DNS cache by a background task started by init().
+	std::vector<std::string> dnsPrefetchHosts;
 	const char *userAgent = "ESPFetch/1.0";
 	const char *defaultContentType = "application/json";
 };
@@ -138,6 +311,14 @@ inline bool fetchHasTlsDynamicBufferSupport() {
 #endif
 }
 
+inline bool fetchHasTlsSessionTicketSupport() {
+#if defined(CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS)
+	return true;
+#else
+	return false;
+#endif
+}
+
 inline int resolveFetchHttpBufferSize(size_t requestValue, size_t configValue) {
 	const size_t selected = requestValue ? requestValue : configValue;
 	if (selected == 0) {
@@ -214,6 +395,561 @@ inline bool fetchUrlUsesHttps(const std::string &url) {
 	       (url[4] == 's' || url[4] == 'S') && url[5] == ':' && url[6] == '/' && url[7] == '/';
 }
 
+struct FetchUrlOrigin {
+	bool https = false;
+	std::string host;
+	uint16_t port = 0;
+};
+
+inline char fetchAsciiToLower(char value) {
+	return (value >= 'A' && value <= 'Z') ? static_cast<char>(value - 'A' + 'a') : value;
+}
+
+// Case-insensitive 32-bit FNV-1a hash used to match response header names against
+// FetchRequestOptions::captureHeaders without string compares.
+inline uint32_t fetchHeaderNameHash(const char *name) {
+	uint32_t hash = 2166136261u;
+	if (!name) {
+		return hash;
+	}
+	for (; *name != '\0'; ++name) {
+		hash ^= static_cast<uint8_t>(fetchAsciiToLower(*name));
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+struct FetchContentRange {
+	int64_t start = -1;
+	int64_t end = -1;
+	int64_t total = -1; // -1 when the server sent "*"
+};
+
+inline bool parseFetchDecimal(const char *&cursor, int64_t &value) {
+	if (*cursor < '0' || *cursor > '9') {
+		return false;
+	}
+	value = 0;
+	while (*cursor >= '0' && *cursor <= '9') {
+		if (value > (INT64_MAX - (*cursor - '0')) / 10) {
+			return false;
+		}
+		value = value * 10 + (*cursor - '0');
+		++cursor;
+	}
+	return true;
+}
+
+// Parses a Content-Range response header value: "bytes 0-499/1234", "bytes 0-499/*" or
+// "bytes */1234" (start/end stay -1 for the unsatisfied-range form).
+inline bool parseFetchContentRange(const char *value, FetchContentRange &out) {
+	out = FetchContentRange{};
+	if (!value) {
+		return false;
+	}
+	const char *cursor = value;
+	while (*cursor == ' ') {
+		++cursor;
+	}
+	static constexpr char kUnit[] = "bytes";
+	for (size_t i = 0; kUnit[i] != '\0'; ++i, ++cursor) {
+		if (fetchAsciiToLower(*cursor) != kUnit[i]) {
+			return false;
+		}
+	}
+	if (*cursor != ' ') {
+		return false;
+	}
+	while (*cursor == ' ') {
+		++cursor;
+	}
+
+	if (*cursor == '*') {
+		++cursor;
+	} else {
+		if (!parseFetchDecimal(cursor, out.start) || *cursor++ != '-' ||
+		    !parseFetchDecimal(cursor, out.end) || out.end < out.start) {
+			out = FetchContentRange{};
+			return false;
+		}
+	}
+	if (*cursor++ != '/') {
+		out = FetchContentRange{};
+		return false;
+	}
+	if (*cursor == '*') {
+		++cursor;
+		if (out.start < 0) {
+			return false; // "*/*" carries no information
+		}
+	} else if (!parseFetchDecimal(cursor, out.total) || (out.start >= 0 && out.end >= out.total)) {
+		out = FetchContentRange{};
+		return false;
+	}
+	return *cursor == '\0';
+}
+
+// Formats the Range request header value for [start, start + length). Returns false when no
+// range is requested (start 0 and length <= 0) or the buffer is too small.
+inline bool
+formatFetchRangeHeader(uint64_t start, int64_t length, char *out, size_t outSize) {
+	if (!out || outSize == 0 || (start == 0 && length <= 0)) {
+		return false;
+	}
+	int written = 0;
+	if (length > 0) {
+		written = std::snprintf(
+		    out,
+		    outSize,
+		    "bytes=%llu-%llu",
+		    static_cast<unsigned long long>(start),
+		    static_cast<unsigned long long>(start + static_cast<uint64_t>(length) - 1)
+		);
+	} else {
+		written = std::snprintf(out, outSize, "bytes=%llu-", static_cast<unsigned long long>(start));
+	}
+	return written > 0 && static_cast<size_t>(written) < outSize;
+}
+
+// Transport failures after which a resumable stream reconnects with a Range header.
+inline bool isFetchResumableStreamError(esp_err_t error) {
+	return error == ESP_ERR_HTTP_CONNECTION_CLOSED || error == ESP_ERR_HTTP_INCOMPLETE_DATA ||
+	       error == ESP_ERR_HTTP_READ_TIMEOUT || error == ESP_ERR_HTTP_CONNECT ||
+	       error == ESP_ERR_HTTP_FETCH_HEADER;
+}
+
+// Failures that say nothing about the request itself and are worth another attempt.
+inline bool isFetchTransientError(esp_err_t error) {
+	return isFetchResumableStreamError(error) || error == ESP_ERR_HTTP_EAGAIN ||
+	       error == ESP_ERR_HTTP_WRITE_DATA || error == ESP_ERR_TIMEOUT;
+}
+
+inline bool isFetchRetryableError(const FetchRetryPolicy &policy, esp_err_t error) {
+	if (error == ESP_OK) {
+		return false;
+	}
+	if (policy.retryOnErrors.empty()) {
+		return isFetchTransientError(error);
+	}
+	for (esp_err_t candidate : policy.retryOnErrors) {
+		if (candidate == error) {
+			return true;
+		}
+	}
+	return false;
+}
+
+inline bool isFetchRetryableStatus(const FetchRetryPolicy &policy, int statusCode) {
+	if (!policy.retryOnStatus || statusCode <= 0) {
+		return false;
+	}
+	if (policy.retryStatusCodes.empty()) {
+		return statusCode == 408 || statusCode == 429 || statusCode == 502 || statusCode == 503 ||
+		       statusCode == 504;
+	}
+	for (int candidate : policy.retryStatusCodes) {
+		if (candidate == statusCode) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Absolute esp_timer time `deadlineMs` after `nowUs`, or 0 when there is no deadline.
+inline int64_t fetchDeadlineUs(int64_t nowUs, uint32_t deadlineMs) {
+	return deadlineMs == 0 ? 0 : nowUs + static_cast<int64_t>(deadlineMs) * 1000;
+}
+
+// Socket timeout for the next connect or read: timeoutMs, shortened to what is left before
+// deadlineUs (0 = none). Never 0, so an expired deadline still yields a 1 ms timeout.
+inline uint32_t fetchTimeoutWithinDeadline(uint32_t timeoutMs, int64_t deadlineUs, int64_t nowUs) {
+	if (deadlineUs == 0) {
+		return timeoutMs;
+	}
+	const int64_t remainingMs = (deadlineUs - nowUs) / 1000;
+	if (remainingMs <= 0) {
+		return 1;
+	}
+	return remainingMs < static_cast<int64_t>(timeoutMs) ? static_cast<uint32_t>(remainingMs)
+	                                                     : timeoutMs;
+}
+
+// Delay before attempt `attempt + 1` (attempt counts from 1). Equal jitter: half of the capped
+// exponential step is fixed, the other half is taken from `random`, so retries of many devices
+// spread out while the delay still grows. retryAfterMs (from a Retry-After header, 0 when absent)
+// raises the delay, but never past backoffMaxMs.
+inline uint32_t fetchRetryDelayMs(
+    const FetchRetryPolicy &policy, uint8_t attempt, uint32_t random, uint32_t retryAfterMs = 0
+) {
+	uint64_t step = policy.backoffBaseMs;
+	for (uint8_t i = 1; i < attempt && step < policy.backoffMaxMs; ++i) {
+		step <<= 1;
+	}
+	if (step > policy.backoffMaxMs) {
+		step = policy.backoffMaxMs;
+	}
+	const uint32_t half = static_cast<uint32_t>(step / 2);
+	uint32_t delay = static_cast<uint32_t>(step) - half + (half ? random % (half + 1) : 0);
+	if (retryAfterMs > delay) {
+		delay = retryAfterMs < policy.backoffMaxMs ? retryAfterMs : policy.backoffMaxMs;
+	}
+	return delay;
+}
+
+// Retry-After in delta-seconds, as milliseconds; 0 for HTTP dates or malformed values.
+inline uint32_t parseFetchRetryAfterMs(const char *value) {
+	if (!value) {
+		return 0;
+	}
+	while (*value == ' ') {
+		++value;
+	}
+	uint32_t seconds = 0;
+	const char *cursor = value;
+	while (*cursor >= '0' && *cursor <= '9') {
+		if (seconds > UINT32_MAX / 10000) {
+			return UINT32_MAX;
+		}
+		seconds = seconds * 10 + static_cast<uint32_t>(*cursor - '0');
+		++cursor;
+	}
+	if (cursor == value || (*cursor != '\0' && *cursor != ' ')) {
+		return 0;
+	}
+	return seconds > UINT32_MAX / 1000 ? UINT32_MAX : seconds * 1000;
+}
+
+struct FetchCacheControl {
+	int64_t maxAgeSec = -1; // -1 when no max-age directive was sent
+	bool noStore = false;
+	bool noCache = false;
+};
+
+// Parses the directives of a Cache-Control response header that matter to a private client
+// cache. Unknown directives are ignored.
+inline void parseFetchCacheControl(const char *value, FetchCacheControl &out) {
+	out = FetchCacheControl{};
+	if (!value) {
+		return;
+	}
+	auto matches = [](const char *cursor, const char *name, size_t length) {
+		for (size_t i = 0; i < length; ++i) {
+			if (fetchAsciiToLower(cursor[i]) != name[i]) {
+				return false;
+			}
+		}
+		const char next = cursor[length];
+		return next == '\0' || next == ',' || next == ' ' || next == '=' || next == ';';
+	};
+
+	const char *cursor = value;
+	while (*cursor != '\0') {
+		while (*cursor == ' ' || *cursor == ',') {
+			++cursor;
+		}
+		if (matches(cursor, "max-age", 7) && cursor[7] == '=') {
+			const char *digits = cursor + 8;
+			if (*digits == '"') {
+				++digits;
+			}
+			int64_t seconds = 0;
+			if (parseFetchDecimal(digits, seconds)) {
+				out.maxAgeSec = seconds;
+			}
+		} else if (matches(cursor, "no-store", 8)) {
+			out.noStore = true;
+		} else if (matches(cursor, "no-cache", 8)) {
+			out.noCache = true;
+		}
+		while (*cursor != '\0' && *cursor != ',') {
+			++cursor;
+		}
+	}
+}
+
+inline esp_http_client_method_t toFetchHttpMethod(FetchMethod method) {
+	switch (method) {
+	case FetchMethod::Post:
+		return HTTP_METHOD_POST;
+	case FetchMethod::Put:
+		return HTTP_METHOD_PUT;
+	case FetchMethod::Patch:
+		return HTTP_METHOD_PATCH;
+	case FetchMethod::Delete:
+		return HTTP_METHOD_DELETE;
+	case FetchMethod::Head:
+		return HTTP_METHOD_HEAD;
+	case FetchMethod::Get:
+	default:
+		return HTTP_METHOD_GET;
+	}
+}
+
+inline const char *fetchHttpMethodName(esp_http_client_method_t method) {
+	switch (method) {
+	case HTTP_METHOD_POST:
+		return "POST";
+	case HTTP_METHOD_PUT:
+		return "PUT";
+	case HTTP_METHOD_PATCH:
+		return "PATCH";
+	case HTTP_METHOD_DELETE:
+		return "DELETE";
+	case HTTP_METHOD_HEAD:
+		return "HEAD";
+	default:
+		return "GET";
+	}
+}
+
+// Methods whose requests normally carry a body and get the default Content-Type.
+inline bool fetchHttpMethodHasBody(esp_http_client_method_t method) {
+	return method == HTTP_METHOD_POST || method == HTTP_METHOD_PUT || method == HTTP_METHOD_PATCH;
+}
+
+// True for the MessagePack media types (application/msgpack, x-msgpack, vnd.msgpack), ignoring
+// case and parameters.
+inline bool isFetchMsgPackContentType(const char *value) {
+	if (!value) {
+		return false;
+	}
+	while (*value == ' ') {
+		++value;
+	}
+	static constexpr const char *kTypes[] = {
+	    "application/msgpack", "application/x-msgpack", "application/vnd.msgpack"
+	};
+	for (const char *type : kTypes) {
+		size_t i = 0;
+		while (type[i] != '\0' && fetchAsciiToLower(value[i]) == type[i]) {
+			++i;
+		}
+		if (type[i] == '\0' && (value[i] == '\0' || value[i] == ';' || value[i] == ' ')) {
+			return true;
+		}
+	}
+	return false;
+}
+
+inline bool fetchSlotAvailable(
+    size_t runningJobs, size_t maxConcurrent, size_t reservedHighSlots, FetchPriority priority
+) {
+	if (runningJobs >= maxConcurrent) {
+		return false;
+	}
+	if (priority == FetchPriority::High) {
+		return true;
+	}
+	return maxConcurrent - runningJobs > reservedHighSlots;
+}
+
+// Memory governor: whether a job estimated at jobBytes may start while the running jobs hold
+// reservedBytes. With nothing running it always may, so a job above the budget runs on its own
+// instead of waiting forever.
+inline bool fetchMemoryAvailable(
+    size_t runningJobs,
+    size_t reservedBytes,
+    size_t jobBytes,
+    size_t budgetBytes,
+    size_t freeHeapBytes,
+    size_t minFreeHeapBytes
+) {
+	if (runningJobs == 0) {
+		return true;
+	}
+	if (budgetBytes > 0 && (jobBytes > budgetBytes || reservedBytes > budgetBytes - jobBytes)) {
+		return false;
+	}
+	return minFreeHeapBytes == 0 ||
+	       (freeHeapBytes >= minFreeHeapBytes && freeHeapBytes - minFreeHeapBytes >= jobBytes);
+}
+
+// Whether two lane lists have the same task settings and worker counts, lane by lane.
+inline bool
+fetchLanesEqual(const std::vector<FetchLane> &lhs, const std::vector<FetchLane> &rhs) {
+	if (lhs.size() != rhs.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < lhs.size(); ++i) {
+		if (lhs[i].stackSize != rhs[i].stackSize || lhs[i].priority != rhs[i].priority ||
+		    lhs[i].coreId != rhs[i].coreId || lhs[i].workers != rhs[i].workers) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Task settings of a lane; lane 0 is built from the FetchConfig task fields. The caller checks
+// that the lane exists.
+inline FetchLane fetchLaneSettings(const FetchConfig &config, uint8_t lane) {
+	if (lane > 0 && lane <= config.lanes.size()) {
+		return config.lanes[lane - 1];
+	}
+	FetchLane settings;
+	settings.stackSize = config.stackSize;
+	settings.priority = config.priority;
+	settings.coreId = config.coreId;
+	settings.workers = config.maxConcurrentRequests;
+	return settings;
+}
+
+// Settings sized or started by init() that updateConfig() cannot change in place.
+inline bool fetchConfigNeedsInit(const FetchConfig &current, const FetchConfig &next) {
+	return current.useWorkerPool != next.useWorkerPool ||
+	       current.maxIdleConnections != next.maxIdleConnections ||
+	       current.idleConnectionTimeoutMs != next.idleConnectionTimeoutMs ||
+	       current.tlsSessionCacheEntries != next.tlsSessionCacheEntries ||
+	       current.responseCacheEntries != next.responseCacheEntries ||
+	       current.responseCacheBytes != next.responseCacheBytes ||
+	       current.jobArenaBytes != next.jobArenaBytes ||
+	       current.circuitBreakerThreshold != next.circuitBreakerThreshold ||
+	       current.circuitBreakerOpenMs != next.circuitBreakerOpenMs ||
+	       current.circuitBreakerHosts != next.circuitBreakerHosts ||
+	       current.dnsCacheEntries != next.dnsCacheEntries ||
+	       current.dnsCacheTtlMs != next.dnsCacheTtlMs ||
+	       current.dnsNegativeTtlMs != next.dnsNegativeTtlMs ||
+	       current.usePSRAMBuffers != next.usePSRAMBuffers ||
+	       !fetchLanesEqual(current.lanes, next.lanes);
+}
+
+inline bool fetchUrlHasScheme(const std::string &url, const char *scheme) {
+	size_t i = 0;
+	for (; scheme[i] != '\0'; ++i) {
+		if (i >= url.size() || fetchAsciiToLower(url[i]) != scheme[i]) {
+			return false;
+		}
+	}
+	return url.compare(i, 3, "://") == 0;
+}
+
+// Extracts scheme, lower-cased host and effective port from an absolute http(s) URL.
+inline bool parseFetchUrlOrigin(const std::string &url, FetchUrlOrigin &origin) {
+	size_t hostStart = 0;
+	if (fetchUrlHasScheme(url, "https")) {
+		origin.https = true;
+		hostStart = 8;
+	} else if (fetchUrlHasScheme(url, "http")) {
+		origin.https = false;
+		hostStart = 7;
+	} else {
+		return false;
+	}
+
+	size_t authorityEnd = url.find_first_of("/?#", hostStart);
+	if (authorityEnd == std::string::npos) {
+		authorityEnd = url.size();
+	}
+	const size_t userInfoEnd = url.rfind('@', authorityEnd);
+	if (userInfoEnd != std::string::npos && userInfoEnd >= hostStart) {
+		hostStart = userInfoEnd + 1;
+	}
+
+	size_t hostEnd = authorityEnd;
+	size_t portStart = std::string::npos;
+	if (hostStart < authorityEnd && url[hostStart] == '[') {
+		const size_t closing = url.find(']', hostStart);
+		if (closing == std::string::npos || closing >= authorityEnd) {
+			return false;
+		}
+		origin.host.assign(url, hostStart + 1, closing - hostStart - 1);
+		if (closing + 1 < authorityEnd && url[closing + 1] == ':') {
+			portStart = closing + 2;
+		}
+	} else {
+		const size_t colon = url.find(':', hostStart);
+		if (colon != std::string::npos && colon < authorityEnd) {
+			hostEnd = colon;
+			portStart = colon + 1;
+		}
+		origin.host.assign(url, hostStart, hostEnd - hostStart);
+	}
+	if (origin.host.empty()) {
+		return false;
+	}
+	for (auto &c : origin.host) {
+		c = fetchAsciiToLower(c);
+	}
+
+	origin.port = origin.https ? 443 : 80;
+	if (portStart != std::string::npos && portStart < authorityEnd) {
+		uint32_t port = 0;
+		for (size_t i = portStart; i < authorityEnd; ++i) {
+			if (url[i] < '0' || url[i] > '9') {
+				return false;
+			}
+			port = port * 10 + static_cast<uint32_t>(url[i] - '0');
+			if (port > 65535) {
+				return false;
+			}
+		}
+		if (port == 0) {
+			return false;
+		}
+		origin.port = static_cast<uint16_t>(port);
+	}
+	return true;
+}
+
+inline bool isFetchIpv4Literal(const std::string &host) {
+	size_t dots = 0;
+	size_t digits = 0;
+	for (char c : host) {
+		if (c == '.') {
+			if (digits == 0) {
+				return false;
+			}
+			++dots;
+			digits = 0;
+		} else if (c >= '0' && c <= '9' && digits < 3) {
+			++digits;
+		} else {
+			return false;
+		}
+	}
+	return dots == 3 && digits > 0;
+}
+
+// Host header value for a request sent to a resolved address: the host, plus the port when it
+// is not the scheme default.
+inline std::string fetchHostHeaderValue(const FetchUrlOrigin &origin) {
+	std::string value = origin.host;
+	if (origin.port != (origin.https ? 443 : 80)) {
+		value += ':';
+		value += std::to_string(origin.port);
+	}
+	return value;
+}
+
+// Copies an absolute http(s) URL with its host replaced by address; user info, port, path and
+// query are kept. False for IPv6 literals and URLs without a host.
+inline bool
+replaceFetchUrlHost(const std::string &url, const std::string &address, std::string &out) {
+	const size_t schemeEnd = url.find("://");
+	if (schemeEnd == std::string::npos) {
+		return false;
+	}
+	size_t hostStart = schemeEnd + 3;
+	size_t authorityEnd = url.find_first_of("/?#", hostStart);
+	if (authorityEnd == std::string::npos) {
+		authorityEnd = url.size();
+	}
+	const size_t userInfoEnd = url.rfind('@', authorityEnd);
+	if (userInfoEnd != std::string::npos && userInfoEnd >= hostStart) {
+		hostStart = userInfoEnd + 1;
+	}
+	if (hostStart >= authorityEnd || url[hostStart] == '[') {
+		return false;
+	}
+	size_t hostEnd = url.find(':', hostStart);
+	if (hostEnd == std::string::npos || hostEnd > authorityEnd) {
+		hostEnd = authorityEnd;
+	}
+	out.assign(url, 0, hostStart);
+	out += address;
+	out.append(url, hostEnd, std::string::npos);
+	return true;
+}
+
 inline const char *validateFetchTlsOptions(const std::string &url, const ResolvedFetchTlsOptions &resolved) {
 	if (!fetchUrlUsesHttps(url)) {
 		return nullptr;
@@ -267,8 +1003,34 @@ inline const char *validateFetchTransportOptions(
 }
 } // namespace esp_fetch_detail
 
+// The result document is moved into the callback, never copied. Lambdas may take it either by
+// value or as `JsonDocument &&` to keep ownership without another allocation.
 using FetchCallback = std::function<void(JsonDocument result)>;
 
+// One request of an ESPFetch::submitBatch call.
+struct FetchBatchRequest {
+	FetchMethod method = FetchMethod::Get;
+	std::string url;
+	// Sent like a post() payload (see FetchRequestOptions::bodyFormat) unless null.
+	JsonDocument payload;
+	FetchRequestOptions options;
+};
+
+// results[i] is the result document of requests[i], shaped like a get() / post() result.
+using FetchBatchCallback = std::function<void(std::vector<JsonDocument> results)>;
+
+// Phase timestamps in microseconds since the job started running, taken from esp_http_client
+// events. -1 means the phase was not observed (e.g. no ON_CONNECTED on a reused connection).
+// connectedUs covers DNS, TCP connect and the TLS handshake together.
+struct FetchTiming {
+	int64_t queuedUs = 0; // enqueue to job start (slot wait, pending queue, task start)
+	int64_t connectedUs = -1;
+	int64_t headersSentUs = -1;
+	int64_t firstHeaderUs = -1;
+	int64_t firstDataUs = -1;
+	int64_t finishedUs = -1;
+};
+
 // ------------------------------
 // Streaming (binary/any-content)
 // ------------------------------
@@ -276,32 +1038,221 @@ struct StreamStartInfo {
 	int statusCode = 0;
 	int64_t contentLength = -1;
 	bool isChunked = false;
+	// 206 Partial Content and the parsed Content-Range header (-1 when absent).
+	bool isPartial = false;
+	int64_t rangeStart = -1;
+	int64_t rangeEnd = -1;
+	int64_t totalLength = -1;
 };
 
 struct StreamResult {
 	esp_err_t error = ESP_OK;
 	int statusCode = 0;
 	size_t receivedBytes = 0;
+	FetchTiming timing;
 };
 
 using FetchStreamStartCallback = std::function<bool(const StreamStartInfo &info)>;
 using FetchChunkCallback = std::function<bool(const void *data, size_t size)>;
 using FetchStreamCallback = std::function<void(StreamResult result)>;
+// One element of the array read by getJsonStream, parsed on its own. Return false to stop.
+using FetchJsonElementCallback = std::function<bool(JsonDocument element)>;
+
+// ------------------------------
+// Streaming uploads (request body)
+// ------------------------------
+class FetchDeflater;
+
+// Print sink handed to a FetchBodyProducer. Bytes go to the connection as they are written;
+// only a small coalescing buffer sits in between so byte-wise writers (serializeJson) stay cheap.
+class FetchBodyWriter : public Print {
+  public:
+	static constexpr size_t kCoalesceBytes = 128;
+
+	size_t write(uint8_t value) override;
+	size_t write(const uint8_t *buffer, size_t size) override;
+	using Print::write;
+
+	size_t bytesWritten() const {
+		return _written;
+	}
+	esp_err_t error() const {
+		return _error;
+	}
+
+  private:
+	friend class ESPFetch;
+
+	// contentLength < 0 selects chunked transfer encoding, as does a deflater; contentLength then
+	// still bounds the unencoded bytes.
+	FetchBodyWriter(
+	    esp_http_client_handle_t client, int64_t contentLength, FetchDeflater *deflater = nullptr
+	)
+	    : _client(client), _contentLength(contentLength), _deflater(deflater) {
+	}
+
+	static bool sendEncoded(void *context, const uint8_t *data, size_t size);
+	bool chunked() const {
+		return _contentLength < 0 || _deflater != nullptr;
+	}
+	bool flushPending();
+	bool finish();
+	bool forward(const uint8_t *data, size_t size);
+	bool send(const char *data, size_t size);
+
+	esp_http_client_handle_t _client;
+	int64_t _contentLength;
+	FetchDeflater *_deflater;
+	size_t _written = 0;
+	size_t _sent = 0; // body bytes on the wire, after encoding
+	esp_err_t _error = ESP_OK;
+	uint8_t _pending[kCoalesceBytes];
+	size_t _pendingLength = 0;
+};
+
+// Writes the request body; return false to abort the request.
+using FetchBodyProducer = std::function<bool(FetchBodyWriter &writer)>;
+
+// ------------------------------
+// Raw responses (no JSON wrapping)
+// ------------------------------
+struct FetchRawHeader {
+	FetchString name;
+	FetchString value;
+
+	FetchRawHeader(
+	    const char *headerName, const char *headerValue, const FetchAllocator<char> &allocator
+	)
+	    : name(headerName ? headerName : "", allocator),
+	      value(headerValue ? headerValue : "", allocator) {
+	}
+};
+
+using FetchRawHeaderVector = FetchVector<FetchRawHeader>;
+
+// Status, body and headers exactly as received. Move-only so the body is never duplicated.
+struct FetchRawResponse {
+	explicit FetchRawResponse(bool usePSRAMBuffers = false)
+	    : body(FetchAllocator<char>(usePSRAMBuffers)),
+	      headers(FetchAllocator<FetchRawHeader>(usePSRAMBuffers)) {
+	}
+	FetchRawResponse(const FetchRawResponse &) = delete;
+	FetchRawResponse &operator=(const FetchRawResponse &) = delete;
+	FetchRawResponse(FetchRawResponse &&) = default;
+	FetchRawResponse &operator=(FetchRawResponse &&) = default;
+
+	esp_err_t error = ESP_OK;
+	int statusCode = 0;
+	FetchString body;
+	FetchRawHeaderVector headers;
+	bool bodyTruncated = false;
+	bool headersTruncated = false;
+	int64_t durationUs = 0;
+	FetchTiming timing;
+	// Body served by the response cache: either still fresh (no request was sent) or confirmed
+	// by a 304, in which case statusCode is reported as 200.
+	bool fromCache = false;
+
+	// Same rule as result["ok"] in JSON mode: no transport error and a 2xx/3xx status.
+	bool ok() const {
+		return error == ESP_OK && statusCode >= 200 && statusCode < 400;
+	}
+	// Case-insensitive lookup of the first header with this name, or nullptr.
+	const FetchString *header(const char *name) const;
+};
+
+using FetchRawCallback = std::function<void(FetchRawResponse response)>;
+
+// ------------------------------
+// Prepared requests
+// ------------------------------
+// A GET / POST resolved once by ESPFetch::prepareGet / preparePost: the normalized URL, the
+// transport and TLS options and the header strings are reused by every submit() instead of being
+// rebuilt per call. Copies share the same immutable state, so a template may be submitted from
+// several tasks at once. It is bound to the ESPFetch that prepared it; after init() or
+// updateConfig() its transport is re-resolved against the new config on submit.
+class FetchRequestTemplate {
+  public:
+	bool ok() const {
+		return _prepared != nullptr;
+	}
+	// Why preparing failed, or nullptr.
+	const char *error() const {
+		return _error;
+	}
+
+  private:
+	friend class ESPFetch;
+	struct Prepared;
+
+	std::shared_ptr<const Prepared> _prepared;
+	const char *_error = nullptr;
+};
+
+// ------------------------------
+// Request handles
+// ------------------------------
+// Returned by the async APIs. It converts to true when the request was accepted, so existing
+// `if (fetch.get(...))` and `bool started = fetch.get(...)` code keeps working, and it may be
+// dropped without affecting the request. Copies refer to the same request.
+class FetchHandle {
+  public:
+	FetchHandle() = default;
+
+	operator bool() const {
+		return _control != nullptr;
+	}
+	// Stops the request: a queued one completes without connecting once it reaches the front, a
+	// running one aborts at its next HTTP event or read. The callback still runs, with
+	// ESP_ERR_INVALID_STATE. Returns false when there is no request or it already finished.
+	bool cancel() const;
+	bool cancelled() const;
+	// The request completed and its callback returned.
+	bool finished() const;
+
+  private:
+	friend class ESPFetch;
+	struct Control;
+
+	explicit FetchHandle(std::shared_ptr<Control> control) : _control(std::move(control)) {
+	}
+
+	std::shared_ptr<Control> _control;
+};
 
 class ESPFetch {
   public:
-	ESPFetch() = default;
+	ESPFetch();
 	~ESPFetch();
 
 	bool init(const FetchConfig &config = FetchConfig{});
 	void deinit();
+	// Publishes `config` for requests started from now on; queued and running requests finish
+	// with the settings they started with. Slot and worker counts follow maxConcurrentRequests
+	// live. stackSize, priority and coreId apply to tasks created from now on: in worker-pool mode
+	// running workers keep theirs, and only workers spawned by a later grow use the new values.
+	// Connection pool, response cache, arena, circuit breaker, PSRAM and worker-pool mode
+	// settings still need init(). Call it from the task that owns init()/deinit().
+	bool updateConfig(const FetchConfig &config);
+	// Copy of the configuration new requests use.
+	FetchConfig config() const;
 	bool isInitialized() const;
+	// Requests parked in the pending queue, waiting for a slot.
+	size_t pendingRequests() const;
+	FetchStats stats() const;
+	void resetStats();
+	// Request trace (see fetch_trace.h; empty unless built with ESP_FETCH_ENABLE_TRACE=1).
+	// traceSnapshot copies up to `capacity` of the newest records, oldest first, and returns how
+	// many it copied; dumpTrace prints them one per line. Neither formats on the request path.
+	size_t traceSnapshot(FetchTraceRecord *out, size_t capacity) const;
+	void dumpTrace(Print &out) const;
+	void clearTrace();
 
-	bool
+	FetchHandle
 	get(const char *url,
 	    FetchCallback callback,
 	    const FetchRequestOptions &options = FetchRequestOptions{});
-	bool
+	FetchHandle
 	get(const String &url,
 	    FetchCallback callback,
 	    const FetchRequestOptions &options = FetchRequestOptions{});
@@ -314,13 +1265,13 @@ class ESPFetch {
 	    TickType_t waitTicks,
 	    const FetchRequestOptions &options = FetchRequestOptions{});
 
-	bool post(
+	FetchHandle post(
 	    const char *url,
 	    const JsonDocument &payload,
 	    FetchCallback callback,
 	    const FetchRequestOptions &options = FetchRequestOptions{}
 	);
-	bool post(
+	FetchHandle post(
 	    const String &url,
 	    const JsonDocument &payload,
 	    FetchCallback callback,
@@ -339,27 +1290,253 @@ class ESPFetch {
 	    const FetchRequestOptions &options = FetchRequestOptions{}
 	);
 
+	// Any method, with or without a payload. HEAD responses are never buffered: the result has
+	// the status and headers only. A payload is serialized like post() (see bodyFormat) and is
+	// sent with Content-Type for every method.
+	FetchHandle request(
+	    FetchMethod method,
+	    const char *url,
+	    FetchCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle request(
+	    FetchMethod method,
+	    const char *url,
+	    const JsonDocument &payload,
+	    FetchCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle request(
+	    FetchMethod method,
+	    const String &url,
+	    FetchCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle request(
+	    FetchMethod method,
+	    const String &url,
+	    const JsonDocument &payload,
+	    FetchCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	JsonDocument request(
+	    FetchMethod method,
+	    const char *url,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	JsonDocument request(
+	    FetchMethod method,
+	    const char *url,
+	    const JsonDocument &payload,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	JsonDocument request(
+	    FetchMethod method,
+	    const String &url,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	JsonDocument request(
+	    FetchMethod method,
+	    const String &url,
+	    const JsonDocument &payload,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle requestRaw(
+	    FetchMethod method,
+	    const char *url,
+	    FetchRawCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle requestRaw(
+	    FetchMethod method,
+	    const char *url,
+	    const JsonDocument &payload,
+	    FetchRawCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle requestRaw(
+	    FetchMethod method,
+	    const String &url,
+	    FetchRawCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle requestRaw(
+	    FetchMethod method,
+	    const String &url,
+	    const JsonDocument &payload,
+	    FetchRawCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchRawResponse requestRaw(
+	    FetchMethod method,
+	    const char *url,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchRawResponse requestRaw(
+	    FetchMethod method,
+	    const char *url,
+	    const JsonDocument &payload,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchRawResponse requestRaw(
+	    FetchMethod method,
+	    const String &url,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchRawResponse requestRaw(
+	    FetchMethod method,
+	    const String &url,
+	    const JsonDocument &payload,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+
+	// Resumable stream download: like getStream, but a dropped connection is re-requested from
+	// the bytes already delivered (see FetchRequestOptions::resumeAttempts).
+	FetchHandle download(
+	    const char *url,
+	    FetchChunkCallback onChunk,
+	    FetchStreamCallback onDone = nullptr,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle download(
+	    const String &url,
+	    FetchChunkCallback onChunk,
+	    FetchStreamCallback onDone = nullptr,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+
+	// POST whose body is produced on the worker task while it is sent. Pass contentLength < 0
+	// when the size is unknown to upload with chunked transfer encoding.
+	FetchHandle postStream(
+	    const char *url,
+	    int64_t contentLength,
+	    FetchBodyProducer producer,
+	    FetchCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle postStream(
+	    const String &url,
+	    int64_t contentLength,
+	    FetchBodyProducer producer,
+	    FetchCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+
+	// Same requests as get/post, delivered as FetchRawResponse without building a JsonDocument.
+	FetchHandle getRaw(
+	    const char *url,
+	    FetchRawCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle getRaw(
+	    const String &url,
+	    FetchRawCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchRawResponse getRaw(
+	    const char *url,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchRawResponse getRaw(
+	    const String &url,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+
+	FetchHandle postRaw(
+	    const char *url,
+	    const JsonDocument &payload,
+	    FetchRawCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle postRaw(
+	    const String &url,
+	    const JsonDocument &payload,
+	    FetchRawCallback callback,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchRawResponse postRaw(
+	    const char *url,
+	    const JsonDocument &payload,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchRawResponse postRaw(
+	    const String &url,
+	    const JsonDocument &payload,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+
+	// Prepared requests for endpoints that are called over and over (see FetchRequestTemplate).
+	FetchRequestTemplate
+	prepareGet(const char *url, const FetchRequestOptions &options = FetchRequestOptions{});
+	FetchRequestTemplate
+	prepareGet(const String &url, const FetchRequestOptions &options = FetchRequestOptions{});
+	FetchRequestTemplate
+	preparePost(const char *url, const FetchRequestOptions &options = FetchRequestOptions{});
+	FetchRequestTemplate
+	preparePost(const String &url, const FetchRequestOptions &options = FetchRequestOptions{});
+	FetchRequestTemplate prepare(
+	    FetchMethod method,
+	    const char *url,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchRequestTemplate prepare(
+	    FetchMethod method,
+	    const String &url,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	// `query` (already URL-encoded, without the leading '?') is appended to the prepared URL.
+	FetchHandle submit(
+	    const FetchRequestTemplate &request, FetchCallback callback, const char *query = nullptr
+	);
+	FetchHandle submit(
+	    const FetchRequestTemplate &request,
+	    const JsonDocument &payload,
+	    FetchCallback callback,
+	    const char *query = nullptr
+	);
+	FetchHandle submitRaw(
+	    const FetchRequestTemplate &request, FetchRawCallback callback, const char *query = nullptr
+	);
+
+	// Runs many small JSON requests as one unit. Requests to the same origin run one after another
+	// on a shared kept-alive connection; origins run in parallel, up to maxConcurrentRequests at a
+	// time, each group taking one slot. onDone receives every result once the last request is
+	// done (on the calling task if none could start). cancel() stops the requests not yet done.
+	FetchHandle submitBatch(std::vector<FetchBatchRequest> requests, FetchBatchCallback onDone);
+
 	// Stream download (binary / any kind). No JSON handling.
-	bool getStream(
+	FetchHandle getStream(
 	    const char *url,
 	    FetchChunkCallback onChunk,
 	    FetchStreamCallback onDone = nullptr,
 	    const FetchRequestOptions &options = FetchRequestOptions{}
 	);
-	bool getStream(
+	FetchHandle getStream(
 	    const char *url,
 	    FetchStreamStartCallback onStart,
 	    FetchChunkCallback onChunk,
 	    FetchStreamCallback onDone = nullptr,
 	    const FetchRequestOptions &options = FetchRequestOptions{}
 	);
-	bool getStream(
+	FetchHandle getStream(
 	    const String &url,
 	    FetchChunkCallback onChunk,
 	    FetchStreamCallback onDone = nullptr,
 	    const FetchRequestOptions &options = FetchRequestOptions{}
 	);
-	bool getStream(
+	FetchHandle getStream(
 	    const String &url,
 	    FetchStreamStartCallback onStart,
 	    FetchChunkCallback onChunk,
@@ -367,12 +1544,95 @@ class ESPFetch {
 	    const FetchRequestOptions &options = FetchRequestOptions{}
 	);
 
+	// Stream download of a JSON body that hands out the elements of one array while it is
+	// received, each parsed into its own JsonDocument, so memory stays bounded by one element
+	// whatever the response size. arrayPath names the array by object keys from the root
+	// ("data.items"); nullptr or "" reads a body that is itself an array. Non-2xx bodies are not
+	// scanned. onDone reports ESP_ERR_NOT_FOUND when the array is missing and
+	// ESP_ERR_INVALID_RESPONSE for malformed JSON.
+	FetchHandle getJsonStream(
+	    const char *url,
+	    const char *arrayPath,
+	    FetchJsonElementCallback onElement,
+	    FetchStreamCallback onDone = nullptr,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle getJsonStream(
+	    const char *url,
+	    const char *arrayPath,
+	    FetchStreamStartCallback onStart,
+	    FetchJsonElementCallback onElement,
+	    FetchStreamCallback onDone = nullptr,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle getJsonStream(
+	    const String &url,
+	    const char *arrayPath,
+	    FetchJsonElementCallback onElement,
+	    FetchStreamCallback onDone = nullptr,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+	FetchHandle getJsonStream(
+	    const String &url,
+	    const char *arrayPath,
+	    FetchStreamStartCallback onStart,
+	    FetchJsonElementCallback onElement,
+	    FetchStreamCallback onDone = nullptr,
+	    const FetchRequestOptions &options = FetchRequestOptions{}
+	);
+
   private:
 	struct FetchJob;
 	struct FetchResponse;
 	struct SyncHandle;
+	struct BatchState;
+	struct WorkerLane;
+	struct BatchConnection;
+
+	std::unique_ptr<FetchJob> prepareRequestJob(
+	    const std::string &url,
+	    esp_http_client_method_t method,
+	    FetchString &&body,
+	    const FetchRequestOptions &options,
+	    bool rawResult,
+	    const char **startErrorOut
+	);
+	bool resolveRequestTarget(
+	    const std::string &url,
+	    const FetchRequestOptions &options,
+	    std::shared_ptr<const FetchConfig> &config,
+	    std::string &normalizedUrl,
+	    esp_fetch_detail::ResolvedFetchTransportOptions &transport,
+	    const char **startErrorOut
+	) const;
+	void applyRequestOptions(FetchJob &job, const FetchRequestOptions &options, bool rawResult);
+	JsonDocument requestSync(
+	    esp_http_client_method_t method,
+	    const char *url,
+	    FetchString &&body,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options
+	);
+	FetchRawResponse requestRawSync(
+	    esp_http_client_method_t method,
+	    const char *url,
+	    FetchString &&body,
+	    TickType_t waitTicks,
+	    const FetchRequestOptions &options
+	);
+	FetchRequestTemplate prepareTemplate(
+	    const char *url, esp_http_client_method_t method, const FetchRequestOptions &options
+	);
+	FetchHandle submitTemplate(
+	    const FetchRequestTemplate &request,
+	    FetchString &&body,
+	    const char *query,
+	    FetchCallback callback,
+	    FetchRawCallback rawCallback,
+	    bool rawResult
+	);
 
-	bool enqueueRequest(
+	FetchHandle enqueueRequest(
 	    const std::string &url,
 	    esp_http_client_method_t method,
 	    FetchString &&body,
@@ -382,7 +1642,31 @@ class ESPFetch {
 	    const char **startErrorOut = nullptr
 	);
 
-	bool enqueueStreamRequest(
+	FetchHandle enqueueRawRequest(
+	    const std::string &url,
+	    esp_http_client_method_t method,
+	    FetchString &&body,
+	    FetchRawCallback callback,
+	    std::shared_ptr<SyncHandle> syncHandle,
+	    const FetchRequestOptions &options,
+	    const char **startErrorOut = nullptr
+	);
+
+	FetchHandle enqueueUploadRequest(
+	    const std::string &url,
+	    esp_http_client_method_t method,
+	    int64_t contentLength,
+	    FetchBodyProducer producer,
+	    FetchCallback callback,
+	    const FetchRequestOptions &options,
+	    const char **startErrorOut = nullptr
+	);
+
+	FetchRawResponse waitForRawResult(
+	    const std::shared_ptr<SyncHandle> &handle, TickType_t waitTicks
+	) const;
+
+	FetchHandle enqueueStreamRequest(
 	    const std::string &url,
 	    FetchStreamStartCallback onStart,
 	    FetchChunkCallback onChunk,
@@ -391,19 +1675,115 @@ class ESPFetch {
 	    const char **startErrorOut = nullptr
 	);
 
+	FetchHandle enqueueJsonStreamRequest(
+	    const char *url,
+	    const char *arrayPath,
+	    FetchStreamStartCallback onStart,
+	    FetchJsonElementCallback onElement,
+	    FetchStreamCallback onDone,
+	    const FetchRequestOptions &options
+	);
+
 	JsonDocument
 	waitForResult(const std::shared_ptr<SyncHandle> &handle, TickType_t waitTicks) const;
 
+	FetchHandle trackJob(FetchJob &job);
+	esp_err_t checkStop(FetchJob &job);
+	bool hasLiveCoalescedWaiters(const FetchJob &job) const;
+	int attemptTimeoutMs(const FetchJob &job) const;
+	bool admitJob(std::unique_ptr<FetchJob> job, const char **startErrorOut);
+	bool tryTakeSlotLocked(FetchPriority priority, size_t memoryBytes, bool *memoryShort = nullptr);
+	bool waitForSlot(FetchPriority priority, size_t memoryBytes, TickType_t acquireTicks);
+	FetchJob *takeNextPendingLocked();
+	void releaseSlotLocked(size_t memoryBytes);
+	void releaseSlot(size_t memoryBytes);
+	void startPendingJobs();
+	void wakeSlotWaiters();
+	void failPendingJobs();
+	bool dispatchJob(std::unique_ptr<FetchJob> &job, const char **startErrorOut);
+	bool startWorkerPool(const FetchConfig &config);
+	bool spawnWorkers(WorkerLane &lane, size_t count, const FetchLane &settings);
+	bool resizeWorkerPool(const FetchConfig &config);
+	static bool retireSurplusWorker(WorkerLane &lane);
+	void stopWorkerPool();
+	std::shared_ptr<const FetchConfig> configSnapshot() const;
+	FetchAllocator<char> bodyAllocator() const;
+	void publishSchedulingLimits(const FetchConfig &config);
+
 	static void requestTask(void *arg);
+	static void workerTask(void *arg); // arg is the WorkerLane
+	static void dnsPrefetchTask(void *arg);
 	static esp_err_t handleHttpEvent(esp_http_client_event_t *event);
 
 	void runJob(std::unique_ptr<FetchJob> job);
-	JsonDocument buildResult(const FetchJob &job, const FetchResponse &response) const;
-	static void deliverResult(const std::unique_ptr<FetchJob> &job, const JsonDocument &result);
+	void executeJob(std::unique_ptr<FetchJob> job);
+	void runBatchGroup(std::unique_ptr<FetchJob> group);
+	void completeJob(std::unique_ptr<FetchJob> job);
+	esp_http_client_handle_t acquireClient(FetchJob &job, bool &reused);
+	bool retargetClient(
+	    FetchJob &job, esp_http_client_handle_t client, bool connected, int timeoutMs, bool &reused
+	) const;
+	void releaseClient(FetchJob &job, esp_http_client_handle_t client, bool keepOpen);
+	void assignConnectionKey(FetchJob &job) const;
+	bool attachToInflightJob(std::unique_ptr<FetchJob> &job);
+	void deliverCoalescedResults(FetchJob &job, const JsonDocument &result);
+	bool serveFromResponseCache(FetchJob &job);
+	void updateResponseCache(FetchJob &job);
+	bool admitThroughCircuitBreaker(FetchJob &job);
+	void startDnsPrefetch(const FetchConfig &config);
+	bool resolveConnectAddress(FetchJob &job);
+	void recordCircuitResult(const FetchJob &job);
+	void runExchange(FetchJob &job, esp_http_client_handle_t client, bool reusedConnection);
+	bool prepareRetry(FetchJob &job, esp_http_client_handle_t client, uint8_t attempt);
+	void runBufferedExchange(FetchJob &job, esp_http_client_handle_t client, bool reusedConnection);
+	esp_err_t openResponse(FetchJob &job, esp_http_client_handle_t client, StreamStartInfo &startInfo);
+	void runStreamExchange(FetchJob &job, esp_http_client_handle_t client);
+	bool runPipelinedStreamReads(FetchJob &job, esp_http_client_handle_t client);
+	void readStreamInline(FetchJob &job, esp_http_client_handle_t client);
+	bool prepareStreamResume(FetchJob &job, esp_http_client_handle_t client);
+	void runParsedBodyExchange(FetchJob &job, esp_http_client_handle_t client);
+	void runUploadExchange(FetchJob &job, esp_http_client_handle_t client);
+	void readParsedBody(FetchJob &job, esp_http_client_handle_t client);
+	void readBufferedBody(FetchJob &job, esp_http_client_handle_t client);
+	JsonDocument buildResult(const FetchJob &job, FetchResponse &response) const;
+	JsonDocument buildCancelledResult(const FetchJob &job) const;
+	static void deliverResult(const std::unique_ptr<FetchJob> &job, JsonDocument &&result);
+	static void deliverDocument(
+	    FetchCallback &callback, const std::shared_ptr<SyncHandle> &handle, JsonDocument &&result
+	);
+	static void deliverRawResult(const std::unique_ptr<FetchJob> &job);
 
-	FetchConfig _config{};
+	// Immutable snapshot swapped by updateConfig(); guarded by _schedulerMutex.
+	std::shared_ptr<const FetchConfig> _config = std::make_shared<const FetchConfig>();
 	std::atomic<bool> _initialized{false};
 	std::atomic<bool> _teardownRequested{false};
 	std::atomic<size_t> _activeTasks{0};
-	SemaphoreHandle_t _slotSemaphore = nullptr;
+	// Slot accounting: _runningJobs, _pendingJobs and the limits below are guarded by
+	// _schedulerMutex.
+	SemaphoreHandle_t _schedulerMutex = nullptr;
+	SemaphoreHandle_t _slotReleased = nullptr;
+	size_t _runningJobs = 0;
+	size_t _slotLimit = 0;
+	size_t _reservedHighSlots = 0;
+	size_t _pendingLimit = 0;
+	size_t _slotWaiters = 0; // callers blocked in waitForSlot()
+	// Memory governor: estimated bytes held by running jobs, and the FetchConfig limits.
+	size_t _reservedMemoryBytes = 0;
+	size_t _memoryBudget = 0;
+	size_t _minFreeHeap = 0;
+	std::deque<FetchJob *> _pendingJobs[3];
+	std::atomic<size_t> _pendingCount{0};
+	// Queued or running jobs other GETs may attach to; guarded by _schedulerMutex.
+	std::vector<FetchJob *> _coalescingJobs;
+	FetchStatsRecorder _stats;
+	// Worker pool, one entry per lane (index 0 = default lane); empty without a pool.
+	std::vector<std::unique_ptr<WorkerLane>> _workerLanes;
+	FetchConnectionPool _connectionPool;
+	FetchResponseCache _responseCache;
+	FetchArenaPool _arenaPool;
+	FetchCircuitBreaker _circuitBreaker;
+	FetchDnsCache _dnsCache;
+#if ESP_FETCH_ENABLE_TRACE
+	FetchTraceBuffer _trace;
+#endif
 };
@@ -11,10 +11,12 @@
 #endif
 
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <limits>
 #include <new>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace fetch_allocator_detail {
@@ -36,17 +38,122 @@ inline void deallocate(void *ptr) noexcept {
 }
 } // namespace fetch_allocator_detail
 
+// Bump allocator for one job's scratch allocations (read buffers, response headers and body).
+// The block is reserved once and handed from job to job; frees inside it are no-ops except for
+// the newest allocation, and reset() reclaims everything at once. Requests that do not fit fall
+// through to the heap. Not thread-safe: an arena belongs to the task running its job.
+class FetchArena {
+  public:
+	static constexpr std::size_t kAlignment = alignof(std::max_align_t);
+
+	FetchArena() = default;
+	~FetchArena() {
+		release();
+	}
+
+	FetchArena(const FetchArena &) = delete;
+	FetchArena &operator=(const FetchArena &) = delete;
+
+	bool reserve(std::size_t bytes, bool usePSRAMBuffers) noexcept {
+		release();
+		bytes = (bytes + kAlignment - 1) & ~(kAlignment - 1);
+		_base = static_cast<uint8_t *>(fetch_allocator_detail::allocate(bytes, usePSRAMBuffers));
+		if (_base == nullptr) {
+			return false;
+		}
+		_capacity = bytes;
+		reset();
+		return true;
+	}
+
+	void release() noexcept {
+		if (_base != nullptr) {
+			fetch_allocator_detail::deallocate(_base);
+			_base = nullptr;
+		}
+		_capacity = 0;
+		reset();
+	}
+
+	void *allocate(std::size_t bytes, bool usePSRAMBuffers) noexcept {
+		const std::size_t rounded = (bytes + kAlignment - 1) & ~(kAlignment - 1);
+		if (rounded >= bytes && rounded <= _capacity - _offset) {
+			_lastOffset = _offset;
+			_offset += rounded;
+			if (_offset > _highWater) {
+				_highWater = _offset;
+			}
+			return _base + _lastOffset;
+		}
+		++_overflows;
+		return fetch_allocator_detail::allocate(bytes, usePSRAMBuffers);
+	}
+
+	void deallocate(void *ptr) noexcept {
+		if (!owns(ptr)) {
+			fetch_allocator_detail::deallocate(ptr);
+		} else if (static_cast<uint8_t *>(ptr) == _base + _lastOffset) {
+			_offset = _lastOffset;
+		}
+	}
+
+	// Reclaims every arena allocation and starts a new high-water mark.
+	void reset() noexcept {
+		_offset = 0;
+		_lastOffset = 0;
+		_highWater = 0;
+		_overflows = 0;
+	}
+
+	bool owns(const void *ptr) const noexcept {
+		const auto *bytes = static_cast<const uint8_t *>(ptr);
+		return _base != nullptr && bytes >= _base && bytes < _base + _capacity;
+	}
+	std::size_t capacity() const noexcept {
+		return _capacity;
+	}
+	// Most bytes in use at once since the last reset().
+	std::size_t highWater() const noexcept {
+		return _highWater;
+	}
+	// Allocations since the last reset() that did not fit and used the heap.
+	uint32_t overflows() const noexcept {
+		return _overflows;
+	}
+
+  private:
+	uint8_t *_base = nullptr;
+	std::size_t _capacity = 0;
+	std::size_t _offset = 0;
+	std::size_t _lastOffset = 0;
+	std::size_t _highWater = 0;
+	uint32_t _overflows = 0;
+};
+
 template <typename T> class FetchAllocator {
   public:
 	using value_type = T;
+	// Containers adopt the placement policy of whatever they are assigned from.
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
 
 	FetchAllocator() noexcept = default;
 	explicit FetchAllocator(bool usePSRAMBuffers) noexcept : _usePSRAMBuffers(usePSRAMBuffers) {
 	}
+	// Allocates from `arena` while it has room; `usePSRAMBuffers` places the heap fallback.
+	FetchAllocator(bool usePSRAMBuffers, FetchArena *arena) noexcept
+	    : _usePSRAMBuffers(usePSRAMBuffers), _arena(arena) {
+	}
 
 	template <typename U>
 	FetchAllocator(const FetchAllocator<U> &other) noexcept
-	    : _usePSRAMBuffers(other.usePSRAMBuffers()) {
+	    : _usePSRAMBuffers(other.usePSRAMBuffers()), _arena(other.arena()) {
+	}
+
+	// Copies of arena-backed containers outlive the job, so they go to the heap.
+	FetchAllocator select_on_container_copy_construction() const noexcept {
+		return FetchAllocator(_usePSRAMBuffers);
 	}
 
 	T *allocate(std::size_t n) {
@@ -57,7 +164,8 @@ template <typename T> class FetchAllocator {
 			return nullptr;
 		}
 
-		void *memory = fetch_allocator_detail::allocate(n * sizeof(T), _usePSRAMBuffers);
+		void *memory = _arena ? _arena->allocate(n * sizeof(T), _usePSRAMBuffers)
+		                      : fetch_allocator_detail::allocate(n * sizeof(T), _usePSRAMBuffers);
 		if (memory == nullptr) {
 			return nullptr;
 		}
@@ -65,15 +173,22 @@ template <typename T> class FetchAllocator {
 	}
 
 	void deallocate(T *ptr, std::size_t) noexcept {
-		fetch_allocator_detail::deallocate(ptr);
+		if (_arena) {
+			_arena->deallocate(ptr);
+		} else {
+			fetch_allocator_detail::deallocate(ptr);
+		}
 	}
 
 	bool usePSRAMBuffers() const noexcept {
 		return _usePSRAMBuffers;
 	}
+	FetchArena *arena() const noexcept {
+		return _arena;
+	}
 
 	template <typename U> bool operator==(const FetchAllocator<U> &other) const noexcept {
-		return _usePSRAMBuffers == other.usePSRAMBuffers();
+		return _usePSRAMBuffers == other.usePSRAMBuffers() && _arena == other.arena();
 	}
 
 	template <typename U> bool operator!=(const FetchAllocator<U> &other) const noexcept {
@@ -84,6 +199,7 @@ template <typename T> class FetchAllocator {
 	template <typename> friend class FetchAllocator;
 
 	bool _usePSRAMBuffers = false;
+	FetchArena *_arena = nullptr;
 };
 
 template <typename T> using FetchVector = std::vector<T, FetchAllocator<T>>;
@@ -0,0 +1,97 @@
+#include "esp_fetch/fetch_arena_pool.h"
+
+#include <new>
+
+extern "C" {
+#include "esp_log.h"
+}
+
+namespace {
+constexpr const char *TAG = "ESPFetchArena";
+
+class ArenaLock {
+  public:
+	explicit ArenaLock(SemaphoreHandle_t mutex) : _mutex(mutex) {
+		if (_mutex) {
+			xSemaphoreTake(_mutex, portMAX_DELAY);
+		}
+	}
+	~ArenaLock() {
+		if (_mutex) {
+			xSemaphoreGive(_mutex);
+		}
+	}
+
+  private:
+	SemaphoreHandle_t _mutex;
+};
+} // namespace
+
+FetchArenaPool::~FetchArenaPool() {
+	end();
+}
+
+bool FetchArenaPool::begin(size_t arenas, size_t bytesPerArena, bool usePSRAMBuffers) {
+	end();
+	if (arenas == 0 || bytesPerArena == 0) {
+		return true;
+	}
+
+	_arenas.reset(new (std::nothrow) FetchArena[arenas]);
+	_mutex = xSemaphoreCreateMutex();
+	if (!_arenas || !_mutex) {
+		ESP_LOGE(TAG, "Failed to create job arena pool");
+		end();
+		return false;
+	}
+
+	_free = FetchVector<FetchArena *>(FetchAllocator<FetchArena *>(usePSRAMBuffers));
+	_free.reserve(arenas);
+	for (size_t i = 0; i < arenas; ++i) {
+		if (!_arenas[i].reserve(bytesPerArena, usePSRAMBuffers)) {
+			ESP_LOGE(TAG, "Failed to reserve %u byte job arena", (unsigned)bytesPerArena);
+			end();
+			return false;
+		}
+		_free.push_back(&_arenas[i]);
+	}
+	_bytesPerArena = bytesPerArena;
+	return true;
+}
+
+void FetchArenaPool::end() {
+	if (_mutex) {
+		vSemaphoreDelete(_mutex);
+		_mutex = nullptr;
+	}
+	_free.clear();
+	_free.shrink_to_fit();
+	_arenas.reset();
+	_bytesPerArena = 0;
+}
+
+bool FetchArenaPool::enabled() const {
+	return _mutex != nullptr && _bytesPerArena > 0;
+}
+
+FetchArena *FetchArenaPool::acquire() {
+	if (!enabled()) {
+		return nullptr;
+	}
+	ArenaLock lock(_mutex);
+	if (_free.empty()) {
+		return nullptr;
+	}
+	FetchArena *arena = _free.back();
+	_free.pop_back();
+	return arena;
+}
+
+void FetchArenaPool::release(FetchArena *arena) {
+	if (arena == nullptr || !enabled()) {
+		return;
+	}
+	arena->reset();
+	ArenaLock lock(_mutex);
+	_free.push_back(arena);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "fetch_allocator.h"
+
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+}
+
+// One FetchArena per request slot, reserved in begin() and lent to a job for its run. Jobs never
+// outnumber slots, so acquire() only comes back empty when the pool is disabled.
+class FetchArenaPool {
+  public:
+	FetchArenaPool() = default;
+	~FetchArenaPool();
+
+	FetchArenaPool(const FetchArenaPool &) = delete;
+	FetchArenaPool &operator=(const FetchArenaPool &) = delete;
+
+	bool begin(size_t arenas, size_t bytesPerArena, bool usePSRAMBuffers);
+	void end();
+	bool enabled() const;
+
+	FetchArena *acquire();
+	// Resets the arena; everything allocated from it must already be freed or abandoned.
+	void release(FetchArena *arena);
+
+	size_t bytesPerArena() const {
+		return _bytesPerArena;
+	}
+
+  private:
+	SemaphoreHandle_t _mutex = nullptr;
+	std::unique_ptr<FetchArena[]> _arenas;
+	FetchVector<FetchArena *> _free;
+	size_t _bytesPerArena = 0;
+};
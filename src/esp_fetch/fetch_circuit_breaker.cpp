@@ -0,0 +1,169 @@
+#include "esp_fetch/fetch_circuit_breaker.h"
+
+extern "C" {
+#include "esp_log.h"
+#include "esp_timer.h"
+}
+
+namespace {
+constexpr const char *TAG = "ESPFetchBreaker";
+
+class BreakerLock {
+  public:
+	explicit BreakerLock(SemaphoreHandle_t mutex) : _mutex(mutex) {
+		if (_mutex) {
+			xSemaphoreTake(_mutex, portMAX_DELAY);
+		}
+	}
+	~BreakerLock() {
+		if (_mutex) {
+			xSemaphoreGive(_mutex);
+		}
+	}
+
+  private:
+	SemaphoreHandle_t _mutex;
+};
+} // namespace
+
+FetchCircuitBreaker::~FetchCircuitBreaker() {
+	end();
+}
+
+bool FetchCircuitBreaker::begin(
+    size_t maxHosts, uint8_t threshold, uint32_t openMs, bool usePSRAMBuffers
+) {
+	end();
+	if (maxHosts == 0 || threshold == 0) {
+		return true;
+	}
+
+	_mutex = xSemaphoreCreateMutex();
+	if (!_mutex) {
+		ESP_LOGE(TAG, "Failed to create circuit breaker mutex");
+		return false;
+	}
+
+	_entries = FetchVector<Entry>(FetchAllocator<Entry>(usePSRAMBuffers));
+	_entries.reserve(maxHosts);
+	_maxHosts = maxHosts;
+	_threshold = threshold;
+	_openUs = static_cast<int64_t>(openMs) * 1000;
+	return true;
+}
+
+void FetchCircuitBreaker::end() {
+	if (!_mutex) {
+		return;
+	}
+	{
+		BreakerLock lock(_mutex);
+		FetchVector<Entry>(_entries.get_allocator()).swap(_entries);
+		_maxHosts = 0;
+		_threshold = 0;
+	}
+	vSemaphoreDelete(_mutex);
+	_mutex = nullptr;
+}
+
+bool FetchCircuitBreaker::enabled() const {
+	return _mutex != nullptr;
+}
+
+bool FetchCircuitBreaker::allow(const FetchString &key) {
+	if (!enabled() || key.empty()) {
+		return true;
+	}
+
+	BreakerLock lock(_mutex);
+	Entry *entry = findLocked(key);
+	if (!entry || entry->openedUs < 0) {
+		return true;
+	}
+
+	const int64_t now = esp_timer_get_time();
+	entry->lastUsedUs = now;
+	if (now - entry->openedUs < _openUs) {
+		return false;
+	}
+	if (entry->probeUs >= 0 && now - entry->probeUs < _openUs) {
+		return false;
+	}
+	entry->probeUs = now;
+	return true;
+}
+
+void FetchCircuitBreaker::recordResult(const FetchString &key, bool failed) {
+	if (!enabled() || key.empty()) {
+		return;
+	}
+
+	const int64_t now = esp_timer_get_time();
+	BreakerLock lock(_mutex);
+	Entry *entry = findLocked(key);
+	if (!entry) {
+		if (!failed) {
+			// Healthy origins are not worth an entry.
+			return;
+		}
+		if (_entries.size() < _maxHosts) {
+			_entries.emplace_back(key, now);
+			entry = &_entries.back();
+		} else {
+			for (auto &candidate : _entries) {
+				if (candidate.openedUs < 0 && (!entry || candidate.lastUsedUs < entry->lastUsedUs)) {
+					entry = &candidate;
+				}
+			}
+			if (!entry) {
+				// Every tracked origin is open; the new one goes untracked for now.
+				return;
+			}
+			*entry = Entry(key, now);
+		}
+	}
+
+	entry->lastUsedUs = now;
+	entry->probeUs = -1;
+	if (!failed) {
+		if (entry->openedUs >= 0) {
+			ESP_LOGI(TAG, "Circuit for %s closed", key.c_str());
+		}
+		entry->failures = 0;
+		entry->openedUs = -1;
+		return;
+	}
+
+	if (entry->failures < UINT8_MAX) {
+		++entry->failures;
+	}
+	if (entry->openedUs >= 0 || entry->failures >= _threshold) {
+		if (entry->openedUs < 0) {
+			ESP_LOGW(TAG, "Circuit for %s opened after %u failures", key.c_str(), entry->failures);
+		}
+		entry->openedUs = now;
+	}
+}
+
+size_t FetchCircuitBreaker::openCircuits() const {
+	if (!enabled()) {
+		return 0;
+	}
+	BreakerLock lock(_mutex);
+	size_t count = 0;
+	for (const auto &entry : _entries) {
+		if (entry.openedUs >= 0) {
+			++count;
+		}
+	}
+	return count;
+}
+
+FetchCircuitBreaker::Entry *FetchCircuitBreaker::findLocked(const FetchString &key) {
+	for (auto &entry : _entries) {
+		if (entry.key == key) {
+			return &entry;
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fetch_allocator.h"
+
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+}
+
+// Per-origin circuit breaker. `threshold` consecutive failures open an origin's circuit and
+// allow() refuses it for openMs. The first allow() after that lets one probe through (half open);
+// its result closes the circuit or opens it for another openMs. A probe that never reports back
+// is given up after openMs. Once maxHosts origins are tracked, the least recently used closed
+// entry is replaced.
+class FetchCircuitBreaker {
+  public:
+	FetchCircuitBreaker() = default;
+	~FetchCircuitBreaker();
+
+	FetchCircuitBreaker(const FetchCircuitBreaker &) = delete;
+	FetchCircuitBreaker &operator=(const FetchCircuitBreaker &) = delete;
+
+	bool begin(size_t maxHosts, uint8_t threshold, uint32_t openMs, bool usePSRAMBuffers);
+	void end();
+	bool enabled() const;
+
+	// False while `key`'s circuit is open (or its half-open probe is still running).
+	bool allow(const FetchString &key);
+	void recordResult(const FetchString &key, bool failed);
+
+	size_t openCircuits() const;
+
+  private:
+	struct Entry {
+		Entry() = default;
+		Entry(const FetchString &entryKey, int64_t now) : key(entryKey), lastUsedUs(now) {
+		}
+
+		FetchString key;
+		uint8_t failures = 0;
+		int64_t openedUs = -1; // -1 while closed
+		int64_t probeUs = -1;  // start of the running half-open probe, -1 when none
+		int64_t lastUsedUs = 0;
+	};
+
+	Entry *findLocked(const FetchString &key);
+
+	SemaphoreHandle_t _mutex = nullptr;
+	FetchVector<Entry> _entries;
+	size_t _maxHosts = 0;
+	uint8_t _threshold = 0;
+	int64_t _openUs = 0;
+};
@@ -0,0 +1,254 @@
+#include "esp_fetch/fetch_connection_pool.h"
+
+#include <utility>
+
+extern "C" {
+#include "esp_log.h"
+#include "esp_timer.h"
+}
+
+namespace {
+constexpr const char *TAG = "ESPFetchPool";
+constexpr size_t EXPIRED_BATCH_SIZE = 4;
+
+class PoolLock {
+  public:
+	explicit PoolLock(SemaphoreHandle_t mutex) : _mutex(mutex) {
+		if (_mutex) {
+			xSemaphoreTake(_mutex, portMAX_DELAY);
+		}
+	}
+	~PoolLock() {
+		if (_mutex) {
+			xSemaphoreGive(_mutex);
+		}
+	}
+
+  private:
+	SemaphoreHandle_t _mutex;
+};
+} // namespace
+
+FetchConnectionPool::~FetchConnectionPool() {
+	end();
+}
+
+bool FetchConnectionPool::begin(
+    size_t maxIdleConnections, uint32_t idleTimeoutMs, size_t maxTlsSessions, bool usePSRAMBuffers
+) {
+	end();
+	if (maxIdleConnections == 0 && maxTlsSessions == 0) {
+		return true;
+	}
+
+	_mutex = xSemaphoreCreateMutex();
+	if (!_mutex) {
+		ESP_LOGE(TAG, "Failed to create connection pool mutex");
+		return false;
+	}
+
+	_entries = FetchVector<Entry>(FetchAllocator<Entry>(usePSRAMBuffers));
+	_entries.reserve(maxIdleConnections + maxTlsSessions);
+	_maxIdleConnections = maxIdleConnections;
+	_maxTlsSessions = maxTlsSessions;
+	_idleTimeoutUs = static_cast<int64_t>(idleTimeoutMs) * 1000;
+	return true;
+}
+
+void FetchConnectionPool::end() {
+	if (!_mutex) {
+		return;
+	}
+
+	FetchVector<Entry> entries(_entries.get_allocator());
+	{
+		PoolLock lock(_mutex);
+		entries.swap(_entries);
+		_maxIdleConnections = 0;
+		_maxTlsSessions = 0;
+	}
+	for (auto &entry : entries) {
+		esp_http_client_cleanup(entry.client);
+	}
+
+	vSemaphoreDelete(_mutex);
+	_mutex = nullptr;
+}
+
+bool FetchConnectionPool::enabled() const {
+	return keepsConnections() || keepsTlsSessions();
+}
+
+bool FetchConnectionPool::keepsConnections() const {
+	return _mutex != nullptr && _maxIdleConnections > 0;
+}
+
+bool FetchConnectionPool::keepsTlsSessions() const {
+	return _mutex != nullptr && _maxTlsSessions > 0;
+}
+
+size_t FetchConnectionPool::countLocked(bool connected) const {
+	size_t count = 0;
+	for (const auto &entry : _entries) {
+		if (entry.connected == connected) {
+			++count;
+		}
+	}
+	return count;
+}
+
+bool FetchConnectionPool::takeOldestLocked(bool connected, Entry &out) {
+	// Entries are appended on release, so the first match is the least recently used.
+	for (size_t i = 0; i < _entries.size(); ++i) {
+		if (_entries[i].connected == connected) {
+			out = std::move(_entries[i]);
+			_entries.erase(_entries.begin() + static_cast<std::ptrdiff_t>(i));
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t FetchConnectionPool::takeExpiredLocked(int64_t now, Entry *expired, size_t capacity) {
+	size_t count = 0;
+	if (_idleTimeoutUs <= 0) {
+		return count;
+	}
+	for (size_t i = 0; i < _entries.size() && count < capacity;) {
+		if (_entries[i].connected && now - _entries[i].lastUsedUs >= _idleTimeoutUs) {
+			expired[count++] = std::move(_entries[i]);
+			_entries.erase(_entries.begin() + static_cast<std::ptrdiff_t>(i));
+		} else {
+			++i;
+		}
+	}
+	return count;
+}
+
+void FetchConnectionPool::storeSession(
+    const FetchString &key,
+    esp_http_client_handle_t client,
+    std::shared_ptr<const FetchString> serverName
+) {
+	Entry evicted;
+	bool hasEvicted = false;
+	{
+		PoolLock lock(_mutex);
+		if (_maxTlsSessions == 0) {
+			hasEvicted = true;
+			evicted.client = client;
+			evicted.serverName = std::move(serverName);
+		} else {
+			if (countLocked(false) >= _maxTlsSessions) {
+				hasEvicted = takeOldestLocked(false, evicted);
+			}
+			_entries.emplace_back(
+			    key, client, std::move(serverName), esp_timer_get_time(), false, true
+			);
+		}
+	}
+	if (hasEvicted) {
+		esp_http_client_cleanup(evicted.client);
+	}
+}
+
+void FetchConnectionPool::retire(Entry &entry) {
+	if (entry.connected && entry.sessionCapable && keepsTlsSessions()) {
+		// Drop the socket and TLS context but keep the handle for session resumption.
+		esp_http_client_close(entry.client);
+		storeSession(entry.key, entry.client, std::move(entry.serverName));
+		return;
+	}
+	esp_http_client_cleanup(entry.client);
+}
+
+esp_http_client_handle_t FetchConnectionPool::acquire(
+    const FetchString &key, bool &connected, std::shared_ptr<const FetchString> &serverName
+) {
+	connected = false;
+	if (!enabled()) {
+		return nullptr;
+	}
+
+	esp_http_client_handle_t found = nullptr;
+	Entry expired[EXPIRED_BATCH_SIZE];
+	size_t expiredCount = 0;
+	{
+		PoolLock lock(_mutex);
+		expiredCount = takeExpiredLocked(esp_timer_get_time(), expired, EXPIRED_BATCH_SIZE);
+		// Most recently released first: an open one is the least likely to be closed by the peer.
+		for (int pass = 0; pass < 2 && found == nullptr; ++pass) {
+			const bool wantConnected = pass == 0;
+			for (size_t i = _entries.size(); i > 0; --i) {
+				Entry &entry = _entries[i - 1];
+				if (entry.connected == wantConnected && entry.key == key) {
+					found = entry.client;
+					connected = entry.connected;
+					serverName = std::move(entry.serverName);
+					_entries.erase(_entries.begin() + static_cast<std::ptrdiff_t>(i - 1));
+					break;
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < expiredCount; ++i) {
+		retire(expired[i]);
+	}
+	return found;
+}
+
+void FetchConnectionPool::release(
+    const FetchString &key,
+    esp_http_client_handle_t client,
+    bool keepOpen,
+    bool keepSession,
+    std::shared_ptr<const FetchString> serverName
+) {
+	if (!client) {
+		return;
+	}
+
+	if (keepOpen && keepsConnections()) {
+		Entry retired[EXPIRED_BATCH_SIZE + 1];
+		size_t retiredCount = 0;
+		{
+			PoolLock lock(_mutex);
+			const int64_t now = esp_timer_get_time();
+			retiredCount = takeExpiredLocked(now, retired, EXPIRED_BATCH_SIZE);
+			if (countLocked(true) >= _maxIdleConnections &&
+			    takeOldestLocked(true, retired[retiredCount])) {
+				++retiredCount;
+			}
+			_entries.emplace_back(key, client, std::move(serverName), now, true, keepSession);
+		}
+		for (size_t i = 0; i < retiredCount; ++i) {
+			retire(retired[i]);
+		}
+		return;
+	}
+
+	if (keepSession && keepsTlsSessions()) {
+		esp_http_client_close(client);
+		storeSession(key, client, std::move(serverName));
+		return;
+	}
+
+	esp_http_client_cleanup(client);
+}
+
+size_t FetchConnectionPool::idleConnections() const {
+	if (!_mutex) {
+		return 0;
+	}
+	PoolLock lock(_mutex);
+	return countLocked(true);
+}
+
+size_t FetchConnectionPool::tlsSessions() const {
+	if (!_mutex) {
+		return 0;
+	}
+	PoolLock lock(_mutex);
+	return countLocked(false);
+}
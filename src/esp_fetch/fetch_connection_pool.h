@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "fetch_allocator.h"
+
+extern "C" {
+#include "esp_http_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+}
+
+// Keeps esp_http_client handles alive between jobs with the same connection key. Two kinds of
+// entries are cached:
+//  - open entries still hold a keep-alive TCP/TLS connection and skip connecting entirely;
+//  - session entries are closed TLS handles whose transport keeps the TLS session ticket, so the
+//    next connect can use an abbreviated handshake.
+// Handles are owned by the pool only while cached; acquire() hands ownership to the caller and
+// release() gives it back. Each handle travels with the TLS server name it was created with
+// (null when esp_http_client uses the URL host), since esp-tls keeps pointing at that string.
+class FetchConnectionPool {
+  public:
+	FetchConnectionPool() = default;
+	~FetchConnectionPool();
+
+	FetchConnectionPool(const FetchConnectionPool &) = delete;
+	FetchConnectionPool &operator=(const FetchConnectionPool &) = delete;
+
+	bool begin(
+	    size_t maxIdleConnections,
+	    uint32_t idleTimeoutMs,
+	    size_t maxTlsSessions,
+	    bool usePSRAMBuffers
+	);
+	void end();
+	bool enabled() const;
+	bool keepsConnections() const;
+	bool keepsTlsSessions() const;
+
+	// Prefers an open connection over a session entry. `connected` reports which one was returned.
+	esp_http_client_handle_t acquire(
+	    const FetchString &key, bool &connected, std::shared_ptr<const FetchString> &serverName
+	);
+	// keepOpen parks a live connection; keepSession parks a closed handle for TLS resumption.
+	void release(
+	    const FetchString &key,
+	    esp_http_client_handle_t client,
+	    bool keepOpen,
+	    bool keepSession,
+	    std::shared_ptr<const FetchString> serverName
+	);
+
+	size_t idleConnections() const;
+	size_t tlsSessions() const;
+
+  private:
+	struct Entry {
+		Entry() = default;
+		Entry(
+		    const FetchString &entryKey,
+		    esp_http_client_handle_t entryClient,
+		    std::shared_ptr<const FetchString> entryServerName,
+		    int64_t now,
+		    bool entryConnected,
+		    bool entrySessionCapable
+		)
+		    : key(entryKey), client(entryClient), serverName(std::move(entryServerName)),
+		      lastUsedUs(now), connected(entryConnected), sessionCapable(entrySessionCapable) {
+		}
+
+		FetchString key;
+		esp_http_client_handle_t client = nullptr;
+		std::shared_ptr<const FetchString> serverName;
+		int64_t lastUsedUs = 0;
+		bool connected = false;
+		bool sessionCapable = false;
+	};
+
+	size_t countLocked(bool connected) const;
+	bool takeOldestLocked(bool connected, Entry &out);
+	size_t takeExpiredLocked(int64_t now, Entry *expired, size_t capacity);
+	void storeSession(
+	    const FetchString &key,
+	    esp_http_client_handle_t client,
+	    std::shared_ptr<const FetchString> serverName
+	);
+	void retire(Entry &entry);
+
+	SemaphoreHandle_t _mutex = nullptr;
+	FetchVector<Entry> _entries;
+	size_t _maxIdleConnections = 0;
+	size_t _maxTlsSessions = 0;
+	int64_t _idleTimeoutUs = 0;
+};
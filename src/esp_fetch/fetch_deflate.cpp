@@ -0,0 +1,307 @@
+#include "esp_fetch/fetch_deflate.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t kDistanceBase[30] = {1,   2,   3,   4,    5,    7,    9,    13,   17,   25,
+                                        33,  49,  65,  97,   129,  193,  257,  385,  513,  769,
+                                        1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+constexpr uint32_t kCrc32Nibbles[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+constexpr uint32_t kAdlerModulus = 65521;
+// Largest byte count whose Adler-32 sums cannot overflow 32 bits before the modulo.
+constexpr size_t kAdlerBlock = 5552;
+
+uint32_t adler32(uint32_t adler, const uint8_t *data, size_t length) {
+	uint32_t a = adler & 0xFFFF;
+	uint32_t b = adler >> 16;
+	while (length > 0) {
+		const size_t block = std::min(length, kAdlerBlock);
+		for (size_t i = 0; i < block; ++i) {
+			a += data[i];
+			b += a;
+		}
+		a %= kAdlerModulus;
+		b %= kAdlerModulus;
+		data += block;
+		length -= block;
+	}
+	return (b << 16) | a;
+}
+
+// Huffman codes are defined MSB-first but deflate packs bits LSB-first.
+uint32_t reverseBits(uint32_t code, unsigned count) {
+	uint32_t reversed = 0;
+	for (unsigned i = 0; i < count; ++i) {
+		reversed = (reversed << 1) | (code & 1);
+		code >>= 1;
+	}
+	return reversed;
+}
+} // namespace
+
+FetchDeflater::FetchDeflater(bool usePSRAMBuffers) : _allocator(usePSRAMBuffers) {
+}
+
+FetchDeflater::~FetchDeflater() {
+	release();
+}
+
+const char *FetchDeflater::contentEncoding(Encoding encoding) {
+	return encoding == Encoding::Gzip ? "gzip" : "deflate";
+}
+
+size_t FetchDeflater::footprint() {
+	return sizeof(FetchDeflater) + kBufferSize + kHashSize * sizeof(uint16_t);
+}
+
+uint32_t FetchDeflater::crc32(uint32_t crc, const uint8_t *data, size_t length) {
+	crc = ~crc;
+	for (size_t i = 0; i < length; ++i) {
+		crc ^= data[i];
+		crc = (crc >> 4) ^ kCrc32Nibbles[crc & 0x0F];
+		crc = (crc >> 4) ^ kCrc32Nibbles[crc & 0x0F];
+	}
+	return ~crc;
+}
+
+bool FetchDeflater::begin(Encoding encoding, Sink sink, void *context) {
+	if (_buffer == nullptr) {
+		_buffer = _allocator.allocate(kBufferSize);
+		_head = reinterpret_cast<uint16_t *>(_allocator.allocate(kHashSize * sizeof(uint16_t)));
+		if (_buffer == nullptr || _head == nullptr) {
+			release();
+			return false;
+		}
+	}
+	std::memset(_head, 0, kHashSize * sizeof(uint16_t));
+	_sink = sink;
+	_context = context;
+	_encoding = encoding;
+	_position = 0;
+	_end = 0;
+	_bitBuffer = 0;
+	_bitCount = 0;
+	_outputLength = 0;
+	_inputBytes = 0;
+	_outputBytes = 0;
+	_failed = false;
+
+	if (encoding == Encoding::Gzip) {
+		// Magic, CM = deflate, no flags, no mtime, XFL 0, OS unknown.
+		static constexpr uint8_t kGzipHeader[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};
+		for (uint8_t value : kGzipHeader) {
+			putByte(value);
+		}
+		_checksum = 0;
+	} else {
+		// zlib: deflate with a 32 KiB window, no dictionary, fastest-level hint.
+		putByte(0x78);
+		putByte(0x01);
+		_checksum = 1;
+	}
+
+	// One fixed-Huffman block carries all data; finish() closes it with an empty final block.
+	putBits(0, 1);
+	putBits(1, 2);
+	return true;
+}
+
+bool FetchDeflater::write(const uint8_t *data, size_t length) {
+	if (_failed || _buffer == nullptr) {
+		return false;
+	}
+	if (!data || length == 0) {
+		return true;
+	}
+	_checksum = _encoding == Encoding::Gzip ? crc32(_checksum, data, length)
+	                                        : adler32(_checksum, data, length);
+	_inputBytes += length;
+
+	while (length > 0 && !_failed) {
+		if (_end == kBufferSize) {
+			slide();
+		}
+		const size_t copied = std::min(length, kBufferSize - _end);
+		std::memcpy(_buffer + _end, data, copied);
+		_end += copied;
+		data += copied;
+		length -= copied;
+		compress(false);
+	}
+	return !_failed;
+}
+
+bool FetchDeflater::finish() {
+	if (_failed || _buffer == nullptr) {
+		return false;
+	}
+	compress(true);
+	putHuffman(0, 7); // end of block (256)
+	putBits(1, 1);    // final, empty fixed-Huffman block
+	putBits(1, 2);
+	putHuffman(0, 7);
+	if (_bitCount > 0) {
+		putBits(0, 8 - _bitCount);
+	}
+
+	if (_encoding == Encoding::Gzip) {
+		const uint32_t size = static_cast<uint32_t>(_inputBytes);
+		for (unsigned shift = 0; shift < 32; shift += 8) {
+			putByte(static_cast<uint8_t>(_checksum >> shift));
+		}
+		for (unsigned shift = 0; shift < 32; shift += 8) {
+			putByte(static_cast<uint8_t>(size >> shift));
+		}
+	} else {
+		for (int shift = 24; shift >= 0; shift -= 8) {
+			putByte(static_cast<uint8_t>(_checksum >> shift));
+		}
+	}
+	return flushOutput();
+}
+
+void FetchDeflater::compress(bool flush) {
+	// Without flush, keep a full match length of lookahead so matches are never cut short.
+	while (!_failed && _position < _end && (flush || _position + kMaxMatch <= _end)) {
+		size_t bestLength = 0;
+		size_t bestDistance = 0;
+		if (_position + kMinMatch <= _end) {
+			const size_t hash = hashAt(_position);
+			const size_t candidate = _head[hash];
+			_head[hash] = static_cast<uint16_t>(_position + 1);
+			if (candidate != 0) {
+				const size_t match = candidate - 1;
+				const size_t distance = _position - match;
+				if (distance <= kWindowSize) {
+					const size_t maxLength = std::min(kMaxMatch, _end - _position);
+					size_t length = 0;
+					while (length < maxLength && _buffer[match + length] == _buffer[_position + length]) {
+						++length;
+					}
+					if (length >= kMinMatch) {
+						bestLength = length;
+						bestDistance = distance;
+					}
+				}
+			}
+		}
+
+		if (bestLength == 0) {
+			emitLiteral(_buffer[_position]);
+			++_position;
+			continue;
+		}
+		emitMatch(bestLength, bestDistance);
+		for (size_t i = 1; i < bestLength; ++i) {
+			insertHash(_position + i);
+		}
+		_position += bestLength;
+	}
+}
+
+void FetchDeflater::slide() {
+	// compress() only stops within kMaxMatch of the end, so at least kWindowSize bytes are done.
+	std::memmove(_buffer, _buffer + kWindowSize, _end - kWindowSize);
+	_position -= kWindowSize;
+	_end -= kWindowSize;
+	for (size_t i = 0; i < kHashSize; ++i) {
+		_head[i] = _head[i] > kWindowSize ? static_cast<uint16_t>(_head[i] - kWindowSize) : 0;
+	}
+}
+
+void FetchDeflater::insertHash(size_t position) {
+	if (position + kMinMatch <= _end) {
+		_head[hashAt(position)] = static_cast<uint16_t>(position + 1);
+	}
+}
+
+size_t FetchDeflater::hashAt(size_t position) const {
+	const uint32_t value = static_cast<uint32_t>(_buffer[position]) |
+	                       (static_cast<uint32_t>(_buffer[position + 1]) << 8) |
+	                       (static_cast<uint32_t>(_buffer[position + 2]) << 16);
+	return (value * 2654435761u) >> (32 - kHashBits);
+}
+
+void FetchDeflater::emitLiteral(uint8_t value) {
+	if (value < 144) {
+		putHuffman(0x30 + value, 8);
+	} else {
+		putHuffman(0x190 + (value - 144), 9);
+	}
+}
+
+void FetchDeflater::emitMatch(size_t length, size_t distance) {
+	size_t lengthIndex = 28;
+	while (kLengthBase[lengthIndex] > length) {
+		--lengthIndex;
+	}
+	const size_t symbol = 257 + lengthIndex;
+	if (symbol < 280) {
+		putHuffman(static_cast<uint32_t>(symbol - 256), 7);
+	} else {
+		putHuffman(static_cast<uint32_t>(0xC0 + (symbol - 280)), 8);
+	}
+	putBits(static_cast<uint32_t>(length - kLengthBase[lengthIndex]), kLengthExtra[lengthIndex]);
+
+	size_t distanceIndex = 29;
+	while (kDistanceBase[distanceIndex] > distance) {
+		--distanceIndex;
+	}
+	putHuffman(static_cast<uint32_t>(distanceIndex), 5);
+	putBits(
+	    static_cast<uint32_t>(distance - kDistanceBase[distanceIndex]),
+	    kDistanceExtra[distanceIndex]
+	);
+}
+
+void FetchDeflater::putBits(uint32_t value, unsigned count) {
+	_bitBuffer |= value << _bitCount;
+	_bitCount += count;
+	while (_bitCount >= 8) {
+		putByte(static_cast<uint8_t>(_bitBuffer));
+		_bitBuffer >>= 8;
+		_bitCount -= 8;
+	}
+}
+
+void FetchDeflater::putHuffman(uint32_t code, unsigned count) {
+	putBits(reverseBits(code, count), count);
+}
+
+void FetchDeflater::putByte(uint8_t value) {
+	_output[_outputLength++] = value;
+	if (_outputLength == kOutputBytes) {
+		flushOutput();
+	}
+}
+
+bool FetchDeflater::flushOutput() {
+	if (_outputLength > 0 && !_failed) {
+		if (!_sink || !_sink(_context, _output, _outputLength)) {
+			_failed = true;
+		}
+		_outputBytes += _outputLength;
+	}
+	_outputLength = 0;
+	return !_failed;
+}
+
+void FetchDeflater::release() {
+	if (_buffer != nullptr) {
+		_allocator.deallocate(_buffer, kBufferSize);
+		_buffer = nullptr;
+	}
+	if (_head != nullptr) {
+		_allocator.deallocate(reinterpret_cast<uint8_t *>(_head), kHashSize * sizeof(uint16_t));
+		_head = nullptr;
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fetch_allocator.h"
+
+// Incremental gzip / zlib encoder for request bodies. It is a small greedy LZ77 matcher over a
+// 4 KiB history with fixed-Huffman deflate blocks: much lighter than a full deflate encoder
+// (about 16 KiB of state) while still shrinking repetitive JSON several times over. Encoded bytes
+// are passed to the sink in pieces of up to kOutputBytes as they are produced.
+class FetchDeflater {
+  public:
+	enum class Encoding : uint8_t { Gzip, Deflate };
+
+	// Returns false to stop encoding; write() and finish() then fail.
+	using Sink = bool (*)(void *context, const uint8_t *data, size_t length);
+
+	static constexpr size_t kWindowSize = 4096;
+	static constexpr size_t kOutputBytes = 256;
+
+	explicit FetchDeflater(bool usePSRAMBuffers);
+	~FetchDeflater();
+
+	FetchDeflater(const FetchDeflater &) = delete;
+	FetchDeflater &operator=(const FetchDeflater &) = delete;
+
+	// Content-Encoding token for an encoding ("gzip" or "deflate").
+	static const char *contentEncoding(Encoding encoding);
+	// Estimated heap held by a deflater once begin() succeeded.
+	static size_t footprint();
+	// CRC-32 (IEEE) as used by the gzip trailer; pass 0 to start.
+	static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t length);
+
+	// Starts a new stream; false when the working buffers cannot be allocated.
+	bool begin(Encoding encoding, Sink sink, void *context);
+	bool write(const uint8_t *data, size_t length);
+	// Encodes any buffered input and writes the stream trailer.
+	bool finish();
+
+	// Unencoded / encoded byte counts since begin().
+	size_t inputBytes() const {
+		return _inputBytes;
+	}
+	size_t outputBytes() const {
+		return _outputBytes;
+	}
+
+  private:
+	static constexpr size_t kBufferSize = 2 * kWindowSize;
+	static constexpr size_t kHashBits = 12;
+	static constexpr size_t kHashSize = static_cast<size_t>(1) << kHashBits;
+	static constexpr size_t kMinMatch = 3;
+	static constexpr size_t kMaxMatch = 258;
+
+	void compress(bool flush);
+	void slide();
+	void insertHash(size_t position);
+	size_t hashAt(size_t position) const;
+	void emitLiteral(uint8_t value);
+	void emitMatch(size_t length, size_t distance);
+	void putBits(uint32_t value, unsigned count);
+	void putHuffman(uint32_t code, unsigned count);
+	void putByte(uint8_t value);
+	bool flushOutput();
+	void release();
+
+	FetchAllocator<uint8_t> _allocator;
+	uint8_t *_buffer = nullptr;
+	uint16_t *_head = nullptr; // position + 1 of the latest occurrence per hash, 0 when empty
+	Sink _sink = nullptr;
+	void *_context = nullptr;
+	Encoding _encoding = Encoding::Gzip;
+	size_t _position = 0; // next byte to encode
+	size_t _end = 0;      // end of buffered input
+	uint32_t _bitBuffer = 0;
+	unsigned _bitCount = 0;
+	uint8_t _output[kOutputBytes];
+	size_t _outputLength = 0;
+	uint32_t _checksum = 0;
+	size_t _inputBytes = 0;
+	size_t _outputBytes = 0;
+	bool _failed = false;
+};
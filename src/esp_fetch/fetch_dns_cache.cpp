@@ -0,0 +1,195 @@
+#include "esp_fetch/fetch_dns_cache.h"
+
+#include <cstring>
+#include <new>
+#include <utility>
+
+extern "C" {
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+}
+
+namespace {
+constexpr const char *TAG = "ESPFetchDns";
+
+class DnsLock {
+  public:
+	explicit DnsLock(SemaphoreHandle_t mutex) : _mutex(mutex) {
+		if (_mutex) {
+			xSemaphoreTake(_mutex, portMAX_DELAY);
+		}
+	}
+	~DnsLock() {
+		if (_mutex) {
+			xSemaphoreGive(_mutex);
+		}
+	}
+
+  private:
+	SemaphoreHandle_t _mutex;
+};
+
+bool resolveIpv4(const char *host, char *address, size_t capacity) {
+	struct addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	struct addrinfo *result = nullptr;
+	if (getaddrinfo(host, nullptr, &hints, &result) != 0 || result == nullptr) {
+		return false;
+	}
+	const auto *ipv4 = reinterpret_cast<const struct sockaddr_in *>(result->ai_addr);
+	const bool formatted = inet_ntop(AF_INET, &ipv4->sin_addr, address, capacity) != nullptr;
+	freeaddrinfo(result);
+	return formatted;
+}
+} // namespace
+
+FetchDnsCache::~FetchDnsCache() {
+	end();
+}
+
+bool FetchDnsCache::begin(
+    size_t maxEntries, uint32_t ttlMs, uint32_t negativeTtlMs, bool usePSRAMBuffers
+) {
+	end();
+	if (maxEntries == 0 || ttlMs == 0) {
+		return true;
+	}
+
+	_entries.reset(new (std::nothrow) Entry[maxEntries]);
+	_mutex = xSemaphoreCreateMutex();
+	if (!_entries || !_mutex) {
+		ESP_LOGE(TAG, "Failed to create DNS cache");
+		end();
+		return false;
+	}
+
+	_usePSRAMBuffers = usePSRAMBuffers;
+	_maxEntries = maxEntries;
+	_used = 0;
+	_ttlUs = static_cast<int64_t>(ttlMs) * 1000;
+	_negativeTtlUs = static_cast<int64_t>(negativeTtlMs) * 1000;
+	return true;
+}
+
+void FetchDnsCache::end() {
+	if (_mutex) {
+		vSemaphoreDelete(_mutex);
+		_mutex = nullptr;
+	}
+	_entries.reset();
+	_maxEntries = 0;
+	_used = 0;
+}
+
+bool FetchDnsCache::enabled() const {
+	return _mutex != nullptr && _maxEntries > 0;
+}
+
+FetchDnsCache::Lookup
+FetchDnsCache::lookup(const FetchString &host, FetchString &address, FetchDnsName &name) {
+	if (!enabled()) {
+		return Lookup::Miss;
+	}
+	DnsLock lock(_mutex);
+	Entry *entry = findLocked(host.c_str());
+	if (entry == nullptr) {
+		return Lookup::Miss;
+	}
+	name = entry->host;
+	const int64_t now = esp_timer_get_time();
+	if (now >= entry->expiresUs) {
+		return Lookup::Miss;
+	}
+	entry->lastUsedUs = now;
+	if (entry->address[0] == '\0') {
+		return Lookup::Failed;
+	}
+	address.assign(entry->address);
+	return Lookup::Address;
+}
+
+FetchDnsCache::Lookup
+FetchDnsCache::resolve(const FetchString &host, FetchString &address, FetchDnsName &name) {
+	if (!enabled()) {
+		return Lookup::Miss;
+	}
+
+	// The lookup itself runs unlocked; concurrent misses for one host may both resolve it.
+	char resolved[sizeof(Entry::address)] = {};
+	const bool ok = resolveIpv4(host.c_str(), resolved, sizeof(resolved));
+	if (!ok) {
+		ESP_LOGD(TAG, "Lookup of %s failed", host.c_str());
+	}
+
+	// Allocated before taking the lock; unused when another miss stored the host meanwhile.
+	const FetchAllocator<char> allocator(_usePSRAMBuffers);
+	FetchDnsName stored = std::allocate_shared<FetchString>(
+	    FetchAllocator<FetchString>(_usePSRAMBuffers), host.data(), host.size(), allocator
+	);
+
+	DnsLock lock(_mutex);
+	const int64_t now = esp_timer_get_time();
+	Entry *entry = findLocked(host.c_str());
+	if (entry == nullptr) {
+		entry = &replaceableLocked(now);
+		entry->host = std::move(stored);
+	}
+	name = entry->host;
+	std::memcpy(entry->address, resolved, sizeof(resolved));
+	entry->expiresUs = now + (ok ? _ttlUs : _negativeTtlUs);
+	entry->lastUsedUs = now;
+	if (!ok) {
+		return Lookup::Failed;
+	}
+	address.assign(resolved);
+	return Lookup::Address;
+}
+
+void FetchDnsCache::expire(const char *host) {
+	if (!enabled() || host == nullptr) {
+		return;
+	}
+	DnsLock lock(_mutex);
+	Entry *entry = findLocked(host);
+	if (entry != nullptr) {
+		entry->expiresUs = 0;
+	}
+}
+
+size_t FetchDnsCache::entries() const {
+	if (!enabled()) {
+		return 0;
+	}
+	DnsLock lock(_mutex);
+	return _used;
+}
+
+FetchDnsCache::Entry *FetchDnsCache::findLocked(const char *host) {
+	for (size_t i = 0; i < _used; ++i) {
+		if (*_entries[i].host == host) {
+			return &_entries[i];
+		}
+	}
+	return nullptr;
+}
+
+FetchDnsCache::Entry &FetchDnsCache::replaceableLocked(int64_t now) {
+	if (_used < _maxEntries) {
+		return _entries[_used++];
+	}
+	Entry *expired = nullptr;
+	Entry *oldest = &_entries[0];
+	for (size_t i = 0; i < _used; ++i) {
+		Entry &entry = _entries[i];
+		if (now >= entry.expiresUs && (expired == nullptr || entry.expiresUs < expired->expiresUs)) {
+			expired = &entry;
+		}
+		if (entry.lastUsedUs < oldest->lastUsedUs) {
+			oldest = &entry;
+		}
+	}
+	return expired != nullptr ? *expired : *oldest;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "fetch_allocator.h"
+
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+}
+
+// Host name handed out with a cached answer. esp-tls keeps the pointer as the TLS server name of
+// a handle, so whoever creates a handle with it holds a reference for the handle's lifetime.
+using FetchDnsName = std::shared_ptr<const FetchString>;
+
+// Fixed table of host name to IPv4 address lookups. Answers are kept for ttlMs and failed
+// lookups for negativeTtlMs; expired entries are refreshed in place. Once the table is full, a
+// new host replaces an expired entry, or else the least recently used one; a replaced name lives
+// on for the handles still holding it. Lookups block: resolve() runs getaddrinfo() on the
+// calling task, as esp_http_client would for a host it resolves itself.
+class FetchDnsCache {
+  public:
+	enum class Lookup : uint8_t {
+		Miss,    // not cached (or expired); resolve() or the live resolver has to answer
+		Address, // `address` holds a dotted-quad IPv4 address
+		Failed,  // the last lookup failed and negativeTtlMs has not passed yet
+	};
+
+	FetchDnsCache() = default;
+	~FetchDnsCache();
+
+	FetchDnsCache(const FetchDnsCache &) = delete;
+	FetchDnsCache &operator=(const FetchDnsCache &) = delete;
+
+	bool begin(size_t maxEntries, uint32_t ttlMs, uint32_t negativeTtlMs, bool usePSRAMBuffers);
+	void end();
+	bool enabled() const;
+
+	// Answers from the table only. `name` is set to the cached copy of host when it has an entry.
+	Lookup lookup(const FetchString &host, FetchString &address, FetchDnsName &name);
+	// Blocking getaddrinfo() on the calling task; records the answer or the failure, replacing
+	// another host's entry when the table is full.
+	Lookup resolve(const FetchString &host, FetchString &address, FetchDnsName &name);
+	// Makes the next lookup of host a miss, e.g. after connecting to its address failed.
+	void expire(const char *host);
+
+	size_t entries() const;
+
+  private:
+	struct Entry {
+		FetchDnsName host;
+		char address[16] = {}; // empty while the entry is negative
+		int64_t expiresUs = 0;
+		int64_t lastUsedUs = 0;
+	};
+
+	// Returns the entry for host or nullptr.
+	Entry *findLocked(const char *host);
+	// A free entry, else the expired one that expired first, else the least recently used one.
+	Entry &replaceableLocked(int64_t now);
+
+	SemaphoreHandle_t _mutex = nullptr;
+	std::unique_ptr<Entry[]> _entries;
+	size_t _maxEntries = 0;
+	size_t _used = 0;
+	int64_t _ttlUs = 0;
+	int64_t _negativeTtlUs = 0;
+	bool _usePSRAMBuffers = false;
+};
@@ -0,0 +1,263 @@
+#include "esp_fetch/fetch_inflate.h"
+
+#include <cctype>
+#include <cstring>
+
+extern "C" {
+#if __has_include("rom/miniz.h")
+#include "rom/miniz.h"
+#elif __has_include("esp32/rom/miniz.h")
+#include "esp32/rom/miniz.h"
+#endif
+}
+
+namespace {
+constexpr uint8_t kGzipHeaderCrc = 0x02;
+constexpr uint8_t kGzipHeaderExtra = 0x04;
+constexpr uint8_t kGzipHeaderName = 0x08;
+constexpr uint8_t kGzipHeaderComment = 0x10;
+constexpr size_t kGzipFixedHeaderBytes = 10;
+
+bool encodingTokenIs(const char *value, size_t length, const char *token) {
+	if (std::strlen(token) != length) {
+		return false;
+	}
+	for (size_t i = 0; i < length; ++i) {
+		if (std::tolower(static_cast<unsigned char>(value[i])) != token[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+} // namespace
+
+FetchInflater::FetchInflater(bool usePSRAMBuffers) : _allocator(usePSRAMBuffers) {
+}
+
+FetchInflater::~FetchInflater() {
+	release();
+}
+
+bool FetchInflater::parseEncoding(const char *value, Encoding &out) {
+	if (!value) {
+		return false;
+	}
+	while (*value == ' ') {
+		++value;
+	}
+	size_t length = std::strlen(value);
+	while (length > 0 && value[length - 1] == ' ') {
+		--length;
+	}
+	if (encodingTokenIs(value, length, "gzip") || encodingTokenIs(value, length, "x-gzip")) {
+		out = Encoding::Gzip;
+		return true;
+	}
+	if (encodingTokenIs(value, length, "deflate")) {
+		out = Encoding::Deflate;
+		return true;
+	}
+	return false;
+}
+
+size_t FetchInflater::footprint() {
+#if ESP_FETCH_HAVE_INFLATE
+	return sizeof(FetchInflater) + sizeof(tinfl_decompressor) + kWindowSize;
+#else
+	return sizeof(FetchInflater);
+#endif
+}
+
+bool FetchInflater::begin(Encoding encoding) {
+#if ESP_FETCH_HAVE_INFLATE
+	if (_window == nullptr) {
+		_window = _allocator.allocate(kWindowSize);
+		_decompressor =
+		    reinterpret_cast<tinfl_decompressor *>(_allocator.allocate(sizeof(tinfl_decompressor)));
+		if (_window == nullptr || _decompressor == nullptr) {
+			release();
+			return false;
+		}
+	}
+	tinfl_init(_decompressor);
+	_encoding = encoding;
+	_windowOffset = 0;
+	_consumed = 0;
+	_flags = 0;
+	_headerStage = HeaderStage::Fixed;
+	_headerFlags = 0;
+	_headerRemaining = encoding == Encoding::Gzip ? kGzipFixedHeaderBytes : 0;
+	_extraLength = 0;
+	_finished = false;
+	_hasMoreOutput = false;
+	return true;
+#else
+	(void)encoding;
+	return false;
+#endif
+}
+
+esp_err_t FetchInflater::inflate(
+    const uint8_t *&input, size_t &inputLength, const uint8_t *&output, size_t &outputLength
+) {
+	output = nullptr;
+	outputLength = 0;
+#if ESP_FETCH_HAVE_INFLATE
+	if (_decompressor == nullptr) {
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	while (!_finished) {
+		if (_headerStage != HeaderStage::Done) {
+			const int header = consumeHeader(input, inputLength);
+			if (header < 0) {
+				return ESP_ERR_INVALID_RESPONSE;
+			}
+			if (header == 0) {
+				return ESP_OK;
+			}
+			continue;
+		}
+
+		size_t inBytes = inputLength;
+		size_t outBytes = kWindowSize - _windowOffset;
+		const tinfl_status status = tinfl_decompress(
+		    _decompressor,
+		    input,
+		    &inBytes,
+		    _window,
+		    _window + _windowOffset,
+		    &outBytes,
+		    _flags | TINFL_FLAG_HAS_MORE_INPUT
+		);
+		input += inBytes;
+		inputLength -= inBytes;
+		_consumed += inBytes;
+		if (status < TINFL_STATUS_DONE) {
+			return ESP_ERR_INVALID_RESPONSE;
+		}
+		_hasMoreOutput = status == TINFL_STATUS_HAS_MORE_OUTPUT;
+		_finished = status == TINFL_STATUS_DONE;
+
+		if (outBytes > 0) {
+			output = _window + _windowOffset;
+			outputLength = outBytes;
+			// The window doubles as the LZ dictionary, so it wraps instead of being drained.
+			_windowOffset = (_windowOffset + outBytes) & (kWindowSize - 1);
+			return ESP_OK;
+		}
+		if (inputLength == 0 || inBytes == 0) {
+			return ESP_OK;
+		}
+	}
+
+	// Anything after the deflate stream is the gzip/zlib trailer; its checksum is not verified.
+	input += inputLength;
+	_consumed += inputLength;
+	inputLength = 0;
+	return ESP_OK;
+#else
+	(void)input;
+	(void)inputLength;
+	return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+int FetchInflater::consumeHeader(const uint8_t *&input, size_t &inputLength) {
+	if (_encoding == Encoding::Deflate) {
+		// "deflate" is zlib-wrapped per RFC 9110, but some servers send raw deflate. A zlib CMF byte
+		// (method 8, window <= 32 KiB) would be a stored block with non-zero padding in raw deflate.
+		if (inputLength == 0) {
+			return 0;
+		}
+#if ESP_FETCH_HAVE_INFLATE
+		if ((input[0] & 0x0F) == 8 && (input[0] >> 4) <= 7) {
+			_flags |= TINFL_FLAG_PARSE_ZLIB_HEADER;
+		}
+#endif
+		_headerStage = HeaderStage::Done;
+		return 1;
+	}
+
+	while (_headerStage != HeaderStage::Done) {
+		if (_headerStage == HeaderStage::Crc && _headerRemaining == 0) {
+			_headerStage = HeaderStage::Done;
+			break;
+		}
+		if (inputLength == 0) {
+			return 0;
+		}
+		const uint8_t value = *input++;
+		--inputLength;
+		++_consumed;
+
+		switch (_headerStage) {
+		case HeaderStage::Fixed: {
+			const size_t index = kGzipFixedHeaderBytes - _headerRemaining;
+			if ((index == 0 && value != 0x1F) || (index == 1 && value != 0x8B) ||
+			    (index == 2 && value != 8)) {
+				return -1;
+			}
+			if (index == 3) {
+				_headerFlags = value;
+			}
+			if (--_headerRemaining == 0) {
+				_headerStage = HeaderStage::ExtraLength;
+				_headerRemaining = (_headerFlags & kGzipHeaderExtra) ? 2 : 0;
+				if (_headerRemaining == 0) {
+					_headerStage = HeaderStage::Name;
+				}
+			}
+			break;
+		}
+		case HeaderStage::ExtraLength:
+			_extraLength |= static_cast<size_t>(value) << (_headerRemaining == 2 ? 0 : 8);
+			if (--_headerRemaining == 0) {
+				_headerStage = HeaderStage::Extra;
+				_headerRemaining = _extraLength;
+			}
+			break;
+		case HeaderStage::Extra:
+			--_headerRemaining;
+			break;
+		case HeaderStage::Name:
+		case HeaderStage::Comment:
+		case HeaderStage::Crc:
+			if (_headerStage == HeaderStage::Crc) {
+				--_headerRemaining;
+			} else if (value == 0) {
+				_headerFlags &= _headerStage == HeaderStage::Name ? ~kGzipHeaderName
+				                                                  : ~kGzipHeaderComment;
+			}
+			break;
+		case HeaderStage::Done:
+			break;
+		}
+
+		// Skip the optional sections that are absent or fully consumed.
+		if (_headerStage == HeaderStage::Extra && _headerRemaining == 0) {
+			_headerStage = HeaderStage::Name;
+		}
+		if (_headerStage == HeaderStage::Name && !(_headerFlags & kGzipHeaderName)) {
+			_headerStage = HeaderStage::Comment;
+		}
+		if (_headerStage == HeaderStage::Comment && !(_headerFlags & kGzipHeaderComment)) {
+			_headerStage = HeaderStage::Crc;
+			_headerRemaining = (_headerFlags & kGzipHeaderCrc) ? 2 : 0;
+		}
+	}
+	return 1;
+}
+
+void FetchInflater::release() {
+#if ESP_FETCH_HAVE_INFLATE
+	if (_decompressor != nullptr) {
+		_allocator.deallocate(reinterpret_cast<uint8_t *>(_decompressor), sizeof(tinfl_decompressor));
+		_decompressor = nullptr;
+	}
+#endif
+	if (_window != nullptr) {
+		_allocator.deallocate(_window, kWindowSize);
+		_window = nullptr;
+	}
+}
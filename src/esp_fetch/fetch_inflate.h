@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fetch_allocator.h"
+
+extern "C" {
+#include "esp_err.h"
+}
+
+// The tinfl inflater ships in the ESP32-family ROMs; builds without its header decode nothing and
+// never advertise compression.
+#if __has_include("rom/miniz.h") || __has_include("esp32/rom/miniz.h")
+#define ESP_FETCH_HAVE_INFLATE 1
+#else
+#define ESP_FETCH_HAVE_INFLATE 0
+#endif
+
+struct tinfl_decompressor_tag;
+
+// Incremental gzip / zlib / raw-deflate decoder for response bodies. Deflate back-references reach
+// up to 32 KiB, so output is produced into a 32 KiB window and handed out in place: decoded bytes
+// are never copied into an intermediate buffer. The window and decoder state are allocated on the
+// first begin() with the configured buffer placement.
+class FetchInflater {
+  public:
+	enum class Encoding : uint8_t { Gzip, Deflate };
+
+	static constexpr size_t kWindowSize = 32768;
+	static constexpr const char *kAcceptEncoding = "gzip, deflate";
+
+	explicit FetchInflater(bool usePSRAMBuffers);
+	~FetchInflater();
+
+	FetchInflater(const FetchInflater &) = delete;
+	FetchInflater &operator=(const FetchInflater &) = delete;
+
+	// Maps a Content-Encoding value to a supported encoding; false for identity or unknown ones.
+	static bool parseEncoding(const char *value, Encoding &out);
+	// Estimated heap held by an inflater once begin() succeeded.
+	static size_t footprint();
+
+	// Starts a new body; false when the ROM inflater is unavailable or allocation failed.
+	bool begin(Encoding encoding);
+
+	// Consumes input until some decoded output is available, the input is used up or the end of
+	// the compressed stream is reached. `output` points into the window and stays valid until the
+	// next call. Returns ESP_ERR_INVALID_RESPONSE for corrupt data.
+	esp_err_t inflate(
+	    const uint8_t *&input, size_t &inputLength, const uint8_t *&output, size_t &outputLength
+	);
+
+	// Decodes a whole input buffer, passing each decoded span to `sink(const uint8_t *, size_t)`.
+	// A sink returning false stops decoding with ESP_ERR_INVALID_STATE.
+	template <typename Sink> esp_err_t feed(const uint8_t *input, size_t length, Sink &&sink) {
+		while (!_finished && (length > 0 || _hasMoreOutput)) {
+			const uint8_t *output = nullptr;
+			size_t outputLength = 0;
+			const esp_err_t err = inflate(input, length, output, outputLength);
+			if (err != ESP_OK) {
+				return err;
+			}
+			if (outputLength == 0) {
+				break;
+			}
+			if (!sink(output, outputLength)) {
+				return ESP_ERR_INVALID_STATE;
+			}
+		}
+		return ESP_OK;
+	}
+
+	// True once the end of the compressed stream was decoded.
+	bool finished() const {
+		return _finished;
+	}
+	// True while decoded output is pending even though all input was consumed.
+	bool hasMoreOutput() const {
+		return _hasMoreOutput;
+	}
+	// Compressed bytes consumed since begin().
+	size_t consumedBytes() const {
+		return _consumed;
+	}
+
+  private:
+	enum class HeaderStage : uint8_t { Fixed, ExtraLength, Extra, Name, Comment, Crc, Done };
+
+	// Returns 1 once the header is consumed, 0 when more input is needed, -1 for a bad header.
+	int consumeHeader(const uint8_t *&input, size_t &inputLength);
+	void release();
+
+	FetchAllocator<uint8_t> _allocator;
+	uint8_t *_window = nullptr;
+	tinfl_decompressor_tag *_decompressor = nullptr;
+	size_t _windowOffset = 0;
+	size_t _consumed = 0;
+	uint32_t _flags = 0;
+	Encoding _encoding = Encoding::Gzip;
+	HeaderStage _headerStage = HeaderStage::Done;
+	uint8_t _headerFlags = 0;
+	size_t _headerRemaining = 0;
+	size_t _extraLength = 0;
+	bool _finished = false;
+	bool _hasMoreOutput = false;
+};
@@ -0,0 +1,254 @@
+#include "esp_fetch/fetch_json_stream.h"
+
+namespace {
+bool isJsonWhitespace(char c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+} // namespace
+
+FetchJsonArrayScanner::FetchJsonArrayScanner(
+    const char *path, size_t maxElementBytes, bool usePSRAMBuffers
+)
+    : _path(FetchAllocator<char>(usePSRAMBuffers)), _element(FetchAllocator<char>(usePSRAMBuffers)),
+      _maxElementBytes(maxElementBytes) {
+	if (path && *path) {
+		_path.assign(path);
+		_segmentCount = 1;
+		for (const char c : _path) {
+			if (c == '.') {
+				++_segmentCount;
+			}
+		}
+		selectSegment(0);
+	}
+}
+
+esp_err_t FetchJsonArrayScanner::finish() const {
+	if (_error != ESP_OK) {
+		return _error;
+	}
+	if (_phase == Phase::Done) {
+		return ESP_OK;
+	}
+	return _phase == Phase::Seek ? ESP_ERR_NOT_FOUND : ESP_ERR_INVALID_RESPONSE;
+}
+
+bool FetchJsonArrayScanner::step(char c) {
+	if (_phase == Phase::Array) {
+		return scanElement(c);
+	}
+	seek(c);
+	return false;
+}
+
+void FetchJsonArrayScanner::seek(char c) {
+	// Walks the document down the path, skipping every value that is not on it.
+	if (_inString) {
+		if (_escape) {
+			_escape = false;
+		} else if (c == '\\') {
+			_escape = true;
+		} else if (c == '"') {
+			_inString = false;
+			if (_readingKey) {
+				_readingKey = false;
+				_keyMatched = _keyMatches && _keyLength == _segmentLength;
+			}
+			return;
+		}
+		if (_readingKey) {
+			if (_keyLength >= _segmentLength || _path[_segmentStart + _keyLength] != c) {
+				_keyMatches = false;
+			}
+			++_keyLength;
+		}
+		return;
+	}
+	if (isJsonWhitespace(c)) {
+		return;
+	}
+	if (_depth == 0) {
+		if (_segmentCount == 0 && c == '[') {
+			_depth = 1;
+			_arrayDepth = 1;
+			_phase = Phase::Array;
+		} else if (_segmentCount > 0 && c == '{') {
+			_depth = 1;
+			_expectKey = true;
+		} else {
+			fail(ESP_ERR_INVALID_RESPONSE);
+		}
+		return;
+	}
+
+	const bool onPath = _depth == _matched + 1;
+	switch (c) {
+	case '"':
+		_inString = true;
+		if (onPath && _expectKey) {
+			_expectKey = false;
+			_readingKey = true;
+			_keyMatches = true;
+			_keyLength = 0;
+		} else if (onPath) {
+			_valueNext = false;
+		}
+		return;
+	case ':':
+		if (onPath) {
+			_valueNext = true;
+		}
+		return;
+	case ',':
+		if (onPath) {
+			_expectKey = true;
+			_keyMatched = false;
+			_valueNext = false;
+		}
+		return;
+	case '{':
+	case '[':
+		if (onPath && _valueNext && _keyMatched) {
+			const bool last = _matched + 1 == _segmentCount;
+			if (last != (c == '[')) {
+				// The path names a value of the wrong kind.
+				fail(ESP_ERR_INVALID_RESPONSE);
+				return;
+			}
+			++_depth;
+			_valueNext = false;
+			if (last) {
+				_arrayDepth = _depth;
+				_phase = Phase::Array;
+			} else {
+				selectSegment(++_matched);
+				_expectKey = true;
+				_keyMatched = false;
+			}
+			return;
+		}
+		if (onPath) {
+			_valueNext = false;
+		}
+		++_depth;
+		return;
+	case '}':
+	case ']':
+		if (onPath) {
+			// A path object closed without holding the rest of the path.
+			fail(ESP_ERR_NOT_FOUND);
+			return;
+		}
+		--_depth;
+		return;
+	default:
+		if (onPath) {
+			_valueNext = false;
+		}
+		return;
+	}
+}
+
+bool FetchJsonArrayScanner::scanElement(char c) {
+	if (_kind == ElementKind::None) {
+		if (isJsonWhitespace(c) || c == ',') {
+			return false;
+		}
+		if (c == ']') {
+			_phase = Phase::Done;
+			return false;
+		}
+		if (c == '}' || c == ':') {
+			fail(ESP_ERR_INVALID_RESPONSE);
+			return false;
+		}
+		_element.clear();
+		if (c == '{' || c == '[') {
+			_kind = ElementKind::Container;
+			++_depth;
+		} else if (c == '"') {
+			_kind = ElementKind::String;
+			_inString = true;
+		} else {
+			_kind = ElementKind::Scalar;
+		}
+		append(c);
+		return false;
+	}
+
+	if (_inString) {
+		append(c);
+		if (_escape) {
+			_escape = false;
+		} else if (c == '\\') {
+			_escape = true;
+		} else if (c == '"') {
+			_inString = false;
+			if (_kind == ElementKind::String) {
+				_kind = ElementKind::None;
+				++_elements;
+				return _error == ESP_OK;
+			}
+		}
+		return false;
+	}
+	if (_kind == ElementKind::Scalar) {
+		if (isJsonWhitespace(c) || c == ',' || c == ']' || c == '}') {
+			return endScalar(c);
+		}
+		append(c);
+		return false;
+	}
+
+	append(c);
+	if (c == '"') {
+		_inString = true;
+	} else if (c == '{' || c == '[') {
+		++_depth;
+	} else if (c == '}' || c == ']') {
+		if (--_depth == _arrayDepth) {
+			_kind = ElementKind::None;
+			++_elements;
+			return _error == ESP_OK;
+		}
+	}
+	return false;
+}
+
+bool FetchJsonArrayScanner::endScalar(char c) {
+	// Numbers and literals end at the byte after them, which may also close the array.
+	_kind = ElementKind::None;
+	if (c == '}') {
+		fail(ESP_ERR_INVALID_RESPONSE);
+		return false;
+	}
+	if (c == ']') {
+		_phase = Phase::Done;
+	}
+	++_elements;
+	return true;
+}
+
+void FetchJsonArrayScanner::append(char c) {
+	if (_maxElementBytes > 0 && _element.size() >= _maxElementBytes) {
+		fail(ESP_ERR_INVALID_SIZE);
+		return;
+	}
+	_element.push_back(c);
+}
+
+void FetchJsonArrayScanner::selectSegment(size_t index) {
+	size_t start = 0;
+	for (size_t i = 0; i < index; ++i) {
+		start = _path.find('.', start) + 1;
+	}
+	const size_t end = _path.find('.', start);
+	_segmentStart = start;
+	_segmentLength = (end == FetchString::npos ? _path.size() : end) - start;
+}
+
+void FetchJsonArrayScanner::fail(esp_err_t error) {
+	if (_error == ESP_OK) {
+		_error = error;
+	}
+}
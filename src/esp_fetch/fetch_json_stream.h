@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fetch_allocator.h"
+
+extern "C" {
+#include "esp_err.h"
+}
+
+// Splits one array of a JSON body into its elements while the body streams in, without building
+// the rest of the document. `path` names the array by object keys from the root, separated by
+// dots ("data.items"); an empty path means the body itself is the array. Keys are compared as
+// written on the wire, escapes included. Only the element being read is kept, as raw JSON text of
+// at most maxElementBytes (0 = unbounded), so memory does not grow with the response.
+class FetchJsonArrayScanner {
+  public:
+	FetchJsonArrayScanner(const char *path, size_t maxElementBytes, bool usePSRAMBuffers);
+
+	// Scans `length` body bytes, passing each complete element to `sink(const char *, size_t)`.
+	// Returns ESP_ERR_INVALID_SIZE for an element over the limit, ESP_ERR_INVALID_RESPONSE when
+	// the body is not JSON of the expected shape, ESP_ERR_NOT_FOUND when the object that should
+	// hold the array closed without it, and ESP_ERR_INVALID_STATE once a sink returned false.
+	// Bytes after the array are ignored.
+	template <typename Sink> esp_err_t feed(const char *data, size_t length, Sink &&sink) {
+		for (size_t i = 0; i < length && _error == ESP_OK && _phase != Phase::Done; ++i) {
+			if (step(data[i]) && _error == ESP_OK && !sink(_element.data(), _element.size())) {
+				_error = ESP_ERR_INVALID_STATE;
+			}
+		}
+		return _error;
+	}
+
+	// Call once the body ended: ESP_OK when the array was closed, otherwise the error of the
+	// truncated body (ESP_ERR_NOT_FOUND when the array never started).
+	esp_err_t finish() const;
+
+	esp_err_t error() const {
+		return _error;
+	}
+	// True once the array was closed.
+	bool finished() const {
+		return _phase == Phase::Done;
+	}
+	// Elements handed to a sink so far.
+	size_t elements() const {
+		return _elements;
+	}
+
+  private:
+	enum class Phase : uint8_t { Seek, Array, Done };
+	enum class ElementKind : uint8_t { None, Scalar, String, Container };
+
+	// Returns true when `c` completed an element.
+	bool step(char c);
+	void seek(char c);
+	bool scanElement(char c);
+	bool endScalar(char c);
+	void append(char c);
+	void selectSegment(size_t index);
+	void fail(esp_err_t error);
+
+	FetchString _path;
+	FetchString _element;
+	size_t _maxElementBytes;
+	size_t _segmentCount = 0;
+	size_t _segmentStart = 0;
+	size_t _segmentLength = 0;
+	// Containers open around the current byte, and how many path objects were entered.
+	size_t _depth = 0;
+	size_t _matched = 0;
+	size_t _arrayDepth = 0;
+	size_t _keyLength = 0;
+	size_t _elements = 0;
+	esp_err_t _error = ESP_OK;
+	Phase _phase = Phase::Seek;
+	ElementKind _kind = ElementKind::None;
+	bool _inString = false;
+	bool _escape = false;
+	// Key tracking inside the path object that is currently open.
+	bool _expectKey = false;
+	bool _readingKey = false;
+	bool _keyMatches = false;
+	bool _keyMatched = false;
+	bool _valueNext = false;
+};
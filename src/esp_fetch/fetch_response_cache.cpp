@@ -0,0 +1,220 @@
+#include "esp_fetch/fetch_response_cache.h"
+
+#include <algorithm>
+#include <utility>
+
+extern "C" {
+#include "esp_log.h"
+#include "esp_timer.h"
+}
+
+namespace {
+constexpr const char *TAG = "ESPFetchCache";
+
+class CacheLock {
+  public:
+	explicit CacheLock(SemaphoreHandle_t mutex) : _mutex(mutex) {
+		if (_mutex) {
+			xSemaphoreTake(_mutex, portMAX_DELAY);
+		}
+	}
+	~CacheLock() {
+		if (_mutex) {
+			xSemaphoreGive(_mutex);
+		}
+	}
+
+  private:
+	SemaphoreHandle_t _mutex;
+};
+} // namespace
+
+FetchResponseCache::~FetchResponseCache() {
+	end();
+}
+
+bool FetchResponseCache::begin(size_t maxEntries, size_t maxBytes, bool usePSRAMBuffers) {
+	end();
+	if (maxEntries == 0 || maxBytes == 0) {
+		return true;
+	}
+
+	_mutex = xSemaphoreCreateMutex();
+	if (!_mutex) {
+		ESP_LOGE(TAG, "Failed to create response cache mutex");
+		return false;
+	}
+
+	_stringAllocator = FetchAllocator<char>(usePSRAMBuffers);
+	_entries = FetchVector<Entry>(FetchAllocator<Entry>(usePSRAMBuffers));
+	_entries.reserve(maxEntries);
+	_maxEntries = maxEntries;
+	_maxBytes = maxBytes;
+	_bytes = 0;
+	return true;
+}
+
+void FetchResponseCache::end() {
+	if (!_mutex) {
+		return;
+	}
+
+	{
+		CacheLock lock(_mutex);
+		_entries.clear();
+		_entries.shrink_to_fit();
+		_maxEntries = 0;
+		_maxBytes = 0;
+		_bytes = 0;
+	}
+
+	vSemaphoreDelete(_mutex);
+	_mutex = nullptr;
+}
+
+bool FetchResponseCache::enabled() const {
+	return _mutex != nullptr && _maxEntries > 0;
+}
+
+bool FetchResponseCache::loadFresh(const FetchString &key, FetchString &body) {
+	if (!enabled()) {
+		return false;
+	}
+	CacheLock lock(_mutex);
+	const size_t index = touchLocked(key);
+	if (index == npos) {
+		return false;
+	}
+	const Entry &entry = _entries[index];
+	if (entry.expiresUs == 0 || esp_timer_get_time() >= entry.expiresUs) {
+		return false;
+	}
+	body.assign(entry.body.data(), entry.body.size());
+	return true;
+}
+
+bool FetchResponseCache::validators(
+    const FetchString &key, FetchString &etag, FetchString &lastModified
+) {
+	if (!enabled()) {
+		return false;
+	}
+	CacheLock lock(_mutex);
+	for (const auto &entry : _entries) {
+		if (entry.key == key) {
+			etag.assign(entry.etag.data(), entry.etag.size());
+			lastModified.assign(entry.lastModified.data(), entry.lastModified.size());
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FetchResponseCache::revalidate(const FetchString &key, int64_t maxAgeSec, FetchString &body) {
+	if (!enabled()) {
+		return false;
+	}
+	CacheLock lock(_mutex);
+	const size_t index = touchLocked(key);
+	if (index == npos) {
+		return false;
+	}
+	Entry &entry = _entries[index];
+	entry.expiresUs = expiryFor(maxAgeSec);
+	body.assign(entry.body.data(), entry.body.size());
+	return true;
+}
+
+void FetchResponseCache::store(
+    const FetchString &key,
+    const FetchString &etag,
+    const FetchString &lastModified,
+    int64_t maxAgeSec,
+    const FetchString &body
+) {
+	if (!enabled()) {
+		return;
+	}
+
+	const size_t footprint = key.size() + etag.size() + lastModified.size() + body.size();
+	CacheLock lock(_mutex);
+	const size_t existing = touchLocked(key);
+	if (existing != npos) {
+		eraseLocked(existing);
+	}
+	if (footprint > _maxBytes) {
+		ESP_LOGD(TAG, "Not caching %s: %u bytes exceed the cache", key.c_str(), (unsigned)footprint);
+		return;
+	}
+
+	// Front of the vector is the least recently used entry.
+	while (!_entries.empty() &&
+	       (_entries.size() >= _maxEntries || _bytes + footprint > _maxBytes)) {
+		eraseLocked(0);
+	}
+
+	Entry entry(_stringAllocator);
+	entry.key.assign(key.data(), key.size());
+	entry.etag.assign(etag.data(), etag.size());
+	entry.lastModified.assign(lastModified.data(), lastModified.size());
+	entry.body.assign(body.data(), body.size());
+	entry.expiresUs = expiryFor(maxAgeSec);
+	_entries.push_back(std::move(entry));
+	_bytes += footprint;
+}
+
+void FetchResponseCache::erase(const FetchString &key) {
+	if (!enabled()) {
+		return;
+	}
+	CacheLock lock(_mutex);
+	const size_t index = touchLocked(key);
+	if (index != npos) {
+		eraseLocked(index);
+	}
+}
+
+size_t FetchResponseCache::entries() const {
+	if (!enabled()) {
+		return 0;
+	}
+	CacheLock lock(_mutex);
+	return _entries.size();
+}
+
+size_t FetchResponseCache::bytes() const {
+	if (!enabled()) {
+		return 0;
+	}
+	CacheLock lock(_mutex);
+	return _bytes;
+}
+
+size_t FetchResponseCache::touchLocked(const FetchString &key) {
+	for (size_t i = 0; i < _entries.size(); ++i) {
+		if (_entries[i].key == key) {
+			const size_t last = _entries.size() - 1;
+			if (i != last) {
+				std::rotate(
+				    _entries.begin() + static_cast<std::ptrdiff_t>(i),
+				    _entries.begin() + static_cast<std::ptrdiff_t>(i + 1),
+				    _entries.end()
+				);
+			}
+			return last;
+		}
+	}
+	return npos;
+}
+
+void FetchResponseCache::eraseLocked(size_t index) {
+	_bytes -= _entries[index].footprint();
+	_entries.erase(_entries.begin() + static_cast<std::ptrdiff_t>(index));
+}
+
+int64_t FetchResponseCache::expiryFor(int64_t maxAgeSec) {
+	if (maxAgeSec <= 0) {
+		return 0;
+	}
+	return esp_timer_get_time() + maxAgeSec * 1000000LL;
+}
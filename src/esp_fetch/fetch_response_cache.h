@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fetch_allocator.h"
+
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+}
+
+// Bounded LRU cache of GET response bodies keyed by normalized URL. Entries keep the ETag and
+// Last-Modified validators used for conditional requests and an optional max-age expiry during
+// which the body is served without touching the network. All strings, including the bodies, use
+// the placement chosen in begin().
+class FetchResponseCache {
+  public:
+	FetchResponseCache() = default;
+	~FetchResponseCache();
+
+	FetchResponseCache(const FetchResponseCache &) = delete;
+	FetchResponseCache &operator=(const FetchResponseCache &) = delete;
+
+	bool begin(size_t maxEntries, size_t maxBytes, bool usePSRAMBuffers);
+	void end();
+	bool enabled() const;
+
+	// Copies the body of an entry whose max-age has not expired yet.
+	bool loadFresh(const FetchString &key, FetchString &body);
+	// Copies the stored validators; false when the URL is not cached.
+	bool validators(const FetchString &key, FetchString &etag, FetchString &lastModified);
+	// Handles a 304: copies the cached body and restarts its max-age (maxAgeSec < 0 keeps the
+	// entry stale so the next request revalidates again).
+	bool revalidate(const FetchString &key, int64_t maxAgeSec, FetchString &body);
+	// Inserts or replaces an entry, evicting least recently used ones to honour both bounds.
+	// Bodies larger than maxBytes are not cached.
+	void store(
+	    const FetchString &key,
+	    const FetchString &etag,
+	    const FetchString &lastModified,
+	    int64_t maxAgeSec,
+	    const FetchString &body
+	);
+	void erase(const FetchString &key);
+
+	size_t entries() const;
+	size_t bytes() const;
+
+  private:
+	struct Entry {
+		explicit Entry(const FetchAllocator<char> &allocator)
+		    : key(allocator), etag(allocator), lastModified(allocator), body(allocator) {
+		}
+
+		size_t footprint() const {
+			return key.size() + etag.size() + lastModified.size() + body.size();
+		}
+
+		FetchString key;
+		FetchString etag;
+		FetchString lastModified;
+		FetchString body;
+		int64_t expiresUs = 0; // 0 = stale, always revalidate
+	};
+
+	// Returns the entry index or npos; a hit is moved to the back (most recently used).
+	size_t touchLocked(const FetchString &key);
+	void eraseLocked(size_t index);
+	static int64_t expiryFor(int64_t maxAgeSec);
+
+	static constexpr size_t npos = static_cast<size_t>(-1);
+
+	SemaphoreHandle_t _mutex = nullptr;
+	FetchAllocator<char> _stringAllocator;
+	FetchVector<Entry> _entries;
+	size_t _maxEntries = 0;
+	size_t _maxBytes = 0;
+	size_t _bytes = 0;
+};
@@ -0,0 +1,165 @@
+#include "esp_fetch/fetch_stats.h"
+
+void FetchStatsRecorder::reset() {
+	_requests.store(0, std::memory_order_relaxed);
+	_failedRequests.store(0, std::memory_order_relaxed);
+	_coalescedRequests.store(0, std::memory_order_relaxed);
+	_retries.store(0, std::memory_order_relaxed);
+	_circuitRejections.store(0, std::memory_order_relaxed);
+	_dnsCacheHits.store(0, std::memory_order_relaxed);
+	_dnsLookups.store(0, std::memory_order_relaxed);
+	for (auto &slot : _errors) {
+		slot.count.store(0, std::memory_order_relaxed);
+		slot.error.store(ESP_OK, std::memory_order_relaxed);
+	}
+	_otherErrors.store(0, std::memory_order_relaxed);
+	_bytesIn.store(0, std::memory_order_relaxed);
+	_bytesOut.store(0, std::memory_order_relaxed);
+	_slotWaitUs.store(0, std::memory_order_relaxed);
+	_maxSlotWaitUs.store(0, std::memory_order_relaxed);
+	_peakConcurrentJobs.store(0, std::memory_order_relaxed);
+	_peakJobHeapBytes.store(
+	    _jobHeapBytes.load(std::memory_order_relaxed),
+	    std::memory_order_relaxed
+	);
+	_memoryDeferrals.store(0, std::memory_order_relaxed);
+	_peakArenaBytes.store(0, std::memory_order_relaxed);
+	_arenaOverflows.store(0, std::memory_order_relaxed);
+	for (auto &lane : _laneMinFreeStack) {
+		lane.store(0, std::memory_order_relaxed);
+	}
+}
+
+FetchStats FetchStatsRecorder::snapshot() const {
+	FetchStats stats;
+	stats.requests = _requests.load(std::memory_order_relaxed);
+	stats.failedRequests = _failedRequests.load(std::memory_order_relaxed);
+	stats.coalescedRequests = _coalescedRequests.load(std::memory_order_relaxed);
+	stats.retries = _retries.load(std::memory_order_relaxed);
+	stats.circuitRejections = _circuitRejections.load(std::memory_order_relaxed);
+	stats.dnsCacheHits = _dnsCacheHits.load(std::memory_order_relaxed);
+	stats.dnsLookups = _dnsLookups.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < FetchStats::kErrorSlots; ++i) {
+		stats.errors[i].error = _errors[i].error.load(std::memory_order_relaxed);
+		stats.errors[i].count = _errors[i].count.load(std::memory_order_relaxed);
+	}
+	stats.otherErrors = _otherErrors.load(std::memory_order_relaxed);
+	stats.bytesIn = _bytesIn.load(std::memory_order_relaxed);
+	stats.bytesOut = _bytesOut.load(std::memory_order_relaxed);
+	stats.slotWaitUs = _slotWaitUs.load(std::memory_order_relaxed);
+	stats.maxSlotWaitUs = _maxSlotWaitUs.load(std::memory_order_relaxed);
+	stats.peakConcurrentJobs = _peakConcurrentJobs.load(std::memory_order_relaxed);
+	stats.peakJobHeapBytes = _peakJobHeapBytes.load(std::memory_order_relaxed);
+	stats.memoryDeferrals = _memoryDeferrals.load(std::memory_order_relaxed);
+	stats.peakArenaBytes = _peakArenaBytes.load(std::memory_order_relaxed);
+	stats.arenaOverflows = _arenaOverflows.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < FetchStats::kLaneSlots; ++i) {
+		stats.laneMinFreeStackBytes[i] = _laneMinFreeStack[i].load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+void FetchStatsRecorder::recordCompletion(
+    esp_err_t error, uint64_t bytesIn, uint64_t bytesOut, int64_t slotWaitUs
+) {
+	_requests.fetch_add(1, std::memory_order_relaxed);
+	if (error != ESP_OK) {
+		_failedRequests.fetch_add(1, std::memory_order_relaxed);
+		recordError(error);
+	}
+	_bytesIn.fetch_add(bytesIn, std::memory_order_relaxed);
+	_bytesOut.fetch_add(bytesOut, std::memory_order_relaxed);
+
+	if (slotWaitUs > 0) {
+		const uint32_t waitUs =
+		    slotWaitUs > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(slotWaitUs);
+		_slotWaitUs.fetch_add(static_cast<uint64_t>(slotWaitUs), std::memory_order_relaxed);
+		uint32_t previous = _maxSlotWaitUs.load(std::memory_order_relaxed);
+		while (previous < waitUs &&
+		       !_maxSlotWaitUs.compare_exchange_weak(previous, waitUs, std::memory_order_relaxed)) {
+		}
+	}
+}
+
+void FetchStatsRecorder::recordCoalesced() {
+	_coalescedRequests.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FetchStatsRecorder::recordRetry() {
+	_retries.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FetchStatsRecorder::recordCircuitRejection() {
+	_circuitRejections.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FetchStatsRecorder::recordDnsHit() {
+	_dnsCacheHits.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FetchStatsRecorder::recordDnsLookup() {
+	_dnsLookups.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FetchStatsRecorder::recordConcurrentJobs(size_t runningJobs) {
+	raiseTo(_peakConcurrentJobs, runningJobs);
+}
+
+void FetchStatsRecorder::addJobHeap(size_t bytes) {
+	const size_t current = _jobHeapBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	raiseTo(_peakJobHeapBytes, current);
+}
+
+void FetchStatsRecorder::releaseJobHeap(size_t bytes) {
+	_jobHeapBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void FetchStatsRecorder::recordMemoryDeferral() {
+	_memoryDeferrals.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FetchStatsRecorder::recordArenaUsage(size_t highWaterBytes, uint32_t overflows) {
+	raiseTo(_peakArenaBytes, highWaterBytes);
+	if (overflows > 0) {
+		_arenaOverflows.fetch_add(overflows, std::memory_order_relaxed);
+	}
+}
+
+void FetchStatsRecorder::recordStackHighWater(size_t lane, size_t freeBytes) {
+	if (lane >= FetchStats::kLaneSlots || freeBytes == 0) {
+		return;
+	}
+	// 0 means "not measured yet", so it is replaced by any sample.
+	std::atomic<size_t> &least = _laneMinFreeStack[lane];
+	size_t previous = least.load(std::memory_order_relaxed);
+	while ((previous == 0 || freeBytes < previous) &&
+	       !least.compare_exchange_weak(previous, freeBytes, std::memory_order_relaxed)) {
+	}
+}
+
+void FetchStatsRecorder::raiseTo(std::atomic<size_t> &peak, size_t value) {
+	size_t previous = peak.load(std::memory_order_relaxed);
+	while (previous < value &&
+	       !peak.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {
+	}
+}
+
+void FetchStatsRecorder::recordError(esp_err_t error) {
+	for (auto &slot : _errors) {
+		int32_t current = slot.error.load(std::memory_order_relaxed);
+		if (current == ESP_OK) {
+			// Claim the free slot; if another task got there first, re-check what it stored.
+			if (!slot.error.compare_exchange_strong(current, error, std::memory_order_relaxed)) {
+				if (current != error) {
+					continue;
+				}
+			}
+			current = error;
+		}
+		if (current == error) {
+			slot.count.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+	_otherErrors.fetch_add(1, std::memory_order_relaxed);
+}
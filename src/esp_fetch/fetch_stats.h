@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+#include "esp_err.h"
+}
+
+struct FetchErrorCount {
+	esp_err_t error = ESP_OK;
+	uint32_t count = 0;
+};
+
+// Library-wide counters since init() (or the last resetStats()).
+struct FetchStats {
+	static constexpr size_t kErrorSlots = 8;
+	static constexpr size_t kLaneSlots = 4; // lane 0 plus up to three FetchConfig::lanes
+
+	uint32_t requests = 0;       // completed jobs, including ones failed before they ran
+	uint32_t failedRequests = 0; // jobs that completed with error != ESP_OK
+	uint32_t coalescedRequests = 0; // GETs served by attaching to an identical in-flight job
+	uint32_t retries = 0;           // extra attempts made by FetchRequestOptions::retry
+	// Jobs failed fast with ESP_ERR_NOT_ALLOWED by an open circuit, and circuits open right now
+	// (FetchConfig::circuitBreakerThreshold).
+	uint32_t circuitRejections = 0;
+	size_t openCircuits = 0;
+	// DNS cache (FetchConfig::dnsCacheEntries): requests answered from the cache, including
+	// cached failures, and lookups the cache made, including prefetches.
+	uint32_t dnsCacheHits = 0;
+	uint32_t dnsLookups = 0;
+	// First kErrorSlots distinct error codes seen; unused slots have count == 0.
+	FetchErrorCount errors[kErrorSlots];
+	uint32_t otherErrors = 0; // failures whose code did not fit in `errors`
+	uint64_t bytesIn = 0;     // response body bytes received
+	uint64_t bytesOut = 0;    // request body bytes sent
+	uint64_t slotWaitUs = 0;  // summed time from enqueue to job start
+	uint32_t maxSlotWaitUs = 0;
+	size_t peakConcurrentJobs = 0;
+	size_t peakJobHeapBytes = 0; // peak estimated heap held by in-flight jobs
+	// Jobs that found a free slot but had to wait for the memory governor
+	// (FetchConfig::memoryBudgetBytes / minFreeHeapBytes).
+	uint32_t memoryDeferrals = 0;
+	// Job arenas (FetchConfig::jobArenaBytes): most bytes one job used, and allocations that
+	// did not fit and fell back to the heap.
+	size_t peakArenaBytes = 0;
+	uint32_t arenaOverflows = 0;
+	// Least free stack in bytes seen when a job finished, per lane (FetchRequestOptions::lane);
+	// 0 until a job ran on the lane. Shrink a lane's stackSize while this stays comfortably > 0.
+	size_t laneMinFreeStackBytes[kLaneSlots] = {};
+};
+
+// Lock-free recorder behind ESPFetch::stats(). Every update is a relaxed atomic, so it is cheap
+// enough to stay enabled; a snapshot is not a consistent cut across counters.
+class FetchStatsRecorder {
+  public:
+	void reset();
+	FetchStats snapshot() const;
+
+	void recordCompletion(
+	    esp_err_t error, uint64_t bytesIn, uint64_t bytesOut, int64_t slotWaitUs
+	);
+	void recordCoalesced();
+	void recordRetry();
+	void recordCircuitRejection();
+	void recordDnsHit();
+	void recordDnsLookup();
+	void recordConcurrentJobs(size_t runningJobs);
+	void addJobHeap(size_t bytes);
+	void releaseJobHeap(size_t bytes);
+	void recordMemoryDeferral();
+	void recordArenaUsage(size_t highWaterBytes, uint32_t overflows);
+	void recordStackHighWater(size_t lane, size_t freeBytes);
+
+  private:
+	struct ErrorSlot {
+		std::atomic<int32_t> error{ESP_OK};
+		std::atomic<uint32_t> count{0};
+	};
+
+	static void raiseTo(std::atomic<size_t> &peak, size_t value);
+	void recordError(esp_err_t error);
+
+	std::atomic<uint32_t> _requests{0};
+	std::atomic<uint32_t> _failedRequests{0};
+	std::atomic<uint32_t> _coalescedRequests{0};
+	std::atomic<uint32_t> _retries{0};
+	std::atomic<uint32_t> _circuitRejections{0};
+	std::atomic<uint32_t> _dnsCacheHits{0};
+	std::atomic<uint32_t> _dnsLookups{0};
+	ErrorSlot _errors[FetchStats::kErrorSlots];
+	std::atomic<uint32_t> _otherErrors{0};
+	std::atomic<uint64_t> _bytesIn{0};
+	std::atomic<uint64_t> _bytesOut{0};
+	std::atomic<uint64_t> _slotWaitUs{0};
+	std::atomic<uint32_t> _maxSlotWaitUs{0};
+	std::atomic<size_t> _peakConcurrentJobs{0};
+	std::atomic<size_t> _jobHeapBytes{0};
+	std::atomic<size_t> _peakJobHeapBytes{0};
+	std::atomic<uint32_t> _memoryDeferrals{0};
+	std::atomic<size_t> _peakArenaBytes{0};
+	std::atomic<uint32_t> _arenaOverflows{0};
+	std::atomic<size_t> _laneMinFreeStack[FetchStats::kLaneSlots] = {};
+};
@@ -0,0 +1,68 @@
+#include "esp_fetch/fetch_trace.h"
+
+extern "C" {
+#include "esp_timer.h"
+}
+
+const char *FetchTraceBuffer::eventName(FetchTraceEvent event) {
+	switch (event) {
+	case FetchTraceEvent::Enqueued:
+		return "enqueued";
+	case FetchTraceEvent::SlotAcquired:
+		return "slot";
+	case FetchTraceEvent::Connected:
+		return "connected";
+	case FetchTraceEvent::HeadersReceived:
+		return "headers";
+	case FetchTraceEvent::Chunk:
+		return "chunk";
+	case FetchTraceEvent::Completed:
+		return "completed";
+	case FetchTraceEvent::Error:
+		return "error";
+	}
+	return "unknown";
+}
+
+void FetchTraceBuffer::record(FetchTraceEvent event, uint32_t job, uint32_t value) {
+	const uint32_t index = _next.fetch_add(1, std::memory_order_relaxed);
+	Slot &slot = _slots[index % kCapacity];
+	slot.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.record.timeUs = esp_timer_get_time();
+	slot.record.job = job;
+	slot.record.value = value;
+	slot.record.event = event;
+	slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+size_t FetchTraceBuffer::snapshot(FetchTraceRecord *out, size_t capacity) const {
+	if (out == nullptr || capacity == 0) {
+		return 0;
+	}
+	const uint32_t end = _next.load(std::memory_order_acquire);
+	uint32_t begin = _clearedAt.load(std::memory_order_relaxed);
+	const uint32_t window = static_cast<uint32_t>(capacity < kCapacity ? capacity : kCapacity);
+	if (end - begin > window) {
+		begin = end - window;
+	}
+
+	size_t copied = 0;
+	for (uint32_t index = begin; index != end; ++index) {
+		const Slot &slot = _slots[index % kCapacity];
+		if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+			continue; // still being written, or already overwritten
+		}
+		const FetchTraceRecord record = slot.record;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != index + 1) {
+			continue;
+		}
+		out[copied++] = record;
+	}
+	return copied;
+}
+
+void FetchTraceBuffer::clear() {
+	_clearedAt.store(_next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
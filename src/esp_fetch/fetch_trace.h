@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Build with -DESP_FETCH_ENABLE_TRACE=1 to record request events into ESPFetch's trace ring.
+// Without it the hooks expand to nothing and ESPFetch holds no ring.
+#ifndef ESP_FETCH_ENABLE_TRACE
+#define ESP_FETCH_ENABLE_TRACE 0
+#endif
+
+// Events kept by the ring (each record is 24 bytes).
+#ifndef ESP_FETCH_TRACE_EVENTS
+#define ESP_FETCH_TRACE_EVENTS 128
+#endif
+
+enum class FetchTraceEvent : uint8_t {
+	Enqueued,        // value: FetchPriority
+	SlotAcquired,    // value: FetchRequestOptions::lane
+	Connected,       // value: 0
+	HeadersReceived, // value: HTTP status
+	Chunk,           // value: bytes received
+	Completed,       // value: HTTP status
+	Error,           // value: esp_err_t
+};
+
+struct FetchTraceRecord {
+	int64_t timeUs = 0; // esp_timer_get_time()
+	uint32_t job = 0;   // numbered from 1 per ESPFetch instance in enqueue order
+	uint32_t value = 0;
+	FetchTraceEvent event = FetchTraceEvent::Enqueued;
+};
+
+// Fixed ring of binary trace records. record() is lock-free and does no formatting, so it can
+// stay on the hot path; when the ring is full the oldest records are overwritten. Every slot
+// carries a sequence number, so snapshot() skips records that are being rewritten meanwhile.
+class FetchTraceBuffer {
+  public:
+	static constexpr size_t kCapacity = ESP_FETCH_TRACE_EVENTS;
+
+	static const char *eventName(FetchTraceEvent event);
+
+	// Number for a new job's records.
+	uint32_t nextJob() {
+		return _jobs.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+	void record(FetchTraceEvent event, uint32_t job, uint32_t value);
+
+	// Copies up to `capacity` of the newest records, oldest first; returns how many were copied.
+	size_t snapshot(FetchTraceRecord *out, size_t capacity) const;
+	void clear();
+
+  private:
+	struct Slot {
+		std::atomic<uint32_t> sequence{0}; // 0 while empty or being written
+		FetchTraceRecord record;
+	};
+
+	Slot _slots[kCapacity];
+	std::atomic<uint32_t> _next{0};
+	std::atomic<uint32_t> _clearedAt{0}; // first index snapshot() may return
+	std::atomic<uint32_t> _jobs{0};
+};
+
+// Hooks used by ESPFetch: number a job, then record one of its events.
+#if ESP_FETCH_ENABLE_TRACE
+#define ESP_FETCH_TRACE_JOB(buffer, job) ((job) = (buffer).nextJob())
+#define ESP_FETCH_TRACE(buffer, event, job, value)                                                \
+	(buffer).record((event), (job), static_cast<uint32_t>(value))
+#else
+#define ESP_FETCH_TRACE_JOB(buffer, job) ((void)0)
+#define ESP_FETCH_TRACE(buffer, event, job, value) ((void)0)
+#endif
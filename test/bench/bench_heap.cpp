@@ -0,0 +1,146 @@
+#include "bench_heap.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <malloc.h>
+#include <new>
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+}
+
+namespace {
+std::atomic<size_t> g_allocations{0};
+std::atomic<size_t> g_allocatedBytes{0};
+std::atomic<size_t> g_liveBytes{0};
+std::atomic<size_t> g_peakBytes{0};
+thread_local unsigned t_uncountedDepth = 0;
+thread_local size_t t_freedBytes = 0;
+
+void recordAllocation(void *ptr) {
+	if (ptr == nullptr || t_uncountedDepth > 0) {
+		return;
+	}
+	const size_t bytes = malloc_usable_size(ptr);
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	g_allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+	const size_t live = g_liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	size_t peak = g_peakBytes.load(std::memory_order_relaxed);
+	while (live > peak &&
+	       !g_peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+	}
+}
+
+void recordFree(void *ptr) {
+	if (ptr == nullptr || t_uncountedDepth > 0) {
+		return;
+	}
+	const size_t bytes = malloc_usable_size(ptr);
+	g_liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+	t_freedBytes += bytes;
+}
+} // namespace
+
+extern "C" {
+void *__wrap_malloc(size_t size) {
+	void *ptr = __real_malloc(size);
+	recordAllocation(ptr);
+	return ptr;
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+	void *ptr = __real_calloc(count, size);
+	recordAllocation(ptr);
+	return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+	recordFree(ptr);
+	void *resized = __real_realloc(ptr, size);
+	// A failed realloc leaves the old block in place.
+	recordAllocation(resized != nullptr || size == 0 ? resized : ptr);
+	return resized;
+}
+
+void __wrap_free(void *ptr) {
+	recordFree(ptr);
+	__real_free(ptr);
+}
+}
+
+void *operator new(size_t size) {
+	void *ptr = malloc(size == 0 ? 1 : size);
+	if (ptr == nullptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+	return malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+	return malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void *ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+	free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+	free(ptr);
+}
+
+namespace bench_heap {
+
+Snapshot snapshot() {
+	Snapshot result;
+	result.allocations = g_allocations.load(std::memory_order_relaxed);
+	result.allocatedBytes = g_allocatedBytes.load(std::memory_order_relaxed);
+	result.liveBytes = g_liveBytes.load(std::memory_order_relaxed);
+	result.peakBytes = g_peakBytes.load(std::memory_order_relaxed);
+	return result;
+}
+
+size_t threadFreedBytes() {
+	return t_freedBytes;
+}
+
+void resetPeak() {
+	g_peakBytes.store(g_liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+UncountedScope::UncountedScope() {
+	++t_uncountedDepth;
+}
+
+UncountedScope::~UncountedScope() {
+	--t_uncountedDepth;
+}
+
+CountedScope::CountedScope() : _savedDepth(t_uncountedDepth) {
+	t_uncountedDepth = 0;
+}
+
+CountedScope::~CountedScope() {
+	t_uncountedDepth = _savedDepth;
+}
+
+} // namespace bench_heap
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+
+// Heap accounting for the benchmark. malloc/calloc/realloc/free are wrapped at link time
+// (-Wl,--wrap) and the global operator new/delete route through them, so every allocation made
+// by ESPFetch, ArduinoJson and the standard library on their behalf is seen. Sizes are the
+// allocator's usable sizes, i.e. what the block really costs.
+namespace bench_heap {
+
+struct Snapshot {
+	size_t allocations = 0;   // blocks handed out since start
+	size_t allocatedBytes = 0; // bytes handed out since start
+	size_t liveBytes = 0;      // bytes currently allocated
+	size_t peakBytes = 0;      // highest liveBytes since the last resetPeak()
+};
+
+Snapshot snapshot();
+// Counted bytes freed by the calling thread so far. Other tasks allocate and free concurrently,
+// so this is how the bench sizes one object: the difference across destroying it.
+size_t threadFreedBytes();
+// Starts a new peak window at the current live size.
+void resetPeak();
+
+// Allocations and frees on the calling thread are ignored while a scope is alive. The mock
+// esp_http_client and FreeRTOS shim use it, since their memory says nothing about ESPFetch.
+class UncountedScope {
+  public:
+	UncountedScope();
+	~UncountedScope();
+
+	UncountedScope(const UncountedScope &) = delete;
+	UncountedScope &operator=(const UncountedScope &) = delete;
+};
+
+// Counts again inside an UncountedScope, e.g. while the mock client runs ESPFetch's event handler.
+class CountedScope {
+  public:
+	CountedScope();
+	~CountedScope();
+
+	CountedScope(const CountedScope &) = delete;
+	CountedScope &operator=(const CountedScope &) = delete;
+
+  private:
+	unsigned _savedDepth;
+};
+
+} // namespace bench_heap
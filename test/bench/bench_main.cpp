@@ -0,0 +1,569 @@
+// Host benchmark for ESPFetch: replays scripted responses through the mock esp_http_client and
+// reports throughput, latency and heap use per request. See README "Host Benchmark".
+
+#include <ESPFetch.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "bench_heap.h"
+#include "mock_backend.h"
+
+namespace {
+constexpr const char *BENCH_ORIGIN = "http://bench.local";
+constexpr size_t BENCH_DEFAULT_ITERATIONS = 500;
+constexpr TickType_t BENCH_WAIT_TICKS = pdMS_TO_TICKS(5000);
+// Lets the job task finish its cleanup after the result was handed over.
+constexpr TickType_t BENCH_SETTLE_TICKS = pdMS_TO_TICKS(20);
+
+struct Sample {
+	size_t documentBytes = 0; // heap held by the result JsonDocument, 0 when there is none
+};
+
+using RunFn = std::function<bool(ESPFetch &fetch, Sample &sample)>;
+
+struct Scenario {
+	const char *name;
+	FetchConfig config;
+	mock_backend::Responder responder;
+	RunFn run;
+};
+
+struct Report {
+	size_t iterations = 0;
+	size_t failures = 0;
+	double seconds = 0;
+	int64_t p50Us = 0;
+	int64_t p99Us = 0;
+	double allocationsPerRequest = 0;
+	double bytesPerRequest = 0;
+	size_t peakBytes = 0;     // above the live heap before the first measured request
+	size_t documentBytes = 0; // largest result document
+	double connectsPerRequest = 0;
+	size_t retainedBytes = 0; // still allocated after deinit(), i.e. leaked
+};
+
+// JSON array of small objects, at least `bytes` long.
+std::string makeJsonBody(size_t bytes) {
+	std::string body = "{\"items\":[";
+	for (size_t i = 0; body.size() < bytes; ++i) {
+		if (i > 0) {
+			body += ',';
+		}
+		body += "{\"id\":" + std::to_string(i) + ",\"name\":\"item-" + std::to_string(i) +
+		        "\",\"value\":" + std::to_string(i % 100) + ".5,\"tags\":[\"a\",\"b\"]}";
+	}
+	body += "]}";
+	return body;
+}
+
+mock_backend::HeaderList makeHeaders(size_t count) {
+	mock_backend::HeaderList headers = {
+	    {"Content-Type", "application/json"},
+	    {"Date", "Wed, 14 Oct 2026 08:00:00 GMT"},
+	    {"Server", "bench"},
+	    {"Cache-Control", "no-store"},
+	};
+	for (size_t i = headers.size(); i < count; ++i) {
+		headers.emplace_back("X-Bench-" + std::to_string(i), "value-" + std::to_string(i * 7919));
+	}
+	return headers;
+}
+
+mock_backend::Responder respondWith(mock_backend::Response response) {
+	return [response](const mock_backend::Request &) { return response; };
+}
+
+std::string benchUrl(const char *path) {
+	return std::string(BENCH_ORIGIN) + path;
+}
+
+// Destroys `document` on this task and returns the heap it held.
+size_t releaseDocument(JsonDocument &document) {
+	const size_t freedBefore = bench_heap::threadFreedBytes();
+	{
+		JsonDocument released = std::move(document);
+	}
+	return bench_heap::threadFreedBytes() - freedBefore;
+}
+
+RunFn syncGet(std::string url, int expectedStatus, FetchRequestOptions options = {}) {
+	return [url, expectedStatus, options](ESPFetch &fetch, Sample &sample) {
+		JsonDocument result = fetch.get(url.c_str(), BENCH_WAIT_TICKS, options);
+		const bool ok = result["status"].as<int>() == expectedStatus &&
+		                (!options.parseJsonBody || !result["json"].isNull());
+		sample.documentBytes = releaseDocument(result);
+		return ok;
+	};
+}
+
+RunFn syncPost(std::string url, JsonDocument payload, FetchRequestOptions options = {}) {
+	return [url, payload, options](ESPFetch &fetch, Sample &sample) {
+		JsonDocument result = fetch.post(url.c_str(), payload, BENCH_WAIT_TICKS, options);
+		const bool ok = result["status"].as<int>() == 200 &&
+		                (!options.parseJsonBody || !result["json"].isNull());
+		sample.documentBytes = releaseDocument(result);
+		return ok;
+	};
+}
+
+RunFn syncGetRaw(std::string url, size_t expectedBytes) {
+	return [url, expectedBytes](ESPFetch &fetch, Sample &) {
+		const FetchRawResponse response = fetch.getRaw(url.c_str(), BENCH_WAIT_TICKS);
+		return response.error == ESP_OK && response.statusCode == 200 &&
+		       response.body.size() == expectedBytes;
+	};
+}
+
+RunFn streamGet(std::string url, size_t expectedBytes) {
+	return [url, expectedBytes](ESPFetch &fetch, Sample &) {
+		// Shared with the callbacks, which outlive this call if the wait times out.
+		struct Wait {
+			SemaphoreHandle_t done = nullptr;
+			size_t received = 0;
+			StreamResult result;
+		};
+		auto wait = std::make_shared<Wait>();
+		wait->done = xSemaphoreCreateBinary();
+		fetch.getStream(
+		    url.c_str(),
+		    [wait](const void *, size_t size) {
+			    wait->received += size;
+			    return true;
+		    },
+		    [wait](StreamResult result) {
+			    wait->result = result;
+			    xSemaphoreGive(wait->done);
+		    }
+		);
+		const bool finished = xSemaphoreTake(wait->done, BENCH_WAIT_TICKS) == pdTRUE;
+		if (finished) {
+			vSemaphoreDelete(wait->done);
+		}
+		return finished && wait->result.error == ESP_OK && wait->result.statusCode == 200 &&
+		       wait->received == expectedBytes && wait->result.receivedBytes == expectedBytes;
+	};
+}
+
+// Streams `body` through a caller-owned ring of `bufferCount` buffers. Each chunk must point into
+// the ring and continue the body where the previous one ended. With `rejectChunk` > 0 onChunk
+// returns false for that chunk, so the stream must end with ESP_ERR_INVALID_STATE after
+// delivering only the chunks before it.
+RunFn streamRing(std::string url, std::string body, size_t bufferCount, size_t rejectChunk) {
+	constexpr size_t BENCH_RING_BUFFER_SIZE = 4096;
+	return [url, body, bufferCount, rejectChunk](ESPFetch &fetch, Sample &) {
+		struct Wait {
+			SemaphoreHandle_t done = nullptr;
+			std::vector<uint8_t> ring;
+			size_t received = 0;
+			size_t chunks = 0;
+			bool ordered = true;
+			StreamResult result;
+		};
+		auto wait = std::make_shared<Wait>();
+		wait->done = xSemaphoreCreateBinary();
+		wait->ring.resize(bufferCount * BENCH_RING_BUFFER_SIZE);
+
+		FetchRequestOptions options;
+		options.streamBufferCount = bufferCount;
+		options.streamBufferSize = BENCH_RING_BUFFER_SIZE;
+		options.streamBuffers = wait->ring.data();
+		fetch.getStream(
+		    url.c_str(),
+		    [wait, body, rejectChunk](const void *data, size_t size) {
+			    const char *bytes = static_cast<const char *>(data);
+			    const char *ringStart = reinterpret_cast<const char *>(wait->ring.data());
+			    const char *ringEnd = ringStart + wait->ring.size();
+			    if (bytes < ringStart || bytes + size > ringEnd ||
+			        wait->received + size > body.size() ||
+			        std::memcmp(bytes, body.data() + wait->received, size) != 0) {
+				    wait->ordered = false;
+			    }
+			    if (++wait->chunks == rejectChunk) {
+				    return false;
+			    }
+			    wait->received += size;
+			    return true;
+		    },
+		    [wait](StreamResult result) {
+			    wait->result = result;
+			    xSemaphoreGive(wait->done);
+		    },
+		    options
+		);
+		const bool finished = xSemaphoreTake(wait->done, BENCH_WAIT_TICKS) == pdTRUE;
+		if (finished) {
+			vSemaphoreDelete(wait->done);
+		}
+		if (!finished || !wait->ordered || wait->result.receivedBytes != wait->received) {
+			return false;
+		}
+		if (rejectChunk > 0) {
+			return wait->result.error == ESP_ERR_INVALID_STATE && wait->chunks == rejectChunk &&
+			       wait->received < body.size();
+		}
+		return wait->result.error == ESP_OK && wait->result.statusCode == 200 &&
+		       wait->received == body.size();
+	};
+}
+
+// One large stream holds most of memoryBudgetBytes while `smallJobs` small ones park behind it.
+// Once it ends they all fit the budget together, so they must run at the same time: each small
+// chunk callback waits up to BENCH_GATHER_TICKS for the others to arrive.
+RunFn memoryDrain(std::string largeUrl, std::string smallUrl, size_t smallJobs) {
+	constexpr TickType_t BENCH_GATHER_TICKS = pdMS_TO_TICKS(500);
+	return [largeUrl, smallUrl, smallJobs](ESPFetch &fetch, Sample &) {
+		struct Wait {
+			std::atomic<bool> largeStarted{false};
+			std::atomic<bool> releaseLarge{false};
+			std::atomic<size_t> smallRunning{0};
+			std::atomic<size_t> smallPeak{0};
+			std::atomic<size_t> finished{0};
+			std::atomic<size_t> failed{0};
+		};
+		auto wait = std::make_shared<Wait>();
+		const auto onDone = [wait](StreamResult result) {
+			if (result.error != ESP_OK || result.statusCode != 200) {
+				wait->failed.fetch_add(1);
+			}
+			wait->finished.fetch_add(1);
+		};
+
+		FetchRequestOptions large;
+		large.rxBufferSize = 64 * 1024;
+		fetch.getStream(
+		    largeUrl.c_str(),
+		    [wait](const void *, size_t) {
+			    wait->largeStarted = true;
+			    while (!wait->releaseLarge) {
+				    vTaskDelay(1);
+			    }
+			    return true;
+		    },
+		    onDone,
+		    large
+		);
+		const TickType_t begun = xTaskGetTickCount();
+		while (!wait->largeStarted && xTaskGetTickCount() - begun < BENCH_WAIT_TICKS) {
+			vTaskDelay(1);
+		}
+		for (size_t i = 0; i < smallJobs; ++i) {
+			fetch.getStream(
+			    smallUrl.c_str(),
+			    [wait, smallJobs](const void *, size_t) {
+				    const size_t running = wait->smallRunning.fetch_add(1) + 1;
+				    size_t peak = wait->smallPeak.load();
+				    while (running > peak && !wait->smallPeak.compare_exchange_weak(peak, running)) {
+				    }
+				    const TickType_t arrived = xTaskGetTickCount();
+				    while (wait->smallPeak < smallJobs &&
+				           xTaskGetTickCount() - arrived < BENCH_GATHER_TICKS) {
+					    vTaskDelay(1);
+				    }
+				    wait->smallRunning.fetch_sub(1);
+				    return true;
+			    },
+			    onDone
+			);
+		}
+		wait->releaseLarge = true;
+
+		while (wait->finished < smallJobs + 1 && xTaskGetTickCount() - begun < BENCH_WAIT_TICKS) {
+			vTaskDelay(1);
+		}
+		return wait->finished == smallJobs + 1 && wait->failed == 0 &&
+		       wait->smallPeak == smallJobs;
+	};
+}
+
+std::vector<Scenario> buildScenarios() {
+	std::vector<Scenario> scenarios;
+	const FetchConfig defaults;
+
+	mock_backend::Response small;
+	small.headers = makeHeaders(6);
+	small.body = makeJsonBody(256);
+	scenarios.push_back({"json-256b", defaults, respondWith(small), syncGet(benchUrl("/s"), 200)});
+
+	mock_backend::Response large;
+	large.headers = makeHeaders(6);
+	large.body = makeJsonBody(12 * 1024);
+	scenarios.push_back({"json-12k", defaults, respondWith(large), syncGet(benchUrl("/l"), 200)});
+
+	mock_backend::Response manyHeaders = small;
+	manyHeaders.headers = makeHeaders(48);
+	scenarios.push_back(
+	    {"headers-48", defaults, respondWith(manyHeaders), syncGet(benchUrl("/h"), 200)}
+	);
+
+	mock_backend::Response chunked;
+	chunked.headers = makeHeaders(6);
+	chunked.body = makeJsonBody(4 * 1024);
+	chunked.chunked = true;
+	scenarios.push_back(
+	    {"chunked-4k", defaults, respondWith(chunked), syncGet(benchUrl("/c"), 200)}
+	);
+
+	mock_backend::Response moved;
+	moved.status = 302;
+	moved.headers = {{"Location", "/s"}};
+	scenarios.push_back(
+	    {"redirect-302",
+	     defaults,
+	     [small, moved](const mock_backend::Request &request) {
+		     return request.url == benchUrl("/old") ? moved : small;
+	     },
+	     syncGet(benchUrl("/old"), 200)}
+	);
+
+	mock_backend::Response unauthorized;
+	unauthorized.status = 401;
+	unauthorized.headers = {{"WWW-Authenticate", "Basic realm=\"bench\""}};
+	unauthorized.body = "{\"error\":\"unauthorized\"}";
+	scenarios.push_back(
+	    {"unauthorized-401", defaults, respondWith(unauthorized), syncGet(benchUrl("/a"), 401)}
+	);
+
+	FetchRequestOptions parse;
+	parse.parseJsonBody = true;
+	scenarios.push_back(
+	    {"parse-json-12k", defaults, respondWith(large), syncGet(benchUrl("/p"), 200, parse)}
+	);
+
+	// The server answers 400 unless the JSON payload arrived intact, so a parsed POST that drops
+	// its body fails the scenario.
+	JsonDocument payload;
+	payload["sensor"] = "bench";
+	payload["value"] = 42;
+	std::string sentBody;
+	serializeJson(payload, sentBody);
+	mock_backend::Response rejected;
+	rejected.status = 400;
+	scenarios.push_back(
+	    {"post-parse-json",
+	     defaults,
+	     [small, rejected, sentBody](const mock_backend::Request &request) {
+		     return !sentBody.empty() && request.body == sentBody ? small : rejected;
+	     },
+	     syncPost(benchUrl("/u"), payload, parse)}
+	);
+
+	mock_backend::Response binary;
+	binary.headers = {{"Content-Type", "application/octet-stream"}};
+	binary.body.assign(64 * 1024, '\x5a');
+	scenarios.push_back(
+	    {"stream-64k", defaults, respondWith(binary), streamGet(benchUrl("/b"), binary.body.size())}
+	);
+
+	// A body that never repeats within a buffer, so reordered or dropped chunks are caught.
+	mock_backend::Response patterned = binary;
+	for (size_t i = 0; i < patterned.body.size(); ++i) {
+		patterned.body[i] = static_cast<char>(i % 251);
+	}
+	scenarios.push_back(
+	    {"stream-ring-64k",
+	     defaults,
+	     respondWith(patterned),
+	     streamRing(benchUrl("/b"), patterned.body, 3, 0)}
+	);
+	scenarios.push_back(
+	    {"stream-ring-abort",
+	     defaults,
+	     respondWith(patterned),
+	     streamRing(benchUrl("/b"), patterned.body, 3, 2)}
+	);
+
+	mock_backend::Response raw = large;
+	raw.body.resize(4 * 1024);
+	scenarios.push_back(
+	    {"raw-4k", defaults, respondWith(raw), syncGetRaw(benchUrl("/r"), raw.body.size())}
+	);
+
+	// The large stream alone exceeds the budget; the three small ones fit it together.
+	FetchConfig governed;
+	governed.pendingQueueSize = 8;
+	governed.memoryBudgetBytes = 40 * 1024;
+	mock_backend::Response chunk;
+	chunk.body = "x";
+	scenarios.push_back(
+	    {"memory-drain",
+	     governed,
+	     respondWith(chunk),
+	     memoryDrain(benchUrl("/big"), benchUrl("/small"), 3)}
+	);
+
+	FetchConfig pooled;
+	pooled.useWorkerPool = true;
+	pooled.maxIdleConnections = 2;
+	scenarios.push_back(
+	    {"pooled-json-256b", pooled, respondWith(small), syncGet(benchUrl("/s"), 200)}
+	);
+
+	return scenarios;
+}
+
+bool runScenario(const Scenario &scenario, size_t iterations, Report &report) {
+	std::vector<int64_t> latencies;
+	latencies.reserve(iterations);
+	const size_t liveBeforeInit = bench_heap::snapshot().liveBytes;
+	mock_backend::setResponder(scenario.responder);
+
+	{
+		ESPFetch fetch;
+		if (!fetch.init(scenario.config)) {
+			std::fprintf(stderr, "%s: init() failed\n", scenario.name);
+			return false;
+		}
+
+		Sample sample;
+		const size_t warmup = std::min<size_t>(10, iterations);
+		for (size_t i = 0; i < warmup; ++i) {
+			scenario.run(fetch, sample);
+		}
+		vTaskDelay(BENCH_SETTLE_TICKS);
+
+		mock_backend::resetCounters();
+		bench_heap::resetPeak();
+		const bench_heap::Snapshot start = bench_heap::snapshot();
+		const auto begun = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < iterations; ++i) {
+			const auto requestStart = std::chrono::steady_clock::now();
+			sample = Sample();
+			if (!scenario.run(fetch, sample)) {
+				++report.failures;
+			}
+			const auto elapsed = std::chrono::steady_clock::now() - requestStart;
+			latencies.push_back(
+			    std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+			);
+			report.documentBytes = std::max(report.documentBytes, sample.documentBytes);
+		}
+		const auto finished = std::chrono::steady_clock::now();
+		vTaskDelay(BENCH_SETTLE_TICKS);
+		const bench_heap::Snapshot end = bench_heap::snapshot();
+
+		report.iterations = iterations;
+		report.seconds = std::chrono::duration<double>(finished - begun).count();
+		report.allocationsPerRequest =
+		    static_cast<double>(end.allocations - start.allocations) / iterations;
+		report.bytesPerRequest =
+		    static_cast<double>(end.allocatedBytes - start.allocatedBytes) / iterations;
+		report.peakBytes = end.peakBytes > start.liveBytes ? end.peakBytes - start.liveBytes : 0;
+		report.connectsPerRequest =
+		    static_cast<double>(mock_backend::counters().connects) / iterations;
+		fetch.deinit();
+	}
+	vTaskDelay(BENCH_SETTLE_TICKS);
+	const size_t liveAfterDeinit = bench_heap::snapshot().liveBytes;
+	report.retainedBytes = liveAfterDeinit > liveBeforeInit ? liveAfterDeinit - liveBeforeInit : 0;
+
+	std::sort(latencies.begin(), latencies.end());
+	report.p50Us = latencies[latencies.size() / 2];
+	report.p99Us = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+	return report.failures == 0;
+}
+
+void printUsage(const char *program) {
+	std::printf(
+	    "usage: %s [--iterations N] [--filter TEXT] [--csv]\n"
+	    "  --iterations N  measured requests per scenario (default %zu)\n"
+	    "  --filter TEXT   only run scenarios whose name contains TEXT\n"
+	    "  --csv           print comma-separated values instead of a table\n",
+	    program,
+	    BENCH_DEFAULT_ITERATIONS
+	);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+	size_t iterations = BENCH_DEFAULT_ITERATIONS;
+	const char *filter = nullptr;
+	bool csv = false;
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+			iterations = std::strtoul(argv[++i], nullptr, 10);
+		} else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (std::strcmp(argv[i], "--csv") == 0) {
+			csv = true;
+		} else {
+			printUsage(argv[0]);
+			return 2;
+		}
+	}
+	if (iterations == 0) {
+		printUsage(argv[0]);
+		return 2;
+	}
+
+	if (csv) {
+		std::printf("scenario,requests,req_per_s,p50_us,p99_us,allocs_per_req,bytes_per_req,"
+		            "peak_bytes,doc_bytes,connects_per_req,retained_bytes,failures\n");
+	} else {
+		std::printf(
+		    "%-18s %10s %8s %8s %8s %10s %9s %9s %9s %9s\n",
+		    "scenario",
+		    "req/s",
+		    "p50 us",
+		    "p99 us",
+		    "allocs",
+		    "bytes",
+		    "peak",
+		    "doc",
+		    "connects",
+		    "retained"
+		);
+	}
+
+	int failed = 0;
+	for (const Scenario &scenario : buildScenarios()) {
+		if (filter && std::strstr(scenario.name, filter) == nullptr) {
+			continue;
+		}
+		Report report;
+		if (!runScenario(scenario, iterations, report)) {
+			++failed;
+		}
+		const double perSecond = report.seconds > 0 ? report.iterations / report.seconds : 0;
+		if (csv) {
+			std::printf(
+			    "%s,%zu,%.0f,%lld,%lld,%.1f,%.0f,%zu,%zu,%.2f,%zu,%zu\n",
+			    scenario.name,
+			    report.iterations,
+			    perSecond,
+			    static_cast<long long>(report.p50Us),
+			    static_cast<long long>(report.p99Us),
+			    report.allocationsPerRequest,
+			    report.bytesPerRequest,
+			    report.peakBytes,
+			    report.documentBytes,
+			    report.connectsPerRequest,
+			    report.retainedBytes,
+			    report.failures
+			);
+		} else {
+			std::printf(
+			    "%-18s %10.0f %8lld %8lld %8.1f %10.0f %9zu %9zu %9.2f %9zu%s\n",
+			    scenario.name,
+			    perSecond,
+			    static_cast<long long>(report.p50Us),
+			    static_cast<long long>(report.p99Us),
+			    report.allocationsPerRequest,
+			    report.bytesPerRequest,
+			    report.peakBytes,
+			    report.documentBytes,
+			    report.connectsPerRequest,
+			    report.retainedBytes,
+			    report.failures > 0 ? "  FAILED" : ""
+			);
+		}
+	}
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Just enough of the Arduino core for ESPFetch's String overloads on the host.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+class String {
+  public:
+	String(const char *value = "") : _value(value ? value : "") {
+	}
+
+	const char *c_str() const {
+		return _value.c_str();
+	}
+	size_t length() const {
+		return _value.size();
+	}
+
+  private:
+	std::string _value;
+};
+
+class Print {
+  public:
+	virtual ~Print() = default;
+	virtual size_t write(uint8_t value) = 0;
+	virtual size_t write(const uint8_t *buffer, size_t size) {
+		size_t written = 0;
+		while (written < size && write(buffer[written]) == 1) {
+			++written;
+		}
+		return written;
+	}
+};
+
+unsigned long millis();
+void delay(unsigned long ms);
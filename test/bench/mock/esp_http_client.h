@@ -0,0 +1,124 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's esp_http_client. Nothing goes to the network: every request is
+// answered by the scripted backend in mock_backend.h, with the event order, keep-alive and
+// open/fetch_headers/read semantics of the IDF client. Only the API ESPFetch calls is provided.
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef struct esp_http_client *esp_http_client_handle_t;
+
+typedef enum {
+	HTTP_EVENT_ERROR = 0,
+	HTTP_EVENT_ON_CONNECTED,
+	HTTP_EVENT_HEADERS_SENT,
+	HTTP_EVENT_HEADER_SENT = HTTP_EVENT_HEADERS_SENT,
+	HTTP_EVENT_ON_HEADER,
+	HTTP_EVENT_ON_DATA,
+	HTTP_EVENT_ON_FINISH,
+	HTTP_EVENT_DISCONNECTED,
+	HTTP_EVENT_REDIRECT,
+} esp_http_client_event_id_t;
+
+typedef struct esp_http_client_event {
+	esp_http_client_event_id_t event_id;
+	esp_http_client_handle_t client;
+	void *data;
+	int data_len;
+	void *user_data;
+	char *header_key;
+	char *header_value;
+} esp_http_client_event_t;
+
+typedef esp_err_t (*http_event_handle_cb)(esp_http_client_event_t *evt);
+
+typedef enum {
+	HTTP_METHOD_GET = 0,
+	HTTP_METHOD_POST,
+	HTTP_METHOD_PUT,
+	HTTP_METHOD_PATCH,
+	HTTP_METHOD_DELETE,
+	HTTP_METHOD_HEAD,
+	HTTP_METHOD_NOTIFY,
+	HTTP_METHOD_SUBSCRIBE,
+	HTTP_METHOD_UNSUBSCRIBE,
+	HTTP_METHOD_OPTIONS,
+	HTTP_METHOD_COPY,
+	HTTP_METHOD_MOVE,
+	HTTP_METHOD_LOCK,
+	HTTP_METHOD_UNLOCK,
+	HTTP_METHOD_PROPFIND,
+	HTTP_METHOD_PROPPATCH,
+	HTTP_METHOD_MKCOL,
+	HTTP_METHOD_MAX,
+} esp_http_client_method_t;
+
+typedef enum {
+	ESP_HTTP_CLIENT_TLS_VER_ANY = 0,
+	ESP_HTTP_CLIENT_TLS_VER_TLS_1_2,
+	ESP_HTTP_CLIENT_TLS_VER_TLS_1_3,
+} esp_http_client_proto_ver_t;
+
+typedef enum {
+	HTTP_TLS_DYN_BUF_RX_STATIC = 1,
+} esp_http_client_tls_dyn_buf_strategy_t;
+
+typedef struct {
+	const char *url;
+	const char *cert_pem;
+	const char *common_name;
+	esp_http_client_proto_ver_t tls_version;
+	esp_http_client_method_t method;
+	int timeout_ms;
+	bool disable_auto_redirect;
+	int max_redirection_count;
+	http_event_handle_cb event_handler;
+	int buffer_size;
+	int buffer_size_tx;
+	void *user_data;
+	bool use_global_ca_store;
+	bool skip_cert_common_name_check;
+	bool save_client_session;
+	esp_err_t (*crt_bundle_attach)(void *conf);
+	esp_http_client_tls_dyn_buf_strategy_t tls_dyn_buf_strategy;
+} esp_http_client_config_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config);
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client);
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url);
+esp_err_t
+esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len);
+esp_err_t
+esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value);
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client, const char *key);
+esp_err_t
+esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method);
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t client, int timeout_ms);
+esp_err_t esp_http_client_set_user_data(esp_http_client_handle_t client, void *data);
+int esp_http_client_get_errno(esp_http_client_handle_t client);
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len);
+int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, int len);
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client);
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client);
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len);
+int esp_http_client_get_status_code(esp_http_client_handle_t client);
+int64_t esp_http_client_get_content_length(esp_http_client_handle_t client);
+esp_err_t esp_http_client_close(esp_http_client_handle_t client);
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t client);
+esp_err_t esp_http_client_add_auth(esp_http_client_handle_t client);
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t client);
+esp_err_t esp_http_client_flush_response(esp_http_client_handle_t client, int *len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's esp_log.h. Logging stays off so it does not show up in the numbers;
+// build with -DESP_FETCH_BENCH_LOG=1 to print warnings and errors while debugging a scenario.
+
+#include <stdio.h>
+
+#if defined(ESP_FETCH_BENCH_LOG) && ESP_FETCH_BENCH_LOG
+#define ESP_FETCH_BENCH_LOG_LINE(level, tag, format, ...)                                          \
+	fprintf(stderr, level " (%s): " format "\n", tag, ##__VA_ARGS__)
+#else
+#define ESP_FETCH_BENCH_LOG_LINE(level, tag, format, ...) ((void)(tag))
+#endif
+
+#define ESP_LOGE(tag, format, ...) ESP_FETCH_BENCH_LOG_LINE("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_FETCH_BENCH_LOG_LINE("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ((void)(tag))
+#define ESP_LOGD(tag, format, ...) ((void)(tag))
+#define ESP_LOGV(tag, format, ...) ((void)(tag))
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Seeded once per run, so retry jitter is repeatable between benchmark runs.
+uint32_t esp_random(void);
+
+#ifdef __cplusplus
+}
+#endif
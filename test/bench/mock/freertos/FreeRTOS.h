@@ -0,0 +1,28 @@
+#pragma once
+
+// Host stand-in for the FreeRTOS kernel that ESP-IDF ships: tasks are std::threads, queues and
+// semaphores are condition-variable queues (see mock_freertos.cpp). One tick is one millisecond.
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+// ESP-IDF counts stack depth in bytes.
+typedef uint8_t StackType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY ((BaseType_t)0x7FFFFFFF)
+
+#define INCLUDE_xTaskGetSchedulerState 1
+#define INCLUDE_uxTaskGetStackHighWaterMark 1
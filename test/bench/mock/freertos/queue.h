@@ -0,0 +1,21 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef struct QueueDefinition *QueueHandle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Storage for `length` items is allocated up front, as with FreeRTOS, so sends do not allocate.
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t waitTicks);
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t waitTicks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t waitTicks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+void vQueueDelete(QueueHandle_t queue);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Mutexes are plain binary semaphores that start given: no owner tracking, no priority inheritance.
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t waitTicks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+
+#ifdef __cplusplus
+}
+#endif
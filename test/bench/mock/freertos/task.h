@@ -0,0 +1,38 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef struct tskTaskControlBlock *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define taskSCHEDULER_SUSPENDED ((BaseType_t)0)
+#define taskSCHEDULER_NOT_STARTED ((BaseType_t)1)
+#define taskSCHEDULER_RUNNING ((BaseType_t)2)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Starts `task` on a detached thread; priority, stack depth and core are recorded but not applied.
+BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t task,
+    const char *name,
+    uint32_t stackDepth,
+    void *parameters,
+    UBaseType_t priority,
+    TaskHandle_t *createdTask,
+    BaseType_t coreId
+);
+// Only vTaskDelete(NULL) is supported. It returns, and the thread ends when the task function
+// does; every ESPFetch task deletes itself as its last statement.
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+BaseType_t xTaskGetSchedulerState(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+// Always 0: host threads have no comparable stack watermark, and ESPFetch reads 0 as unmeasured.
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+#ifdef __cplusplus
+}
+#endif
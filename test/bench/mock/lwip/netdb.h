@@ -0,0 +1,4 @@
+#pragma once
+
+// The host resolver stands in for lwIP's.
+#include <netdb.h>
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "esp_err.h"
+
+// Scripted server behind the mock esp_http_client. The responder sees every request the client
+// sends, including each hop of a redirect, and returns the response to replay for it.
+namespace mock_backend {
+
+using HeaderList = std::vector<std::pair<std::string, std::string>>;
+
+struct Request {
+	const char *method = "GET";
+	std::string url;
+	HeaderList headers;
+	std::string body;
+};
+
+struct Response {
+	int status = 200;
+	HeaderList headers;
+	std::string body;
+	// Sent without Content-Length, as Transfer-Encoding: chunked.
+	bool chunked = false;
+	// Drop the connection after this response instead of keeping it alive.
+	bool closeConnection = false;
+	// Fail the exchange with this error before any response arrives (e.g. ESP_ERR_HTTP_CONNECT).
+	esp_err_t transportError = ESP_OK;
+};
+
+using Responder = std::function<Response(const Request &request)>;
+
+// Replaces the script; requests without one get 404. Not safe while requests are running.
+void setResponder(const Responder &responder);
+
+struct Counters {
+	size_t requests = 0; // responses served, redirect hops included
+	size_t connects = 0; // connections opened (HTTP_EVENT_ON_CONNECTED)
+};
+
+Counters counters();
+void resetCounters();
+
+} // namespace mock_backend
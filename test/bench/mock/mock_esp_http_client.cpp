@@ -0,0 +1,527 @@
+#include "esp_http_client.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <strings.h>
+
+#include "bench_heap.h"
+#include "mock_backend.h"
+
+namespace {
+constexpr int MOCK_DEFAULT_BUFFER_SIZE = 512;
+constexpr int MOCK_MAX_REDIRECTS = 10;
+constexpr int MOCK_MAX_AUTH_RETRIES = 1;
+
+std::mutex g_responderMutex;
+mock_backend::Responder g_responder;
+std::atomic<size_t> g_requests{0};
+std::atomic<size_t> g_connects{0};
+
+const char *methodName(esp_http_client_method_t method) {
+	switch (method) {
+	case HTTP_METHOD_POST:
+		return "POST";
+	case HTTP_METHOD_PUT:
+		return "PUT";
+	case HTTP_METHOD_PATCH:
+		return "PATCH";
+	case HTTP_METHOD_DELETE:
+		return "DELETE";
+	case HTTP_METHOD_HEAD:
+		return "HEAD";
+	case HTTP_METHOD_OPTIONS:
+		return "OPTIONS";
+	case HTTP_METHOD_GET:
+	default:
+		return "GET";
+	}
+}
+
+// "scheme://host[:port]" of url.
+std::string originOf(const std::string &url) {
+	const size_t scheme = url.find("://");
+	if (scheme == std::string::npos) {
+		return std::string();
+	}
+	const size_t path = url.find_first_of("/?#", scheme + 3);
+	return url.substr(0, path);
+}
+
+std::string resolveLocation(const std::string &base, const std::string &location) {
+	if (location.find("://") != std::string::npos) {
+		return location;
+	}
+	if (!location.empty() && location[0] == '/') {
+		return originOf(base) + location;
+	}
+	const size_t slash = base.rfind('/');
+	return base.substr(0, slash == std::string::npos ? base.size() : slash + 1) + location;
+}
+
+bool isRedirect(int status) {
+	return status == 301 || status == 302 || status == 303 || status == 307 || status == 308;
+}
+
+const std::string *findHeader(const mock_backend::HeaderList &headers, const char *name) {
+	for (const auto &header : headers) {
+		if (strcasecmp(header.first.c_str(), name) == 0) {
+			return &header.second;
+		}
+	}
+	return nullptr;
+}
+} // namespace
+
+struct esp_http_client {
+	std::string url;
+	esp_http_client_method_t method = HTTP_METHOD_GET;
+	mock_backend::HeaderList headers;
+	const char *postData = nullptr;
+	int postLength = 0;
+	http_event_handle_cb handler = nullptr;
+	void *userData = nullptr;
+	int timeoutMs = 0;
+	size_t bufferSize = MOCK_DEFAULT_BUFFER_SIZE;
+	bool autoRedirect = true;
+
+	std::string origin; // of the open connection
+	bool connected = false;
+	int lastErrno = 0;
+	int authRetries = 0;
+
+	mock_backend::Response response;
+	bool haveResponse = false;
+	size_t bodyOffset = 0;
+	std::string upload; // request body written after esp_http_client_open()
+
+	// Event handlers get char * header fields; these hold the current pair.
+	std::string eventKey;
+	std::string eventValue;
+};
+
+namespace {
+esp_err_t dispatch(
+    esp_http_client &client,
+    esp_http_client_event_id_t id,
+    const char *data = nullptr,
+    size_t length = 0,
+    const std::string *key = nullptr,
+    const std::string *value = nullptr
+) {
+	if (client.handler == nullptr) {
+		return ESP_OK;
+	}
+	esp_http_client_event_t event = {};
+	event.event_id = id;
+	event.client = &client;
+	event.data = const_cast<char *>(data);
+	event.data_len = static_cast<int>(length);
+	event.user_data = client.userData;
+	if (key && value) {
+		client.eventKey = *key;
+		client.eventValue = *value;
+		event.header_key = &client.eventKey[0];
+		event.header_value = &client.eventValue[0];
+	}
+	// The handler is ESPFetch's, so what it allocates counts.
+	bench_heap::CountedScope counted;
+	return client.handler(&event);
+}
+
+void disconnect(esp_http_client &client) {
+	if (!client.connected) {
+		return;
+	}
+	client.connected = false;
+	client.origin.clear();
+	dispatch(client, HTTP_EVENT_DISCONNECTED);
+}
+
+void connect(esp_http_client &client) {
+	const std::string origin = originOf(client.url);
+	if (client.connected && client.origin == origin) {
+		return;
+	}
+	disconnect(client);
+	client.connected = true;
+	client.origin = origin;
+	client.lastErrno = 0;
+	g_connects.fetch_add(1, std::memory_order_relaxed);
+	dispatch(client, HTTP_EVENT_ON_CONNECTED);
+}
+
+// Asks the script for the response to the request on the client and delivers its headers.
+esp_err_t exchange(esp_http_client &client, std::string body) {
+	mock_backend::Request request;
+	request.method = methodName(client.method);
+	request.url = client.url;
+	request.headers = client.headers;
+	request.body = std::move(body);
+	{
+		std::lock_guard<std::mutex> lock(g_responderMutex);
+		if (g_responder) {
+			client.response = g_responder(request);
+		} else {
+			client.response = mock_backend::Response();
+			client.response.status = 404;
+		}
+	}
+	g_requests.fetch_add(1, std::memory_order_relaxed);
+	client.haveResponse = false;
+	client.bodyOffset = 0;
+
+	mock_backend::Response &response = client.response;
+	if (response.transportError != ESP_OK) {
+		client.lastErrno = ENOTCONN;
+		disconnect(client);
+		return response.transportError;
+	}
+	if (client.method == HTTP_METHOD_HEAD) {
+		response.body.clear();
+	}
+	if (response.chunked) {
+		response.headers.emplace_back("Transfer-Encoding", "chunked");
+	} else if (findHeader(response.headers, "Content-Length") == nullptr) {
+		response.headers.emplace_back("Content-Length", std::to_string(response.body.size()));
+	}
+	if (response.closeConnection) {
+		response.headers.emplace_back("Connection", "close");
+	}
+	client.haveResponse = true;
+	for (const auto &header : response.headers) {
+		dispatch(client, HTTP_EVENT_ON_HEADER, nullptr, 0, &header.first, &header.second);
+	}
+	return ESP_OK;
+}
+
+size_t remainingBody(const esp_http_client &client) {
+	return client.haveResponse ? client.response.body.size() - client.bodyOffset : 0;
+}
+
+// Hands up to `length` body bytes to ON_DATA, as the IDF parser does for each transport read.
+size_t consumeBody(esp_http_client &client, char *buffer, size_t length) {
+	const size_t count = std::min(length, remainingBody(client));
+	if (count == 0) {
+		return 0;
+	}
+	const char *data = client.response.body.data() + client.bodyOffset;
+	if (buffer) {
+		std::memcpy(buffer, data, count);
+	}
+	client.bodyOffset += count;
+	dispatch(client, HTTP_EVENT_ON_DATA, data, count);
+	return count;
+}
+
+void finishResponse(esp_http_client &client) {
+	if (client.response.closeConnection) {
+		disconnect(client);
+	}
+}
+} // namespace
+
+namespace mock_backend {
+
+void setResponder(const Responder &responder) {
+	bench_heap::UncountedScope uncounted;
+	std::lock_guard<std::mutex> lock(g_responderMutex);
+	g_responder = responder;
+}
+
+Counters counters() {
+	Counters result;
+	result.requests = g_requests.load(std::memory_order_relaxed);
+	result.connects = g_connects.load(std::memory_order_relaxed);
+	return result;
+}
+
+void resetCounters() {
+	g_requests.store(0, std::memory_order_relaxed);
+	g_connects.store(0, std::memory_order_relaxed);
+}
+
+} // namespace mock_backend
+
+extern "C" {
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config) {
+	if (config == nullptr || config->url == nullptr) {
+		return nullptr;
+	}
+	bench_heap::UncountedScope uncounted;
+	auto *client = new esp_http_client();
+	client->url = config->url;
+	client->method = config->method;
+	client->handler = config->event_handler;
+	client->userData = config->user_data;
+	client->timeoutMs = config->timeout_ms;
+	client->bufferSize = config->buffer_size > 0 ? static_cast<size_t>(config->buffer_size)
+	                                             : MOCK_DEFAULT_BUFFER_SIZE;
+	client->autoRedirect = !config->disable_auto_redirect;
+	return client;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client) {
+	if (client == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	bench_heap::UncountedScope uncounted;
+	client->authRetries = 0;
+	for (int redirects = 0;;) {
+		connect(*client);
+		dispatch(*client, HTTP_EVENT_HEADERS_SENT);
+		const std::string body =
+		    client->postData ? std::string(client->postData, client->postLength) : std::string();
+		const esp_err_t err = exchange(*client, body);
+		if (err != ESP_OK) {
+			return err;
+		}
+		std::string slice(client->bufferSize, '\0');
+		while (remainingBody(*client) > 0) {
+			consumeBody(*client, &slice[0], slice.size());
+		}
+		dispatch(*client, HTTP_EVENT_ON_FINISH);
+		finishResponse(*client);
+
+		const int status = client->response.status;
+		const std::string *location = findHeader(client->response.headers, "Location");
+		if (client->autoRedirect && isRedirect(status) && location) {
+			if (++redirects > MOCK_MAX_REDIRECTS) {
+				return ESP_ERR_HTTP_MAX_REDIRECT;
+			}
+			const std::string next = resolveLocation(client->url, *location);
+			esp_http_client_set_url(client, next.c_str());
+			continue;
+		}
+		if (client->autoRedirect && status == 401 &&
+		    esp_http_client_add_auth(client) == ESP_OK) {
+			continue;
+		}
+		return ESP_OK;
+	}
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url) {
+	if (client == nullptr || url == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	bench_heap::UncountedScope uncounted;
+	client->url = url;
+	client->authRetries = 0;
+	// The IDF client drops the connection when the host or port changes.
+	if (client->connected && client->origin != originOf(client->url)) {
+		disconnect(*client);
+	}
+	return ESP_OK;
+}
+
+esp_err_t
+esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len) {
+	if (client == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	// Like the IDF client, keep the caller's buffer rather than a copy.
+	client->postData = data;
+	client->postLength = data ? len : 0;
+	return ESP_OK;
+}
+
+esp_err_t
+esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value) {
+	if (client == nullptr || key == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	bench_heap::UncountedScope uncounted;
+	for (auto &header : client->headers) {
+		if (strcasecmp(header.first.c_str(), key) == 0) {
+			header.second = value ? value : "";
+			return ESP_OK;
+		}
+	}
+	client->headers.emplace_back(key, value ? value : "");
+	return ESP_OK;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client, const char *key) {
+	if (client == nullptr || key == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	bench_heap::UncountedScope uncounted;
+	auto &headers = client->headers;
+	headers.erase(
+	    std::remove_if(
+	        headers.begin(),
+	        headers.end(),
+	        [key](const auto &header) { return strcasecmp(header.first.c_str(), key) == 0; }
+	    ),
+	    headers.end()
+	);
+	return ESP_OK;
+}
+
+esp_err_t
+esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method) {
+	if (client == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	client->method = method;
+	return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t client, int timeout_ms) {
+	if (client == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	client->timeoutMs = timeout_ms;
+	return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_user_data(esp_http_client_handle_t client, void *data) {
+	if (client == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	client->userData = data;
+	return ESP_OK;
+}
+
+int esp_http_client_get_errno(esp_http_client_handle_t client) {
+	return client ? client->lastErrno : 0;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len) {
+	if (client == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	(void)write_len;
+	bench_heap::UncountedScope uncounted;
+	connect(*client);
+	client->upload.clear();
+	client->haveResponse = false;
+	dispatch(*client, HTTP_EVENT_HEADERS_SENT);
+	return ESP_OK;
+}
+
+int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, int len) {
+	if (client == nullptr || !client->connected || len < 0) {
+		return -1;
+	}
+	bench_heap::UncountedScope uncounted;
+	client->upload.append(buffer, static_cast<size_t>(len));
+	return len;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client) {
+	if (client == nullptr || !client->connected) {
+		return ESP_FAIL;
+	}
+	bench_heap::UncountedScope uncounted;
+	if (exchange(*client, std::move(client->upload)) != ESP_OK) {
+		return ESP_FAIL;
+	}
+	client->upload.clear();
+	// As in IDF, a chunked response reports 0 here and -1 from get_content_length().
+	return client->response.chunked ? 0 : static_cast<int64_t>(client->response.body.size());
+}
+
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client) {
+	return client && client->haveResponse && client->response.chunked;
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len) {
+	if (client == nullptr || buffer == nullptr || len < 0) {
+		return -1;
+	}
+	if (!client->haveResponse) {
+		return 0;
+	}
+	bench_heap::UncountedScope uncounted;
+	const size_t count = consumeBody(*client, buffer, static_cast<size_t>(len));
+	if (remainingBody(*client) == 0) {
+		finishResponse(*client);
+	}
+	return static_cast<int>(count);
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client) {
+	return client && client->haveResponse ? client->response.status : 0;
+}
+
+int64_t esp_http_client_get_content_length(esp_http_client_handle_t client) {
+	if (client == nullptr || !client->haveResponse) {
+		return 0;
+	}
+	return client->response.chunked ? -1 : static_cast<int64_t>(client->response.body.size());
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client) {
+	if (client == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	bench_heap::UncountedScope uncounted;
+	disconnect(*client);
+	return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client) {
+	if (client == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	bench_heap::UncountedScope uncounted;
+	disconnect(*client);
+	delete client;
+	return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t client) {
+	if (client == nullptr || !client->haveResponse) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	const std::string *location = findHeader(client->response.headers, "Location");
+	if (location == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	bench_heap::UncountedScope uncounted;
+	const std::string next = resolveLocation(client->url, *location);
+	return esp_http_client_set_url(client, next.c_str());
+}
+
+esp_err_t esp_http_client_add_auth(esp_http_client_handle_t client) {
+	if (client == nullptr || !client->haveResponse) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (findHeader(client->response.headers, "WWW-Authenticate") == nullptr) {
+		return ESP_ERR_NOT_SUPPORTED;
+	}
+	// No credentials are ever configured, so the retry gets another 401; stop like IDF does once
+	// max_authorization_retries is used up.
+	if (client->authRetries >= MOCK_MAX_AUTH_RETRIES) {
+		return ESP_ERR_HTTP_MAX_REDIRECT;
+	}
+	++client->authRetries;
+	return ESP_OK;
+}
+
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t client) {
+	return client && client->haveResponse && remainingBody(*client) == 0;
+}
+
+esp_err_t esp_http_client_flush_response(esp_http_client_handle_t client, int *len) {
+	if (client == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	bench_heap::UncountedScope uncounted;
+	size_t flushed = 0;
+	while (remainingBody(*client) > 0) {
+		flushed += consumeBody(*client, nullptr, client->bufferSize);
+	}
+	finishResponse(*client);
+	if (len) {
+		*len = static_cast<int>(flushed);
+	}
+	return ESP_OK;
+}
+
+} // extern "C"
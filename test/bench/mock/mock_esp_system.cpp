@@ -0,0 +1,100 @@
+#include <Arduino.h>
+
+#include <chrono>
+#include <limits>
+#include <random>
+#include <thread>
+
+extern "C" {
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+}
+
+#include "bench_heap.h"
+
+namespace {
+const std::chrono::steady_clock::time_point g_start = std::chrono::steady_clock::now();
+}
+
+extern "C" {
+
+int64_t esp_timer_get_time(void) {
+	const auto elapsed = std::chrono::steady_clock::now() - g_start;
+	return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+uint32_t esp_random(void) {
+	bench_heap::UncountedScope uncounted;
+	thread_local std::mt19937 generator(0x45535046);
+	return static_cast<uint32_t>(generator());
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+	(void)caps;
+	return std::numeric_limits<size_t>::max() / 2;
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+	switch (code) {
+	case ESP_OK:
+		return "ESP_OK";
+	case ESP_FAIL:
+		return "ESP_FAIL";
+	case ESP_ERR_NO_MEM:
+		return "ESP_ERR_NO_MEM";
+	case ESP_ERR_INVALID_ARG:
+		return "ESP_ERR_INVALID_ARG";
+	case ESP_ERR_INVALID_STATE:
+		return "ESP_ERR_INVALID_STATE";
+	case ESP_ERR_INVALID_SIZE:
+		return "ESP_ERR_INVALID_SIZE";
+	case ESP_ERR_NOT_FOUND:
+		return "ESP_ERR_NOT_FOUND";
+	case ESP_ERR_NOT_SUPPORTED:
+		return "ESP_ERR_NOT_SUPPORTED";
+	case ESP_ERR_TIMEOUT:
+		return "ESP_ERR_TIMEOUT";
+	case ESP_ERR_INVALID_RESPONSE:
+		return "ESP_ERR_INVALID_RESPONSE";
+	case ESP_ERR_NOT_ALLOWED:
+		return "ESP_ERR_NOT_ALLOWED";
+	case ESP_ERR_HTTP_MAX_REDIRECT:
+		return "ESP_ERR_HTTP_MAX_REDIRECT";
+	case ESP_ERR_HTTP_CONNECT:
+		return "ESP_ERR_HTTP_CONNECT";
+	case ESP_ERR_HTTP_WRITE_DATA:
+		return "ESP_ERR_HTTP_WRITE_DATA";
+	case ESP_ERR_HTTP_FETCH_HEADER:
+		return "ESP_ERR_HTTP_FETCH_HEADER";
+	case ESP_ERR_HTTP_INVALID_TRANSPORT:
+		return "ESP_ERR_HTTP_INVALID_TRANSPORT";
+	case ESP_ERR_HTTP_CONNECTING:
+		return "ESP_ERR_HTTP_CONNECTING";
+	case ESP_ERR_HTTP_EAGAIN:
+		return "ESP_ERR_HTTP_EAGAIN";
+	case ESP_ERR_HTTP_CONNECTION_CLOSED:
+		return "ESP_ERR_HTTP_CONNECTION_CLOSED";
+	case ESP_ERR_HTTP_NOT_MODIFIED:
+		return "ESP_ERR_HTTP_NOT_MODIFIED";
+	case ESP_ERR_HTTP_RANGE_NOT_SATISFIABLE:
+		return "ESP_ERR_HTTP_RANGE_NOT_SATISFIABLE";
+	case ESP_ERR_HTTP_READ_TIMEOUT:
+		return "ESP_ERR_HTTP_READ_TIMEOUT";
+	case ESP_ERR_HTTP_INCOMPLETE_DATA:
+		return "ESP_ERR_HTTP_INCOMPLETE_DATA";
+	default:
+		return "UNKNOWN ERROR";
+	}
+}
+
+} // extern "C"
+
+unsigned long millis() {
+	return static_cast<unsigned long>(esp_timer_get_time() / 1000);
+}
+
+void delay(unsigned long ms) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
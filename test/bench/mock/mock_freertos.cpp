@@ -0,0 +1,223 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+#include <vector>
+
+#include "bench_heap.h"
+
+// A queue holds `length` items of `itemSize` bytes; semaphores are queues with zero-sized items
+// where `count` is the number of items waiting, exactly as in FreeRTOS.
+struct QueueDefinition {
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::vector<unsigned char> storage;
+	size_t itemSize = 0;
+	size_t length = 0;
+	size_t head = 0;
+	size_t count = 0;
+};
+
+struct tskTaskControlBlock {
+	TaskFunction_t function = nullptr;
+	void *parameters = nullptr;
+};
+
+namespace {
+const std::chrono::steady_clock::time_point g_start = std::chrono::steady_clock::now();
+thread_local tskTaskControlBlock *t_currentTask = nullptr;
+
+// Waits for `ready` under `lock`; false once waitTicks passed without it.
+template <typename Ready>
+bool waitFor(
+    QueueDefinition &queue, std::unique_lock<std::mutex> &lock, TickType_t waitTicks, Ready ready
+) {
+	if (waitTicks == portMAX_DELAY) {
+		queue.changed.wait(lock, ready);
+		return true;
+	}
+	return queue.changed.wait_for(lock, std::chrono::milliseconds(waitTicks), ready);
+}
+
+QueueDefinition *createQueue(size_t length, size_t itemSize, size_t initialCount) {
+	bench_heap::UncountedScope uncounted;
+	auto *queue = new QueueDefinition();
+	queue->storage.resize(length * itemSize);
+	queue->itemSize = itemSize;
+	queue->length = length;
+	queue->count = initialCount;
+	return queue;
+}
+
+void *runTask(void *arg) {
+	auto *task = static_cast<tskTaskControlBlock *>(arg);
+	t_currentTask = task;
+	task->function(task->parameters);
+	bench_heap::UncountedScope uncounted;
+	delete task;
+	return nullptr;
+}
+} // namespace
+
+extern "C" {
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+	if (length == 0) {
+		return nullptr;
+	}
+	return createQueue(length, itemSize, 0);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t waitTicks) {
+	if (queue == nullptr) {
+		return pdFAIL;
+	}
+	std::unique_lock<std::mutex> lock(queue->mutex);
+	if (!waitFor(*queue, lock, waitTicks, [queue] { return queue->count < queue->length; })) {
+		return pdFAIL;
+	}
+	if (queue->itemSize > 0) {
+		const size_t slot = (queue->head + queue->count) % queue->length;
+		std::memcpy(&queue->storage[slot * queue->itemSize], item, queue->itemSize);
+	}
+	++queue->count;
+	queue->changed.notify_all();
+	return pdPASS;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t waitTicks) {
+	return xQueueSend(queue, item, waitTicks);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t waitTicks) {
+	if (queue == nullptr) {
+		return pdFAIL;
+	}
+	std::unique_lock<std::mutex> lock(queue->mutex);
+	if (!waitFor(*queue, lock, waitTicks, [queue] { return queue->count > 0; })) {
+		return pdFAIL;
+	}
+	if (queue->itemSize > 0) {
+		std::memcpy(item, &queue->storage[queue->head * queue->itemSize], queue->itemSize);
+		queue->head = (queue->head + 1) % queue->length;
+	}
+	--queue->count;
+	queue->changed.notify_all();
+	return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+	if (queue == nullptr) {
+		return 0;
+	}
+	std::lock_guard<std::mutex> lock(queue->mutex);
+	return static_cast<UBaseType_t>(queue->count);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+	bench_heap::UncountedScope uncounted;
+	delete queue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+	return createQueue(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+	return createQueue(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+	if (maxCount == 0 || initialCount > maxCount) {
+		return nullptr;
+	}
+	return createQueue(maxCount, 0, initialCount);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t waitTicks) {
+	return xQueueReceive(semaphore, nullptr, waitTicks);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+	return xQueueSend(semaphore, nullptr, 0);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+	return uxQueueMessagesWaiting(semaphore);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+	vQueueDelete(semaphore);
+}
+
+BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t task,
+    const char *name,
+    uint32_t stackDepth,
+    void *parameters,
+    UBaseType_t priority,
+    TaskHandle_t *createdTask,
+    BaseType_t coreId
+) {
+	(void)name;
+	(void)stackDepth;
+	(void)priority;
+	(void)coreId;
+	bench_heap::UncountedScope uncounted;
+	auto *control = new tskTaskControlBlock();
+	control->function = task;
+	control->parameters = parameters;
+
+	// The handle is only good until the task ends; ESPFetch never keeps it.
+	if (createdTask) {
+		*createdTask = control;
+	}
+	pthread_t thread;
+	if (pthread_create(&thread, nullptr, &runTask, control) != 0) {
+		delete control;
+		if (createdTask) {
+			*createdTask = nullptr;
+		}
+		return pdFAIL;
+	}
+	pthread_detach(thread);
+	return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+	// The task function returns right after deleting itself; runTask frees the control block.
+	(void)task;
+}
+
+void vTaskDelay(TickType_t ticks) {
+	std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount(void) {
+	const auto elapsed = std::chrono::steady_clock::now() - g_start;
+	return static_cast<TickType_t>(
+	    std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()
+	);
+}
+
+BaseType_t xTaskGetSchedulerState(void) {
+	return taskSCHEDULER_RUNNING;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+	return t_currentTask;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+	(void)task;
+	return 0;
+}
+
+} // extern "C"